@@ -57,7 +57,7 @@ struct ListenerMessageHeader {
 
   u16 u6;        //! Unknown
   u32 msg_size;  //! Size of data after this header
-  u64 u8;        //! Unknown
+  u64 msg_id;    //! Message ID, sent back by the target in the ack for this message
 };
 
 constexpr int DECI2_PORT = 8112;  // TODO - is this a good choise?
@@ -1,16 +1,63 @@
+#include <deque>
+#include <unordered_map>
 #include "TypeSpec.h"
 #include "Type.h"
 
-TypeSpec::TypeSpec(std::string type) : m_type(std::move(type)) {}
+namespace {
+struct TypeNameTable {
+  TypeNameTable() { intern(""); }
+
+  TypeId intern(const std::string& name) {
+    lookups++;
+    auto kv = ids.find(name);
+    if (kv != ids.end()) {
+      return kv->second;
+    }
+    TypeId id = names.size();
+    names.push_back(name);
+    ids[name] = id;
+    return id;
+  }
+
+  std::unordered_map<std::string, TypeId> ids;
+  std::deque<std::string> names;  // deque so references from base_type() stay valid
+  u64 lookups = 0;
+};
+
+TypeNameTable& type_name_table() {
+  static TypeNameTable table;
+  return table;
+}
+}  // namespace
+
+/*!
+ * Get the id for a type name, adding it if it is new.
+ */
+TypeId intern_type_name(const std::string& name) {
+  return type_name_table().intern(name);
+}
+
+const std::string& type_id_name(TypeId id) {
+  return type_name_table().names.at(id);
+}
+
+/*!
+ * How many times a type name has been looked up in the intern table.
+ */
+u64 type_name_intern_count() {
+  return type_name_table().lookups;
+}
+
+TypeSpec::TypeSpec(std::string type) : m_type(intern_type_name(type)) {}
 
 TypeSpec::TypeSpec(std::string type, std::vector<TypeSpec> arguments)
-    : m_type(std::move(type)), m_arguments(std::move(arguments)) {}
+    : m_type(intern_type_name(type)), m_arguments(std::move(arguments)) {}
 
 std::string TypeSpec::print() const {
   if (m_arguments.empty()) {
-    return m_type;
+    return base_type();
   } else {
-    std::string result = "(" + m_type;
+    std::string result = "(" + base_type();
     for (auto& x : m_arguments) {
       result += " " + x.print();
     }
@@ -37,8 +84,9 @@ bool TypeSpec::operator==(const TypeSpec& other) const {
 }
 
 TypeSpec TypeSpec::substitute_for_method_call(const std::string& method_type) const {
+  static const TypeId type_type_id = intern_type_name("_type_");
   TypeSpec result;
-  result.m_type = (m_type == "_type_") ? method_type : m_type;
+  result.m_type = (m_type == type_type_id) ? intern_type_name(method_type) : m_type;
   for (const auto& x : m_arguments) {
     result.m_arguments.push_back(x.substitute_for_method_call(method_type));
   }
@@ -48,7 +96,7 @@ TypeSpec TypeSpec::substitute_for_method_call(const std::string& method_type) co
 bool TypeSpec::is_compatible_child_method(const TypeSpec& implementation,
                                           const std::string& child_type) const {
   bool ok = implementation.m_type == m_type ||
-            (m_type == "_type_" && implementation.m_type == child_type);
+            (base_type() == "_type_" && implementation.base_type() == child_type);
   if (!ok || implementation.m_arguments.size() != m_arguments.size()) {
     return false;
   }
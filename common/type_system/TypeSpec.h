@@ -10,9 +10,19 @@
 #include <vector>
 #include <string>
 #include <cassert>
+#include "common/common_types.h"
 
 class Type;
 
+/*!
+ * Type names are interned, so a TypeSpec holds a small integer id instead of a string. Ids are
+ * shared by all TypeSystems and are never freed. Id 0 is the empty name. Not thread safe.
+ */
+using TypeId = u32;
+TypeId intern_type_name(const std::string& name);
+const std::string& type_id_name(TypeId id);
+u64 type_name_intern_count();
+
 /*!
  * A TypeSpec is a reference to a Type, or possible a compound type.  This is the best way to
  * refer to a type, as it supports compound types and also will work correctly after a type has been
@@ -36,7 +46,8 @@ class TypeSpec {
 
   void add_arg(const TypeSpec& ts) { m_arguments.push_back(ts); }
 
-  const std::string base_type() const { return m_type; }
+  const std::string& base_type() const { return type_id_name(m_type); }
+  TypeId base_type_id() const { return m_type; }
 
   bool has_single_arg() const { return m_arguments.size() == 1; }
 
@@ -57,7 +68,7 @@ class TypeSpec {
 
  private:
   friend class TypeSystem;
-  std::string m_type;
+  TypeId m_type = 0;
   std::vector<TypeSpec> m_arguments;
 };
 
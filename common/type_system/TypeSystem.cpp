@@ -17,6 +17,7 @@ TypeSystem::TypeSystem() {
  * throw_on_redefine is set. The type should be fully set up (fields, etc) before running this.
  */
 Type* TypeSystem::add_type(const std::string& name, std::unique_ptr<Type> type) {
+  m_stats.name_lookups++;
   auto kv = m_types.find(name);
   if (kv != m_types.end()) {
     // exists already
@@ -34,6 +35,11 @@ Type* TypeSystem::add_type(const std::string& name, std::unique_ptr<Type> type)
 
         // update the type
         m_types[name] = std::move(type);
+
+        // the parent may have changed, so ancestors of this type and its children are stale.
+        for (auto& entry : m_types_by_id) {
+          entry.ancestors.clear();
+        }
       } else {
         throw std::runtime_error("Type was redefined with throw_on_redefine set.");
       }
@@ -43,6 +49,7 @@ Type* TypeSystem::add_type(const std::string& name, std::unique_ptr<Type> type)
 
     // none/object get to skip these checks because they are roots.
     if (name != "object" && name != "none" && name != "_type_" && name != "_varargs_") {
+      m_stats.name_lookups += 2;
       if (m_forward_declared_types.find(type->get_parent()) != m_forward_declared_types.end()) {
         fmt::print("[TypeSystem] Type {} has incompletely defined parent {}\n", type->get_name(),
                    type->get_parent());
@@ -60,7 +67,13 @@ Type* TypeSystem::add_type(const std::string& name, std::unique_ptr<Type> type)
     m_forward_declared_types.erase(name);
   }
 
-  return m_types[name].get();
+  auto result = m_types[name].get();
+  auto id = intern_type_name(name);
+  if (id >= m_types_by_id.size()) {
+    m_types_by_id.resize(id + 1);
+  }
+  m_types_by_id[id].type = result;
+  return result;
 }
 
 /*!
@@ -147,9 +160,15 @@ DerefInfo TypeSystem::get_deref_info(const TypeSpec& ts) {
  * If you really need a TypeSpec which refers to a non-existent type, just construct your own.
  */
 TypeSpec TypeSystem::make_typespec(const std::string& name) const {
-  if (m_types.find(name) != m_types.end() ||
-      m_forward_declared_types.find(name) != m_forward_declared_types.end()) {
-    return TypeSpec(name);
+  TypeSpec result;
+  result.m_type = intern_type_name(name);
+  if (find_type_by_id(result.m_type)) {
+    return result;
+  }
+
+  m_stats.name_lookups++;
+  if (m_forward_declared_types.find(name) != m_forward_declared_types.end()) {
+    return result;
   } else {
     fmt::print("[TypeSystem] The type {} is unknown.\n", name);
     throw std::runtime_error("make_typespec failed");
@@ -157,7 +176,7 @@ TypeSpec TypeSystem::make_typespec(const std::string& name) const {
 }
 
 bool TypeSystem::fully_defined_type_exists(const std::string& name) const {
-  return m_types.find(name) != m_types.end();
+  return find_type_by_id(intern_type_name(name));
 }
 
 /*!
@@ -209,11 +228,12 @@ TypeSpec TypeSystem::make_inline_array_typespec(const TypeSpec& type) {
  * lookup_type to find the most up-to-date type information.
  */
 Type* TypeSystem::lookup_type(const std::string& name) const {
-  auto kv = m_types.find(name);
-  if (kv != m_types.end()) {
-    return kv->second.get();
+  auto type = find_type_by_id(intern_type_name(name));
+  if (type) {
+    return type;
   }
 
+  m_stats.name_lookups++;
   if (m_forward_declared_types.find(name) != m_forward_declared_types.end()) {
     fmt::print("[TypeSystem] The type {} is not fully defined.\n", name);
   } else {
@@ -230,7 +250,45 @@ Type* TypeSystem::lookup_type(const std::string& name) const {
  * lookup_type to find the most up-to-date type information.
  */
 Type* TypeSystem::lookup_type(const TypeSpec& ts) const {
-  return lookup_type(ts.base_type());
+  return lookup_type_by_id(ts.m_type);
+}
+
+/*!
+ * Get full type information by interned id. Throws if the type doesn't exist.
+ */
+Type* TypeSystem::lookup_type_by_id(TypeId id) const {
+  auto type = find_type_by_id(id);
+  if (type) {
+    return type;
+  }
+
+  // print the error.
+  return lookup_type(type_id_name(id));
+}
+
+/*!
+ * Get a fully defined type by interned id, or nullptr if there isn't one.
+ */
+Type* TypeSystem::find_type_by_id(TypeId id) const {
+  m_stats.id_lookups++;
+  return id < m_types_by_id.size() ? m_types_by_id[id].type : nullptr;
+}
+
+/*!
+ * Get the path from the root type down to the given type. Built on first use.
+ */
+const std::vector<TypeId>& TypeSystem::get_ancestors(TypeId id) const {
+  auto type = lookup_type_by_id(id);
+  auto& entry = m_types_by_id[id];
+  if (entry.ancestors.empty()) {
+    std::vector<TypeId> ancestors;
+    if (type->has_parent()) {
+      ancestors = get_ancestors(intern_type_name(type->get_parent()));
+    }
+    ancestors.push_back(id);
+    entry.ancestors = std::move(ancestors);
+  }
+  return entry.ancestors;
 }
 
 MethodInfo TypeSystem::add_method(const std::string& type_name,
@@ -836,7 +894,7 @@ bool TypeSystem::typecheck(const TypeSpec& expected,
                            bool throw_on_error) const {
   bool success = true;
   // first, typecheck the base types:
-  if (!typecheck_base_types(expected.base_type(), actual.base_type())) {
+  if (!typecheck_base_types(expected.m_type, actual.m_type)) {
     success = false;
   }
 
@@ -882,76 +940,50 @@ bool TypeSystem::typecheck(const TypeSpec& expected,
 /*!
  * Is actual of type expected? For base types.
  */
-bool TypeSystem::typecheck_base_types(const std::string& expected,
-                                      const std::string& actual) const {
+bool TypeSystem::typecheck_base_types(TypeId expected, TypeId actual) const {
   // just to make sure it exists. (note - could there be a case when it just has to be forward
   // declared, but not defined?)
-  lookup_type(expected);
+  auto& expected_ancestors = get_ancestors(expected);
 
   if (expected == actual) {
-    lookup_type(actual);  // make sure it exists
     return true;
   }
 
-  std::string actual_name = actual;
-  auto actual_type = lookup_type(actual_name);
-  while (actual_type->has_parent()) {
-    actual_name = actual_type->get_parent();
-    actual_type = lookup_type(actual_name);
-
-    if (expected == actual_name) {
-      return true;
-    }
-  }
-
-  return false;
+  // if expected is an ancestor, it's at the same depth in the path to actual.
+  auto& actual_ancestors = get_ancestors(actual);
+  size_t depth = expected_ancestors.size() - 1;
+  return depth < actual_ancestors.size() && actual_ancestors[depth] == expected;
 }
 
 /*!
  * Get a path from type to object.
  */
 std::vector<std::string> TypeSystem::get_path_up_tree(const std::string& type) {
-  auto parent = lookup_type(type)->get_parent();
-  std::vector<std::string> path = {type};
-  path.push_back(parent);
-  auto parent_type = lookup_type(parent);
-
-  while (parent_type->has_parent()) {
-    parent = parent_type->get_parent();
-    parent_type = lookup_type(parent);
-    path.push_back(parent);
+  auto& ancestors = get_ancestors(intern_type_name(type));
+  std::vector<std::string> path;
+  for (auto it = ancestors.rbegin(); it != ancestors.rend(); it++) {
+    path.push_back(type_id_name(*it));
   }
-
   return path;
 }
 
 /*!
  * Lowest common ancestor of two base types.
  */
-std::string TypeSystem::lca_base(const std::string& a, const std::string& b) {
+TypeId TypeSystem::lca_base(TypeId a, TypeId b) const {
   if (a == b) {
     return a;
   }
 
-  auto a_up = get_path_up_tree(a);
-  auto b_up = get_path_up_tree(b);
-
-  int ai = a_up.size() - 1;
-  int bi = b_up.size() - 1;
+  auto& a_up = get_ancestors(a);
+  auto& b_up = get_ancestors(b);
+  assert(a_up.front() == b_up.front());
 
-  std::string* result = nullptr;
-  while (ai >= 0 && bi >= 0) {
-    if (a_up.at(ai) == b_up.at(bi)) {
-      result = &a_up.at(ai);
-    } else {
-      break;
-    }
-    ai--;
-    bi--;
+  size_t i = 0;
+  while (i + 1 < a_up.size() && i + 1 < b_up.size() && a_up[i + 1] == b_up[i + 1]) {
+    i++;
   }
-
-  assert(result);
-  return *result;
+  return a_up[i];
 }
 
 /*!
@@ -961,7 +993,8 @@ std::string TypeSystem::lca_base(const std::string& a, const std::string& b) {
  * (lca(a, b) lca(b, d)).
  */
 TypeSpec TypeSystem::lowest_common_ancestor(const TypeSpec& a, const TypeSpec& b) {
-  auto result = make_typespec(lca_base(a.base_type(), b.base_type()));
+  TypeSpec result;
+  result.m_type = lca_base(a.m_type, b.m_type);
   if (!a.m_arguments.empty() && !b.m_arguments.empty() &&
       a.m_arguments.size() == b.m_arguments.size()) {
     // recursively add arguments
@@ -31,6 +31,14 @@ struct DerefInfo {
 
 class TypeSystem {
  public:
+  /*!
+   * Counters for how types are looked up, for profiling the compiler.
+   */
+  struct LookupStats {
+    u64 name_lookups = 0;  //! hash lookups of types by name
+    u64 id_lookups = 0;    //! lookups of types by interned id
+  };
+
   TypeSystem();
 
   Type* add_type(const std::string& name, std::unique_ptr<Type> type);
@@ -102,9 +110,14 @@ class TypeSystem {
   TypeSpec lowest_common_ancestor(const TypeSpec& a, const TypeSpec& b);
   TypeSpec lowest_common_ancestor(const std::vector<TypeSpec>& types);
 
+  const LookupStats& lookup_stats() const { return m_stats; }
+
  private:
-  std::string lca_base(const std::string& a, const std::string& b);
-  bool typecheck_base_types(const std::string& expected, const std::string& actual) const;
+  Type* lookup_type_by_id(TypeId id) const;
+  Type* find_type_by_id(TypeId id) const;
+  const std::vector<TypeId>& get_ancestors(TypeId id) const;
+  TypeId lca_base(TypeId a, TypeId b) const;
+  bool typecheck_base_types(TypeId expected, TypeId actual) const;
   int get_size_in_type(const Field& field);
   int get_alignment_in_type(const Field& field);
   Field lookup_field(const std::string& type_name, const std::string& field_name);
@@ -124,6 +137,15 @@ class TypeSystem {
   std::unordered_set<std::string> m_forward_declared_types;
   std::vector<std::unique_ptr<Type>> m_old_types;
 
+  // types indexed by TypeId, with their ancestors (root first, the type itself last).
+  // the ancestors are filled in on first use and cleared if a type is redefined.
+  struct TypeEntry {
+    Type* type = nullptr;
+    std::vector<TypeId> ancestors;
+  };
+  mutable std::vector<TypeEntry> m_types_by_id;
+  mutable LookupStats m_stats;
+
   bool m_allow_redefinition = false;
 };
 
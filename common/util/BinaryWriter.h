@@ -49,7 +49,7 @@ class BinaryWriter {
     }
   }
 
-  BinaryWriterRef add_data(void* d, size_t len) {
+  BinaryWriterRef add_data(const void* d, size_t len) {
     auto orig_size = data.size();
     data.resize(orig_size + len);
     memcpy(data.data() + orig_size, d, len);
@@ -48,4 +48,59 @@ std::vector<BasicBlock> find_blocks_in_function(const LinkedObjectFile& file,
   }
 
   return basic_blocks;
-}
\ No newline at end of file
+}
+
+/*!
+ * Set up the succ and pred of the basic blocks of a function. This follows the same rules as
+ * build_cfg: the branch of a block is the second to last instruction, an always branch doesn't fall
+ * through, and the last block returns. build_cfg relies on these matching its own links.
+ */
+void link_basic_blocks(const LinkedObjectFile& file, int seg, Function& func) {
+  (void)seg;  // only checked in an assert
+  auto& blocks = func.basic_blocks;
+  for (auto& b : blocks) {
+    b.succ.clear();
+    b.pred.clear();
+  }
+
+  auto link = [&](int from, int to) {
+    auto& succ = blocks.at(from).succ;
+    if (std::find(succ.begin(), succ.end(), to) == succ.end()) {
+      succ.push_back(to);
+      blocks.at(to).pred.push_back(from);
+    }
+  };
+
+  for (int i = 0; i < int(blocks.size()); i++) {
+    const auto& b = blocks[i];
+    bool not_last = (i + 1) < int(blocks.size());
+
+    bool falls_through = true;
+    if (b.end_word - b.start_word >= 2) {
+      auto& branch_candidate = func.instructions.at(b.end_word - 2);
+      if (is_branch(branch_candidate, {})) {
+        int label_target = branch_candidate.get_label_target();
+        assert(label_target != -1);
+        const auto& label = file.labels.at(label_target);
+        assert(label.target_segment == seg);
+        int offset = label.offset / 4 - func.start_word;
+
+        // like build_cfg, prefer the last block starting here if there are zero size blocks.
+        int block_target = -1;
+        for (int j = int(blocks.size()); j-- > 0;) {
+          if (blocks[j].start_word == offset) {
+            block_target = j;
+            break;
+          }
+        }
+        assert(block_target != -1);
+        link(i, block_target);
+        falls_through = !is_always_branch(branch_candidate);
+      }
+    }
+
+    if (falls_through && not_last) {
+      link(i, i + 1);
+    }
+  }
+}
@@ -15,6 +15,11 @@ struct BasicBlock {
   int start_word;
   int end_word;
 
+  // indices of blocks that can run next or before this one, set by link_basic_blocks.
+  // a block with no succ returns from the function.
+  std::vector<int> succ;
+  std::vector<int> pred;
+
   BasicBlock(int _start_word, int _end_word) : start_word(_start_word), end_word(_end_word) {}
 };
 
@@ -22,4 +27,6 @@ std::vector<BasicBlock> find_blocks_in_function(const LinkedObjectFile& file,
                                                 int seg,
                                                 const Function& func);
 
+void link_basic_blocks(const LinkedObjectFile& file, int seg, Function& func);
+
 #endif  // JAK_DISASSEMBLER_BASICBLOCKS_H
@@ -13,6 +13,9 @@
  */
 void CfgVtx::parent_claim(CfgVtx* new_parent) {
   parent = new_parent;
+  if (new_parent->first_block == -1 || first_block < new_parent->first_block) {
+    new_parent->first_block = first_block;
+  }
 
   // clear out all this junk - we don't need it now that we are a part of the "real" CFG!
   next = nullptr;
@@ -140,8 +143,8 @@ std::string BlockVtx::to_string() {
   }
 }
 
-std::shared_ptr<Form> BlockVtx::to_form() {
-  return toForm("b" + std::to_string(block_id));
+Form* BlockVtx::to_form(FormPool& pool) {
+  return toForm(pool, "b" + std::to_string(block_id));
 }
 
 std::string SequenceVtx::to_string() {
@@ -152,117 +155,117 @@ std::string SequenceVtx::to_string() {
   return result;
 }
 
-std::shared_ptr<Form> SequenceVtx::to_form() {
-  std::vector<std::shared_ptr<Form>> forms;
-  forms.push_back(toForm("seq"));
+Form* SequenceVtx::to_form(FormPool& pool) {
+  std::vector<Form*> forms;
+  forms.push_back(toForm(pool, "seq"));
   for (auto* x : seq) {
-    forms.push_back(x->to_form());
+    forms.push_back(x->to_form(pool));
   }
-  return buildList(forms);
+  return buildList(pool, forms);
 }
 
 std::string EntryVtx::to_string() {
   return "ENTRY";
 }
 
-std::shared_ptr<Form> EntryVtx::to_form() {
-  return toForm("entry");
+Form* EntryVtx::to_form(FormPool& pool) {
+  return toForm(pool, "entry");
 }
 
 std::string ExitVtx::to_string() {
   return "EXIT";
 }
 
-std::shared_ptr<Form> ExitVtx::to_form() {
-  return toForm("exit");
+Form* ExitVtx::to_form(FormPool& pool) {
+  return toForm(pool, "exit");
 }
 
 std::string CondWithElse::to_string() {
   return "CONDWE" + std::to_string(uid);
 }
 
-std::shared_ptr<Form> CondWithElse::to_form() {
-  std::vector<std::shared_ptr<Form>> forms;
-  forms.push_back(toForm("cond"));
+Form* CondWithElse::to_form(FormPool& pool) {
+  std::vector<Form*> forms;
+  forms.push_back(toForm(pool, "cond"));
   for (const auto& x : entries) {
-    std::vector<std::shared_ptr<Form>> e = {x.condition->to_form(), x.body->to_form()};
-    forms.push_back(buildList(e));
+    std::vector<Form*> e = {x.condition->to_form(pool), x.body->to_form(pool)};
+    forms.push_back(buildList(pool, e));
   }
-  std::vector<std::shared_ptr<Form>> e = {toForm("else"), else_vtx->to_form()};
-  forms.push_back(buildList(e));
-  return buildList(forms);
+  std::vector<Form*> e = {toForm(pool, "else"), else_vtx->to_form(pool)};
+  forms.push_back(buildList(pool, e));
+  return buildList(pool, forms);
 }
 
 std::string CondNoElse::to_string() {
   return "CONDNE" + std::to_string(uid);
 }
 
-std::shared_ptr<Form> CondNoElse::to_form() {
-  std::vector<std::shared_ptr<Form>> forms;
-  forms.push_back(toForm("cond"));
+Form* CondNoElse::to_form(FormPool& pool) {
+  std::vector<Form*> forms;
+  forms.push_back(toForm(pool, "cond"));
   for (const auto& x : entries) {
-    std::vector<std::shared_ptr<Form>> e = {x.condition->to_form(), x.body->to_form()};
-    forms.push_back(buildList(e));
+    std::vector<Form*> e = {x.condition->to_form(pool), x.body->to_form(pool)};
+    forms.push_back(buildList(pool, e));
   }
-  return buildList(forms);
+  return buildList(pool, forms);
 }
 
 std::string WhileLoop::to_string() {
   return "WHL" + std::to_string(uid);
 }
 
-std::shared_ptr<Form> WhileLoop::to_form() {
-  std::vector<std::shared_ptr<Form>> forms = {toForm("while"), condition->to_form(),
-                                              body->to_form()};
-  return buildList(forms);
+Form* WhileLoop::to_form(FormPool& pool) {
+  std::vector<Form*> forms = {toForm(pool, "while"), condition->to_form(pool),
+                             body->to_form(pool)};
+  return buildList(pool, forms);
 }
 
 std::string UntilLoop::to_string() {
   return "UNTL" + std::to_string(uid);
 }
 
-std::shared_ptr<Form> UntilLoop::to_form() {
-  std::vector<std::shared_ptr<Form>> forms = {toForm("until"), condition->to_form(),
-                                              body->to_form()};
-  return buildList(forms);
+Form* UntilLoop::to_form(FormPool& pool) {
+  std::vector<Form*> forms = {toForm(pool, "until"), condition->to_form(pool),
+                             body->to_form(pool)};
+  return buildList(pool, forms);
 }
 
 std::string UntilLoop_single::to_string() {
   return "UNTLS" + std::to_string(uid);
 }
 
-std::shared_ptr<Form> UntilLoop_single::to_form() {
-  std::vector<std::shared_ptr<Form>> forms = {toForm("until1"), block->to_form()};
-  return buildList(forms);
+Form* UntilLoop_single::to_form(FormPool& pool) {
+  std::vector<Form*> forms = {toForm(pool, "until1"), block->to_form(pool)};
+  return buildList(pool, forms);
 }
 
 std::string InfiniteLoopBlock::to_string() {
   return "INFL" + std::to_string(uid);
 }
 
-std::shared_ptr<Form> InfiniteLoopBlock::to_form() {
-  std::vector<std::shared_ptr<Form>> forms = {toForm("inf-loop"), block->to_form()};
-  return buildList(forms);
+Form* InfiniteLoopBlock::to_form(FormPool& pool) {
+  std::vector<Form*> forms = {toForm(pool, "inf-loop"), block->to_form(pool)};
+  return buildList(pool, forms);
 }
 
 std::string ShortCircuit::to_string() {
   return "SC" + std::to_string(uid);
 }
 
-std::shared_ptr<Form> ShortCircuit::to_form() {
-  std::vector<std::shared_ptr<Form>> forms;
-  forms.push_back(toForm("sc"));
+Form* ShortCircuit::to_form(FormPool& pool) {
+  std::vector<Form*> forms;
+  forms.push_back(toForm(pool, "sc"));
   for (const auto& x : entries) {
-    forms.push_back(x->to_form());
+    forms.push_back(x->to_form(pool));
   }
-  return buildList(forms);
+  return buildList(pool, forms);
 }
 
 /*
-std::shared_ptr<Form> IfElseVtx::to_form() {
-  std::vector<std::shared_ptr<Form>> forms = {toForm("if"), condition->to_form(),
-                                              true_case->to_form(), false_case->to_form()};
-  return buildList(forms);
+Form* IfElseVtx::to_form(FormPool& pool) {
+  std::vector<Form*> forms = {toForm(pool, "if"), condition->to_form(pool),
+                             true_case->to_form(pool), false_case->to_form(pool)};
+  return buildList(pool, forms);
 }
 
 std::string IfElseVtx::to_string() {
@@ -274,10 +277,10 @@ std::string GotoEnd::to_string() {
   return "goto_end" + std::to_string(uid);
 }
 
-std::shared_ptr<Form> GotoEnd::to_form() {
-  std::vector<std::shared_ptr<Form>> forms = {toForm("return-from-function"), body->to_form(),
-                                              unreachable_block->to_form()};
-  return buildList(forms);
+Form* GotoEnd::to_form(FormPool& pool) {
+  std::vector<Form*> forms = {toForm(pool, "return-from-function"), body->to_form(pool),
+                             unreachable_block->to_form(pool)};
+  return buildList(pool, forms);
 }
 
 ControlFlowGraph::ControlFlowGraph() {
@@ -361,17 +364,17 @@ CfgVtx* ControlFlowGraph::get_single_top_level() {
  * Turn into a form. If fully resolved, prints the nested control flow. Otherwise puts all the
  * ungrouped stuff into an "(ungrouped ...)" form and prints that.
  */
-std::shared_ptr<Form> ControlFlowGraph::to_form() {
+Form* ControlFlowGraph::to_form(FormPool& pool) {
   if (get_top_level_vertices_count() == 1) {
-    return get_single_top_level()->to_form();
+    return get_single_top_level()->to_form(pool);
   } else {
-    std::vector<std::shared_ptr<Form>> forms = {toForm("ungrouped")};
+    std::vector<Form*> forms = {toForm(pool, "ungrouped")};
     for (auto* x : m_node_pool) {
       if (!x->parent && x != entry() && x != exit()) {
-        forms.push_back(x->to_form());
+        forms.push_back(x->to_form(pool));
       }
     }
-    return buildList(forms);
+    return buildList(pool, forms);
   }
 }
 
@@ -381,7 +384,8 @@ std::shared_ptr<Form> ControlFlowGraph::to_form() {
  */
 std::string ControlFlowGraph::to_form_string() {
   // todo - fix bug in pretty printing and reduce this to 80!
-  return to_form()->toStringPretty(0, 140);
+  FormPool pool;
+  return to_form(pool)->toStringPretty(0, 140);
 }
 
 // bool ControlFlowGraph::compact_top_level() {
@@ -689,6 +693,9 @@ bool ControlFlowGraph::find_while_loop_top_level() {
   // B1 falls through to B2 and nowhere else
   // B2 can end with whatever
   bool found_one = false;
+  if (!may_have_loops()) {
+    return false;
+  }
   bool needs_work = true;
   while (needs_work) {
     needs_work = false;
@@ -701,6 +708,7 @@ bool ControlFlowGraph::find_while_loop_top_level() {
         needs_work = true;
 
         auto* new_vtx = alloc<WhileLoop>();
+        found_loop();
         new_vtx->body = b1;
         new_vtx->condition = b2;
 
@@ -737,6 +745,9 @@ bool ControlFlowGraph::find_until_loop() {
   // B1 falls through to B2 and nowhere else
   // B2 can end with whatever
   bool found_one = false;
+  if (!may_have_loops()) {
+    return false;
+  }
   bool needs_work = true;
   while (needs_work) {
     needs_work = false;
@@ -748,6 +759,7 @@ bool ControlFlowGraph::find_until_loop() {
         needs_work = true;
 
         auto* new_vtx = alloc<UntilLoop>();
+        found_loop();
         new_vtx->body = b1;
         new_vtx->condition = b2;
 
@@ -787,10 +799,14 @@ bool ControlFlowGraph::find_until_loop() {
 
 bool ControlFlowGraph::find_infinite_loop() {
   bool found = false;
+  if (!may_have_loops()) {
+    return false;
+  }
 
   for_each_top_level_vtx([&](CfgVtx* vtx) {
     if (vtx->succ_branch == vtx && !vtx->succ_ft) {
       auto inf = alloc<InfiniteLoopBlock>();
+      found_loop();
       inf->block = vtx;
       inf->pred = vtx->pred;
       inf->replace_preds_with_and_check({vtx}, nullptr);
@@ -824,10 +840,14 @@ bool ControlFlowGraph::find_infinite_loop() {
 
 bool ControlFlowGraph::find_until1_loop() {
   bool found = false;
+  if (!may_have_loops()) {
+    return false;
+  }
 
   for_each_top_level_vtx([&](CfgVtx* vtx) {
     if (vtx->succ_branch == vtx && vtx->succ_ft) {
       auto loop = alloc<UntilLoop_single>();
+      found_loop();
       loop->block = vtx;
       loop->pred = vtx->pred;
       loop->replace_preds_with_and_check({vtx}, nullptr);
@@ -859,6 +879,15 @@ bool ControlFlowGraph::find_until1_loop() {
   return found;
 }
 
+/*!
+ * Count a loop that was just built, see m_backward_edges_left.
+ */
+void ControlFlowGraph::found_loop() {
+  if (m_backward_edges_left > 0) {
+    m_backward_edges_left--;
+  }
+}
+
 bool ControlFlowGraph::find_goto_end() {
   bool replaced = false;
 
@@ -1122,16 +1151,12 @@ bool ControlFlowGraph::find_seq_top_level() {
 
 namespace {
 
-// is a found after b?
+/*!
+ * Is a found after b in the top level next chain? The top level vertices are in memory order, so
+ * this can just compare the first block of each.
+ */
 bool is_found_after(CfgVtx* a, CfgVtx* b) {
-  b = b->next;
-  while (b) {
-    if (a == b) {
-      return true;
-    }
-    b = b->next;
-  }
-  return false;
+  return !a->parent && a->first_block != -1 && a->first_block > b->first_block;
 }
 
 }  // namespace
@@ -1578,6 +1603,7 @@ const std::vector<BlockVtx*>& ControlFlowGraph::create_blocks(int count) {
 
   for (int i = 0; i < count; i++) {
     auto* new_block = alloc<BlockVtx>(i);
+    new_block->first_block = i;
 
     // link next/prev
     new_block->prev = prev;
@@ -1715,6 +1741,9 @@ std::shared_ptr<ControlFlowGraph> build_cfg(const LinkedObjectFile& file, int se
   }
 
   cfg->flag_early_exit(func.basic_blocks);
+  if (func.loop_nest) {
+    cfg->set_backward_edges(func.loop_nest->backward_edges());
+  }
 
   //  if(func.guessed_name.to_string() == "(method 9 thread)")
   //    cfg->find_cond_w_else();
@@ -62,7 +62,7 @@ void replace_exactly_one_in(std::vector<T>& v, T old, T replace) {
 class CfgVtx {
  public:
   virtual std::string to_string() = 0;          // convert to a single line string for debugging
-  virtual std::shared_ptr<Form> to_form() = 0;  // recursive print as LISP form.
+  virtual Form* to_form(FormPool& pool) = 0;  // recursive print as LISP form.
   virtual ~CfgVtx() = default;
 
   CfgVtx* parent = nullptr;       // parent structure, or nullptr if top level
@@ -72,6 +72,7 @@ class CfgVtx {
   CfgVtx* prev = nullptr;         // previous code in memory
   std::vector<CfgVtx*> pred;      // all vertices which have us as succ_branch or succ_ft
   int uid = -1;
+  int first_block = -1;  // the first basic block in memory we contain, or -1 for entry/exit
 
   struct {
     bool has_branch = false;     // does the block end in a branch (any kind)?
@@ -125,7 +126,7 @@ class CfgVtx {
 class EntryVtx : public CfgVtx {
  public:
   EntryVtx() = default;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
   std::string to_string() override;
 };
 
@@ -135,7 +136,7 @@ class EntryVtx : public CfgVtx {
 class ExitVtx : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
 };
 
 /*!
@@ -145,7 +146,7 @@ class BlockVtx : public CfgVtx {
  public:
   explicit BlockVtx(int id) : block_id(id) {}
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
   int block_id = -1;                 // which block are we?
   bool is_early_exit_block = false;  // are we an empty block at the end for early exits to jump to?
 };
@@ -157,7 +158,7 @@ class BlockVtx : public CfgVtx {
 class SequenceVtx : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
   std::vector<CfgVtx*> seq;
 };
 
@@ -169,7 +170,7 @@ class SequenceVtx : public CfgVtx {
 class CondWithElse : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
 
   struct Entry {
     Entry() = default;
@@ -190,7 +191,7 @@ class CondWithElse : public CfgVtx {
 class CondNoElse : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
 
   struct Entry {
     Entry() = default;
@@ -205,7 +206,7 @@ class CondNoElse : public CfgVtx {
 class WhileLoop : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
 
   CfgVtx* condition = nullptr;
   CfgVtx* body = nullptr;
@@ -214,7 +215,7 @@ class WhileLoop : public CfgVtx {
 class UntilLoop : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
 
   CfgVtx* condition = nullptr;
   CfgVtx* body = nullptr;
@@ -223,7 +224,7 @@ class UntilLoop : public CfgVtx {
 class UntilLoop_single : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
 
   CfgVtx* block = nullptr;
 };
@@ -231,21 +232,21 @@ class UntilLoop_single : public CfgVtx {
 class ShortCircuit : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
   std::vector<CfgVtx*> entries;
 };
 
 class InfiniteLoopBlock : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
   CfgVtx* block;
 };
 
 class GotoEnd : public CfgVtx {
  public:
   std::string to_string() override;
-  std::shared_ptr<Form> to_form() override;
+  Form* to_form(FormPool& pool) override;
   CfgVtx* body = nullptr;
   CfgVtx* unreachable_block = nullptr;
 };
@@ -260,7 +261,7 @@ class ControlFlowGraph {
   ControlFlowGraph();
   ~ControlFlowGraph();
 
-  std::shared_ptr<Form> to_form();
+  Form* to_form(FormPool& pool);
   std::string to_form_string();
   std::string to_dot();
   int get_top_level_vertices_count();
@@ -268,6 +269,7 @@ class ControlFlowGraph {
   CfgVtx* get_single_top_level();
 
   void flag_early_exit(const std::vector<BasicBlock>& blocks);
+  void set_backward_edges(int count) { m_backward_edges_left = count; }
 
   const std::vector<BlockVtx*>& create_blocks(int count);
   void link_fall_through(BlockVtx* first, BlockVtx* second);
@@ -324,11 +326,17 @@ class ControlFlowGraph {
   bool is_while_loop(CfgVtx* b0, CfgVtx* b1, CfgVtx* b2);
   bool is_until_loop(CfgVtx* b1, CfgVtx* b2);
   bool is_goto_end_and_unreachable(CfgVtx* b0, CfgVtx* b1);
+  bool may_have_loops() const { return m_backward_edges_left != 0; }
+  void found_loop();
   std::vector<BlockVtx*> m_blocks;   // all block nodes, in order.
   std::vector<CfgVtx*> m_node_pool;  // all nodes allocated
   EntryVtx* m_entry;                 // the entry vertex
   ExitVtx* m_exit;                   // the exit vertex
   int m_uid = 0;
+
+  // every loop needs a branch backward in memory, and each loop we build hides at least one of
+  // them, so once we've built this many loops, there are no more to find. -1 if unknown.
+  int m_backward_edges_left = -1;
 };
 
 class LinkedObjectFile;
@@ -0,0 +1,607 @@
+/*!
+ * @file Dataflow.cpp
+ * Bitset dataflow over basic blocks, and the register analyses built on it.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+#include "Dataflow.h"
+#include "Function.h"
+#include "decompiler/ObjectFile/LinkedObjectFile.h"
+#include "decompiler/Disasm/InstructionMatching.h"
+
+void BitSet::set_all() {
+  for (auto& w : m_words) {
+    w = ~uint64_t(0);
+  }
+  // keep bits past the end clear, so == and count work.
+  if (m_size % 64) {
+    m_words.back() &= (uint64_t(1) << (m_size % 64)) - 1;
+  }
+}
+
+void BitSet::clear_all() {
+  for (auto& w : m_words) {
+    w = 0;
+  }
+}
+
+int BitSet::count() const {
+  int result = 0;
+  for (auto w : m_words) {
+    result += __builtin_popcountll(w);
+  }
+  return result;
+}
+
+/*!
+ * Add all bits in other, return if this changed.
+ */
+bool BitSet::union_with(const BitSet& other) {
+  assert(other.m_size == m_size);
+  bool changed = false;
+  for (size_t i = 0; i < m_words.size(); i++) {
+    auto old = m_words[i];
+    m_words[i] |= other.m_words[i];
+    changed = changed || (old != m_words[i]);
+  }
+  return changed;
+}
+
+/*!
+ * Remove all bits not in other, return if this changed.
+ */
+bool BitSet::intersect_with(const BitSet& other) {
+  assert(other.m_size == m_size);
+  bool changed = false;
+  for (size_t i = 0; i < m_words.size(); i++) {
+    auto old = m_words[i];
+    m_words[i] &= other.m_words[i];
+    changed = changed || (old != m_words[i]);
+  }
+  return changed;
+}
+
+void BitSet::subtract(const BitSet& other) {
+  assert(other.m_size == m_size);
+  for (size_t i = 0; i < m_words.size(); i++) {
+    m_words[i] &= ~other.m_words[i];
+  }
+}
+
+namespace dataflow {
+int reg_index(const Register& r) {
+  switch (r.get_kind()) {
+    case Reg::GPR:
+      return int(r.get_gpr());
+    case Reg::FPR:
+      return 32 + int(r.get_fpr());
+    default:
+      return -1;
+  }
+}
+
+Register index_reg(int idx) {
+  assert(idx >= 0 && idx < N_REGS);
+  if (idx < 32) {
+    return Register(Reg::GPR, idx);
+  } else {
+    return Register(Reg::FPR, idx - 32);
+  }
+}
+}  // namespace dataflow
+
+namespace {
+uint64_t reg_bit(Reg::Gpr gpr) {
+  return uint64_t(1) << int(gpr);
+}
+
+uint64_t reg_bits(std::initializer_list<Reg::Gpr> gprs) {
+  uint64_t result = 0;
+  for (auto gpr : gprs) {
+    result |= reg_bit(gpr);
+  }
+  return result;
+}
+
+// the GOAL calling convention: arguments in a0 - t3, the result in v0, and the temps are clobbered.
+const uint64_t CALL_ARGS = reg_bits({Reg::A0, Reg::A1, Reg::A2, Reg::A3, Reg::T0, Reg::T1, Reg::T2,
+                                     Reg::T3});
+const uint64_t CALL_CLOBBERS =
+    reg_bits({Reg::AT, Reg::V0, Reg::V1, Reg::A0, Reg::A1, Reg::A2, Reg::A3, Reg::T0, Reg::T1,
+              Reg::T2, Reg::T3, Reg::T4, Reg::T5, Reg::T6, Reg::T7, Reg::T8, Reg::T9, Reg::RA});
+
+// the return value, and the registers the epilogue doesn't touch, are live when returning.
+const uint64_t LIVE_AT_EXIT =
+    reg_bits({Reg::V0, Reg::S0, Reg::S1, Reg::S2, Reg::S3, Reg::S4, Reg::S5, Reg::S6, Reg::S7,
+              Reg::GP, Reg::SP, Reg::FP});
+
+/*!
+ * Get the register bit for an atom, or 0 if it isn't a tracked register. r0 is never tracked.
+ */
+uint64_t atom_bit(const InstructionAtom& atom) {
+  if (atom.kind != InstructionAtom::REGISTER) {
+    return 0;
+  }
+  int idx = dataflow::reg_index(atom.get_reg());
+  if (idx <= 0) {
+    return 0;
+  }
+  return uint64_t(1) << idx;
+}
+
+/*!
+ * Call f on the index of each set bit.
+ */
+template <typename Func>
+void for_each_reg(uint64_t regs, Func f) {
+  while (regs) {
+    f(__builtin_ctzll(regs));
+    regs &= regs - 1;
+  }
+}
+}  // namespace
+
+/*!
+ * Solve a dataflow problem by iterating over the blocks until nothing changes. Blocks are visited
+ * in order for forward problems and in reverse for backward problems, which is usually close to
+ * the order values flow in.
+ */
+DataflowSolution solve_dataflow(const DataflowProblem& problem,
+                                const std::vector<BasicBlock>& blocks) {
+  DataflowSolution result;
+  int n_blocks = int(blocks.size());
+  bool forward = problem.direction == DataflowProblem::Direction::FORWARD;
+  bool is_union = problem.meet == DataflowProblem::Meet::UNION;
+
+  BitSet initial(problem.n_bits);
+  if (!is_union) {
+    initial.set_all();
+  }
+  result.in.resize(n_blocks, initial);
+  result.out.resize(n_blocks, initial);
+
+  // for forward problems, "in" is the meet of the predecessors and "out" is the transfer. For
+  // backward problems, it's the opposite.
+  auto& meet_of = forward ? result.in : result.out;
+  auto& transfer_of = forward ? result.out : result.in;
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    result.iterations++;
+    for (int step = 0; step < n_blocks; step++) {
+      int b = forward ? step : n_blocks - 1 - step;
+      const auto& block = blocks.at(b);
+      const auto& neighbors = forward ? block.pred : block.succ;
+
+      BitSet meet(problem.n_bits);
+      bool first = true;
+      auto add = [&](const BitSet& x) {
+        if (first) {
+          meet = x;
+          first = false;
+        } else if (is_union) {
+          meet.union_with(x);
+        } else {
+          meet.intersect_with(x);
+        }
+      };
+
+      for (auto n : neighbors) {
+        add(transfer_of.at(n));
+      }
+
+      // the entry block is the first block, and exits are blocks without successors.
+      if ((forward && b == 0) || (!forward && block.succ.empty())) {
+        add(problem.boundary);
+      }
+      meet_of.at(b) = meet;
+
+      BitSet transferred = meet;
+      transferred.subtract(problem.kill.at(b));
+      transferred.union_with(problem.gen.at(b));
+      if (transferred != transfer_of.at(b)) {
+        transfer_of.at(b) = transferred;
+        changed = true;
+      }
+    }
+  }
+
+  return result;
+}
+
+bool ConstValue::operator==(const ConstValue& other) const {
+  return kind == other.kind && integer == other.integer && label == other.label &&
+         sym == other.sym;
+}
+
+std::string ConstValue::print(const LinkedObjectFile& file) const {
+  switch (kind) {
+    case Kind::UNKNOWN:
+      return "?";
+    case Kind::INTEGER:
+      return std::to_string(integer);
+    case Kind::LABEL_HI:
+      return "(hi " + file.get_label_name(label) + ")";
+    case Kind::LABEL:
+      return file.get_label_name(label);
+    case Kind::SYM_PTR:
+      return "'" + sym;
+    case Kind::SYM_VAL:
+      return sym;
+    default:
+      assert(false);
+      return {};
+  }
+}
+
+/*!
+ * Run all analyses on a function. The function must have its basic blocks linked.
+ */
+void FunctionDataflow::run(const Function& func) {
+  int n_instrs = int(func.instructions.size());
+  stats = Stats();
+  stats.blocks = int(func.basic_blocks.size());
+
+  m_effects.clear();
+  m_effects.resize(n_instrs);
+  m_live_before.clear();
+  m_live_before.resize(n_instrs, 0);
+  m_live_after.clear();
+  m_live_after.resize(n_instrs, 0);
+  m_src_defs.clear();
+  m_src_defs.resize(n_instrs);
+  for (int i = 0; i < n_instrs; i++) {
+    m_src_defs.at(i).resize(func.instructions.at(i).n_src, dataflow::DEF_MULTIPLE);
+  }
+  m_dst_values.clear();
+  m_dst_values.resize(n_instrs);
+
+  find_effects(func);
+  find_liveness(func);
+  find_reaching_defs(func);
+  find_constants(func);
+  m_ran = true;
+}
+
+bool FunctionDataflow::is_live_after(int instr, const Register& reg) const {
+  int idx = dataflow::reg_index(reg);
+  if (idx < 0) {
+    return false;
+  }
+  return (m_live_after.at(instr) >> idx) & 1;
+}
+
+const ConstValue& FunctionDataflow::src_value(int instr, int src_idx) const {
+  int def = src_def(instr, src_idx);
+  if (def < 0) {
+    return m_unknown;
+  }
+  return m_dst_values.at(def);
+}
+
+/*!
+ * Find the registers used and defined by each instruction in a basic block.
+ */
+void FunctionDataflow::find_effects(const Function& func) {
+  for (const auto& block : func.basic_blocks) {
+    // the first word of a function is the type tag, not an instruction.
+    int start = std::max(block.start_word, 1);
+    for (int i = start; i < block.end_word; i++) {
+      const auto& instr = func.instructions.at(i);
+      auto& effect = m_effects.at(i);
+      stats.instructions++;
+
+      for (int j = 0; j < instr.n_src; j++) {
+        effect.use |= atom_bit(instr.src[j]);
+      }
+
+      uint64_t def = 0;
+      for (int j = 0; j < instr.n_dst; j++) {
+        def |= atom_bit(instr.dst[j]);
+      }
+
+      if (instr.kind == InstructionKind::MOVN || instr.kind == InstructionKind::MOVZ) {
+        effect.may_def |= def;
+      } else {
+        effect.def |= def;
+      }
+
+      // the delay slot of a likely branch only runs if the branch is taken.
+      if (i > start && is_branch(func.instructions.at(i - 1), true)) {
+        effect.may_def |= effect.def;
+        effect.def = 0;
+      }
+
+      // the call happens after the delay slot.
+      if (i > start && func.instructions.at(i - 1).kind == InstructionKind::JALR) {
+        effect.call_use = CALL_ARGS;
+        effect.call_def = CALL_CLOBBERS;
+        effect.call_instr = i - 1;
+      }
+    }
+  }
+}
+
+/*!
+ * Backward liveness of registers. Because there are only 64 registers, the per block sets are
+ * solved with the generic solver, then the per instruction sets use a single word each.
+ */
+void FunctionDataflow::find_liveness(const Function& func) {
+  const auto& blocks = func.basic_blocks;
+  int n_blocks = int(blocks.size());
+
+  uint64_t live_at_exit = LIVE_AT_EXIT;
+  if (!func.prologue.ra_backed_up) {
+    live_at_exit |= reg_bit(Reg::RA);
+  }
+
+  // live before = use | (live after - def), applied to the call effects, then the instruction.
+  auto step_back = [&](const Effect& e, uint64_t live) {
+    live = (live & ~e.call_def) | e.call_use;
+    return (live & ~e.def) | e.use;
+  };
+
+  DataflowProblem problem;
+  problem.direction = DataflowProblem::Direction::BACKWARD;
+  problem.n_bits = dataflow::N_REGS;
+  problem.boundary = BitSet(dataflow::N_REGS);
+  for_each_reg(live_at_exit, [&](int r) { problem.boundary.set(r); });
+
+  for (int b = 0; b < n_blocks; b++) {
+    // uses not defined earlier in the block, and registers certainly defined in the block.
+    uint64_t gen = 0, kill = 0;
+    for (int i = blocks[b].end_word; i-- > std::max(blocks[b].start_word, 1);) {
+      const auto& e = m_effects.at(i);
+      gen = (gen & ~e.call_def) | e.call_use;
+      kill |= e.call_def;
+      gen = (gen & ~e.def) | e.use;
+      kill |= e.def;
+    }
+
+    BitSet gen_set(dataflow::N_REGS), kill_set(dataflow::N_REGS);
+    for_each_reg(gen, [&](int r) { gen_set.set(r); });
+    for_each_reg(kill & ~gen, [&](int r) { kill_set.set(r); });
+    problem.gen.push_back(gen_set);
+    problem.kill.push_back(kill_set);
+  }
+
+  auto solution = solve_dataflow(problem, blocks);
+  stats.iterations += solution.iterations;
+
+  for (int b = 0; b < n_blocks; b++) {
+    uint64_t live = 0;
+    solution.out.at(b).for_each([&](int r) { live |= uint64_t(1) << r; });
+    for (int i = blocks[b].end_word; i-- > std::max(blocks[b].start_word, 1);) {
+      m_live_after.at(i) = live;
+      live = step_back(m_effects.at(i), live);
+      m_live_before.at(i) = live;
+    }
+  }
+}
+
+/*!
+ * Forward reaching definitions. Each register has a definition site at the function entry, plus
+ * one for each instruction that writes it. Then the unique definition reaching each register
+ * source of each instruction is recorded.
+ */
+void FunctionDataflow::find_reaching_defs(const Function& func) {
+  const auto& blocks = func.basic_blocks;
+  int n_blocks = int(blocks.size());
+  m_def_sites.clear();
+  m_def_sites_of_reg.clear();
+  m_def_sites_of_reg.resize(dataflow::N_REGS);
+
+  auto add_site = [&](int instr, int reg, bool from_call) {
+    m_def_sites_of_reg.at(reg).push_back(int(m_def_sites.size()));
+    m_def_sites.push_back({instr, reg, from_call});
+  };
+
+  for (int r = 0; r < dataflow::N_REGS; r++) {
+    add_site(-1, r, false);
+  }
+
+  // sites for each instruction, in the order they happen.
+  std::vector<int> first_site_of_instr(func.instructions.size() + 1, 0);
+  for (int i = 0; i < int(func.instructions.size()); i++) {
+    first_site_of_instr.at(i) = int(m_def_sites.size());
+    const auto& e = m_effects.at(i);
+    for_each_reg(e.def | e.may_def, [&](int r) { add_site(i, r, false); });
+    for_each_reg(e.call_def, [&](int r) { add_site(e.call_instr, r, true); });
+  }
+  first_site_of_instr.back() = int(m_def_sites.size());
+  int n_sites = int(m_def_sites.size());
+  stats.def_sites = n_sites - dataflow::N_REGS;
+
+  std::vector<BitSet> sites_of_reg;
+  for (int r = 0; r < dataflow::N_REGS; r++) {
+    sites_of_reg.emplace_back(n_sites);
+    for (auto s : m_def_sites_of_reg.at(r)) {
+      sites_of_reg.back().set(s);
+    }
+  }
+
+  // apply the definitions of an instruction to the set of reaching sites
+  auto step = [&](int i, BitSet& reaching) {
+    for (int s = first_site_of_instr.at(i); s < first_site_of_instr.at(i + 1); s++) {
+      const auto& site = m_def_sites.at(s);
+      const auto& e = m_effects.at(i);
+      if (site.from_call || ((e.def >> site.reg) & 1)) {
+        reaching.subtract(sites_of_reg.at(site.reg));
+      }
+      reaching.set(s);
+    }
+  };
+
+  DataflowProblem problem;
+  problem.direction = DataflowProblem::Direction::FORWARD;
+  problem.n_bits = n_sites;
+  problem.boundary = BitSet(n_sites);
+  for (int r = 0; r < dataflow::N_REGS; r++) {
+    problem.boundary.set(r);
+  }
+
+  for (int b = 0; b < n_blocks; b++) {
+    BitSet gen(n_sites), kill(n_sites);
+    for (int i = std::max(blocks[b].start_word, 1); i < blocks[b].end_word; i++) {
+      step(i, gen);
+      const auto& e = m_effects.at(i);
+      for_each_reg(e.def | e.call_def, [&](int r) { kill.union_with(sites_of_reg.at(r)); });
+    }
+    kill.subtract(gen);
+    problem.gen.push_back(gen);
+    problem.kill.push_back(kill);
+  }
+
+  auto solution = solve_dataflow(problem, blocks);
+  stats.iterations += solution.iterations;
+
+  for (int b = 0; b < n_blocks; b++) {
+    BitSet reaching = solution.in.at(b);
+    for (int i = std::max(blocks[b].start_word, 1); i < blocks[b].end_word; i++) {
+      const auto& instr = func.instructions.at(i);
+      auto& defs = m_src_defs.at(i);
+      for (int j = 0; j < instr.n_src; j++) {
+        uint64_t bit = atom_bit(instr.src[j]);
+        if (!bit) {
+          continue;
+        }
+        int reg = __builtin_ctzll(bit);
+        int found = -1;
+        int count = 0;
+        for (auto s : m_def_sites_of_reg.at(reg)) {
+          if (reaching.get(s)) {
+            found = s;
+            count++;
+          }
+        }
+        stats.uses++;
+        if (count == 1) {
+          stats.uses_with_single_def++;
+          const auto& site = m_def_sites.at(found);
+          if (site.instr == -1) {
+            defs.at(j) = dataflow::DEF_ENTRY;
+          } else if (!site.from_call && !((m_effects.at(site.instr).may_def >> reg) & 1)) {
+            defs.at(j) = site.instr;
+          }
+        }
+      }
+      step(i, reaching);
+    }
+  }
+}
+
+/*!
+ * Evaluate the value an instruction writes to its destination, from the values of its sources.
+ */
+ConstValue FunctionDataflow::eval(const Instruction& instr, int instr_idx) const {
+  ConstValue result;
+
+  auto src_is_reg = [&](int idx, Reg::Gpr gpr) {
+    return idx < instr.n_src && instr.src[idx].kind == InstructionAtom::REGISTER &&
+           instr.src[idx].get_reg() == make_gpr(gpr);
+  };
+
+  // the value of a register source, r0 is always 0.
+  auto value_of = [&](int idx) {
+    if (src_is_reg(idx, Reg::R0)) {
+      ConstValue zero;
+      zero.kind = ConstValue::Kind::INTEGER;
+      return zero;
+    }
+    return src_value(instr_idx, idx);
+  };
+
+  switch (instr.kind) {
+    case InstructionKind::LUI:
+      if (instr.src[0].kind == InstructionAtom::IMM) {
+        result.kind = ConstValue::Kind::INTEGER;
+        result.integer = int32_t(uint32_t(instr.src[0].get_imm()) << 16);
+      } else if (instr.src[0].kind == InstructionAtom::LABEL) {
+        result.kind = ConstValue::Kind::LABEL_HI;
+        result.label = instr.src[0].get_label();
+      }
+      break;
+    case InstructionKind::ORI: {
+      auto base = value_of(0);
+      if (base.kind == ConstValue::Kind::INTEGER && instr.src[1].kind == InstructionAtom::IMM) {
+        result = base;
+        result.integer |= (instr.src[1].get_imm() & 0xffff);
+      } else if (base.kind == ConstValue::Kind::LABEL_HI &&
+                 instr.src[1].kind == InstructionAtom::LABEL &&
+                 instr.src[1].get_label() == base.label) {
+        result.kind = ConstValue::Kind::LABEL;
+        result.label = base.label;
+      }
+    } break;
+    case InstructionKind::ADDIU:
+    case InstructionKind::DADDIU:
+      if (src_is_reg(0, Reg::S7) && instr.src[1].kind == InstructionAtom::IMM_SYM) {
+        result.kind = ConstValue::Kind::SYM_PTR;
+        result.sym = instr.src[1].get_sym();
+      } else if (instr.src[1].kind == InstructionAtom::IMM) {
+        auto base = value_of(0);
+        if (base.kind == ConstValue::Kind::INTEGER) {
+          result = base;
+          result.integer += instr.src[1].get_imm();
+          if (instr.kind == InstructionKind::ADDIU) {
+            result.integer = int32_t(result.integer);
+          }
+        }
+      }
+      break;
+    case InstructionKind::LW:
+    case InstructionKind::LWU:
+    case InstructionKind::LD:
+      if (instr.src[0].kind == InstructionAtom::IMM_SYM && src_is_reg(1, Reg::S7)) {
+        result.kind = ConstValue::Kind::SYM_VAL;
+        result.sym = instr.src[0].get_sym();
+      }
+      break;
+    case InstructionKind::OR:
+    case InstructionKind::DADDU:
+      // register moves
+      if (src_is_reg(1, Reg::R0)) {
+        result = value_of(0);
+      } else if (src_is_reg(0, Reg::R0)) {
+        result = value_of(1);
+      }
+      break;
+    default:
+      break;
+  }
+
+  return result;
+}
+
+/*!
+ * Propagate constants through the reaching definitions. Values only go from unknown to known, so
+ * this stops once a pass over the function finds nothing new.
+ */
+void FunctionDataflow::find_constants(const Function& func) {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const auto& block : func.basic_blocks) {
+      for (int i = std::max(block.start_word, 1); i < block.end_word; i++) {
+        const auto& instr = func.instructions.at(i);
+        if (instr.n_dst != 1 || !atom_bit(instr.dst[0])) {
+          continue;
+        }
+        auto value = eval(instr, i);
+        if (value != m_dst_values.at(i)) {
+          m_dst_values.at(i) = value;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  for (auto& v : m_dst_values) {
+    if (v.is_known()) {
+      stats.constants++;
+    }
+  }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+/*!
+ * @file Dataflow.h
+ * A generic bitset dataflow solver over the basic blocks of a Function, and the analyses built on
+ * it: register liveness, reaching definitions, and propagation of constants made by lui/ori pairs
+ * and s7-relative symbol loads.
+ *
+ * Everything here only reads the Function and LinkedObjectFile, so functions can be analyzed in
+ * parallel.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "decompiler/Disasm/Instruction.h"
+
+class LinkedObjectFile;
+class Function;
+struct BasicBlock;
+
+/*!
+ * A set of integers in [0, size), stored as bits.
+ */
+class BitSet {
+ public:
+  BitSet() = default;
+  explicit BitSet(int size) : m_size(size), m_words((size + 63) / 64, 0) {}
+
+  int size() const { return m_size; }
+  bool get(int idx) const { return (m_words[idx / 64] >> (idx % 64)) & 1; }
+  void set(int idx) { m_words[idx / 64] |= (uint64_t(1) << (idx % 64)); }
+  void clear(int idx) { m_words[idx / 64] &= ~(uint64_t(1) << (idx % 64)); }
+  void set_all();
+  void clear_all();
+  int count() const;
+
+  bool union_with(const BitSet& other);
+  bool intersect_with(const BitSet& other);
+  void subtract(const BitSet& other);
+  bool operator==(const BitSet& other) const { return m_words == other.m_words; }
+  bool operator!=(const BitSet& other) const { return m_words != other.m_words; }
+
+  /*!
+   * Call f on the index of each bit that is set.
+   */
+  template <typename Func>
+  void for_each(Func f) const {
+    for (size_t w = 0; w < m_words.size(); w++) {
+      uint64_t word = m_words[w];
+      while (word) {
+        int bit = __builtin_ctzll(word);
+        f(int(w * 64) + bit);
+        word &= word - 1;
+      }
+    }
+  }
+
+ private:
+  int m_size = 0;
+  std::vector<uint64_t> m_words;
+};
+
+/*!
+ * The registers tracked by dataflow: the 32 GPRs, then the 32 FPRs. Other registers (VU, COP0)
+ * are ignored.
+ */
+namespace dataflow {
+constexpr int N_REGS = 64;
+int reg_index(const Register& r);  // -1 if not tracked
+Register index_reg(int idx);
+
+// results of FunctionDataflow::src_def
+constexpr int DEF_MULTIPLE = -1;  // more than one definition reaches, or not a tracked register
+constexpr int DEF_ENTRY = -2;     // the value the register had when the function was called
+}  // namespace dataflow
+
+/*!
+ * A generic dataflow problem with a bitset lattice. The transfer function of each block is
+ * out = gen | (in - kill) for forward problems, and in = gen | (out - kill) for backward problems.
+ */
+struct DataflowProblem {
+  enum class Direction { FORWARD, BACKWARD } direction = Direction::FORWARD;
+  enum class Meet { UNION, INTERSECTION } meet = Meet::UNION;
+  int n_bits = 0;
+  std::vector<BitSet> gen, kill;  // per block
+  BitSet boundary;                // value at the function entry (forward) or exits (backward)
+};
+
+struct DataflowSolution {
+  std::vector<BitSet> in, out;  // per block
+  int iterations = 0;           // passes over the blocks until nothing changed
+};
+
+DataflowSolution solve_dataflow(const DataflowProblem& problem,
+                                const std::vector<BasicBlock>& blocks);
+
+/*!
+ * A value known at compile time.
+ */
+struct ConstValue {
+  enum class Kind {
+    UNKNOWN,   // not a constant
+    INTEGER,   // integer, sign extended
+    LABEL_HI,  // upper half of the address of a label (lui)
+    LABEL,     // address of a label (lui/ori pair)
+    SYM_PTR,   // address of a symbol (daddiu x, s7, sym)
+    SYM_VAL,   // the value of a symbol (lw x, sym(s7))
+  } kind = Kind::UNKNOWN;
+  int64_t integer = 0;  // INTEGER
+  int label = -1;       // LABEL_HI, LABEL
+  std::string sym;      // SYM_PTR, SYM_VAL
+
+  bool is_known() const { return kind != Kind::UNKNOWN; }
+  bool operator==(const ConstValue& other) const;
+  bool operator!=(const ConstValue& other) const { return !(*this == other); }
+  std::string print(const LinkedObjectFile& file) const;
+};
+
+/*!
+ * Dataflow results for a single function, which can be queried per instruction in O(1).
+ * Instruction indices are indices in Function::instructions.
+ */
+class FunctionDataflow {
+ public:
+  void run(const Function& func);
+  bool ran() const { return m_ran; }
+
+  // liveness, as a bit per dataflow::reg_index.
+  uint64_t live_before(int instr) const { return m_live_before.at(instr); }
+  uint64_t live_after(int instr) const { return m_live_after.at(instr); }
+  bool is_live_after(int instr, const Register& reg) const;
+
+  // reaching definitions, for register sources of an instruction. This is the index of the
+  // defining instruction, DEF_ENTRY or DEF_MULTIPLE.
+  int src_def(int instr, int src_idx) const { return m_src_defs.at(instr).at(src_idx); }
+
+  // constants
+  const ConstValue& dst_value(int instr) const { return m_dst_values.at(instr); }
+  const ConstValue& src_value(int instr, int src_idx) const;
+
+  struct Stats {
+    int blocks = 0;
+    int instructions = 0;
+    int def_sites = 0;
+    int iterations = 0;  // of all solves
+    int uses_with_single_def = 0;
+    int uses = 0;
+    int constants = 0;  // instructions with a known dst_value
+  } stats;
+
+ private:
+  void find_effects(const Function& func);
+  void find_liveness(const Function& func);
+  void find_reaching_defs(const Function& func);
+  void find_constants(const Function& func);
+  ConstValue eval(const Instruction& instr, int instr_idx) const;
+
+  // what an instruction does to registers. A function call happens after its delay slot, so
+  // the effects of a jalr on argument and temp registers are attached to its delay slot instead.
+  struct Effect {
+    uint64_t use = 0;       // read by this instruction
+    uint64_t def = 0;       // written by this instruction
+    uint64_t may_def = 0;   // possibly written, like movn or the delay slot of a likely branch
+    uint64_t call_use = 0;  // arguments of a call, read after this instruction
+    uint64_t call_def = 0;  // clobbered by a call, after this instruction
+    int call_instr = -1;    // the jalr, if this is its delay slot
+  };
+  std::vector<Effect> m_effects;
+
+  std::vector<uint64_t> m_live_before, m_live_after;
+  std::vector<std::vector<int>> m_src_defs;
+
+  // reaching definition sites. each is an (instruction, register) pair.
+  struct DefSite {
+    int instr;  // -1 for function entry
+    int reg;
+    bool from_call;  // clobbered by a call, rather than the dst of instr
+  };
+  std::vector<DefSite> m_def_sites;
+  std::vector<std::vector<int>> m_def_sites_of_reg;
+
+  std::vector<ConstValue> m_dst_values;
+  ConstValue m_unknown;
+  bool m_ran = false;
+};
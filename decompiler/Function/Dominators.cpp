@@ -0,0 +1,266 @@
+/*!
+ * @file Dominators.cpp
+ * Dominator trees and loop nesting for the basic blocks of a function.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "Dominators.h"
+#include "BasicBlocks.h"
+
+namespace {
+/*!
+ * Find the blocks reachable from root, in postorder.
+ */
+std::vector<int> postorder(int root, const std::vector<std::vector<int>>& succ) {
+  std::vector<int> result;
+  std::vector<bool> visited(succ.size(), false);
+  std::vector<std::pair<int, size_t>> stack = {{root, 0}};
+  visited.at(root) = true;
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    const auto& s = succ.at(top.first);
+    if (top.second < s.size()) {
+      int next = s.at(top.second++);
+      if (!visited.at(next)) {
+        visited.at(next) = true;
+        stack.emplace_back(next, 0);
+      }
+    } else {
+      result.push_back(top.first);
+      stack.pop_back();
+    }
+  }
+  return result;
+}
+}  // namespace
+
+DominatorTree::DominatorTree(const std::vector<BasicBlock>& blocks, bool post) : m_post_dom(post) {
+  int n_blocks = int(blocks.size());
+
+  // the graph to find dominators in. For post dominators, this is reversed, with a virtual exit.
+  int n_nodes = post ? n_blocks + 1 : n_blocks;
+  std::vector<std::vector<int>> succ(n_nodes), pred(n_nodes);
+  for (int i = 0; i < n_blocks; i++) {
+    succ.at(i) = post ? blocks[i].pred : blocks[i].succ;
+    pred.at(i) = post ? blocks[i].succ : blocks[i].pred;
+    if (post && blocks[i].succ.empty()) {
+      succ.at(n_blocks).push_back(i);
+      pred.at(i).push_back(n_blocks);
+    }
+  }
+
+  m_idom.resize(n_blocks, -1);
+  m_pre.resize(n_blocks, -1);
+  m_post.resize(n_blocks, -1);
+  if (n_blocks == 0) {
+    return;
+  }
+
+  int root = post ? n_blocks : 0;
+  auto order = postorder(root, succ);
+  std::vector<int> po_number(n_nodes, -1);
+  for (int i = 0; i < int(order.size()); i++) {
+    po_number.at(order[i]) = i;
+  }
+
+  std::vector<int> idom(n_nodes, -1);
+  idom.at(root) = root;
+
+  auto intersect = [&](int a, int b) {
+    while (a != b) {
+      while (po_number.at(a) < po_number.at(b)) {
+        a = idom.at(a);
+      }
+      while (po_number.at(b) < po_number.at(a)) {
+        b = idom.at(b);
+      }
+    }
+    return a;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    // reverse postorder, skipping the root
+    for (int i = int(order.size()) - 2; i >= 0; i--) {
+      int node = order[i];
+      int new_idom = -1;
+      for (auto p : pred.at(node)) {
+        if (idom.at(p) == -1) {
+          continue;
+        }
+        new_idom = new_idom == -1 ? p : intersect(p, new_idom);
+      }
+      if (idom.at(node) != new_idom) {
+        idom.at(node) = new_idom;
+        changed = true;
+      }
+    }
+  }
+
+  // number the tree, so dominates is a range check.
+  std::vector<std::vector<int>> children(n_nodes);
+  for (auto node : order) {
+    if (node != root) {
+      children.at(idom.at(node)).push_back(node);
+    }
+  }
+
+  std::vector<int> pre(n_nodes, -1), post_num(n_nodes, -1);
+  int counter = 0;
+  std::vector<std::pair<int, size_t>> stack = {{root, 0}};
+  pre.at(root) = counter++;
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    if (top.second < children.at(top.first).size()) {
+      int child = children.at(top.first).at(top.second++);
+      pre.at(child) = counter++;
+      stack.emplace_back(child, 0);
+    } else {
+      post_num.at(top.first) = counter++;
+      stack.pop_back();
+    }
+  }
+
+  for (int i = 0; i < n_blocks; i++) {
+    m_pre.at(i) = pre.at(i);
+    m_post.at(i) = post_num.at(i);
+    if (i != root && idom.at(i) != -1 && idom.at(i) != n_blocks) {
+      m_idom.at(i) = idom.at(i);
+    }
+  }
+}
+
+/*!
+ * Does a dominate b? A block dominates itself, and unreachable blocks don't dominate anything.
+ */
+bool DominatorTree::dominates(int a, int b) const {
+  if (!reachable(a) || !reachable(b)) {
+    return false;
+  }
+  return m_pre.at(a) <= m_pre.at(b) && m_post.at(b) <= m_post.at(a);
+}
+
+LoopNest::LoopNest(const std::vector<BasicBlock>& blocks, const DominatorTree& dom) {
+  assert(!dom.is_post());
+  int n_blocks = int(blocks.size());
+  m_innermost.resize(n_blocks, -1);
+
+  // find back edges, grouped by header
+  std::vector<int> loop_of_header(n_blocks, -1);
+  for (int src = 0; src < n_blocks; src++) {
+    for (auto dst : blocks[src].succ) {
+      if (dst <= src) {
+        m_backward_edges++;
+      }
+      if (dom.dominates(dst, src)) {
+        if (loop_of_header.at(dst) == -1) {
+          loop_of_header.at(dst) = int(m_loops.size());
+          m_loops.emplace_back();
+          m_loops.back().header = dst;
+        }
+        m_loops.at(loop_of_header.at(dst)).back_edge_sources.push_back(src);
+      }
+    }
+  }
+
+  // a retreating edge in a depth first walk that isn't a back edge means the loop has more than
+  // one way in.
+  {
+    std::vector<int> state(n_blocks, 0);  // 0 = new, 1 = on stack, 2 = done
+    std::vector<std::pair<int, size_t>> stack;
+    if (n_blocks) {
+      stack.emplace_back(0, 0);
+      state.at(0) = 1;
+    }
+    while (!stack.empty()) {
+      auto& top = stack.back();
+      const auto& s = blocks.at(top.first).succ;
+      if (top.second < s.size()) {
+        int src = top.first;
+        int dst = s.at(top.second++);
+        if (state.at(dst) == 0) {
+          state.at(dst) = 1;
+          stack.emplace_back(dst, 0);
+        } else if (state.at(dst) == 1 && !dom.dominates(dst, src)) {
+          m_irreducible = true;
+        }
+      } else {
+        state.at(top.first) = 2;
+        stack.pop_back();
+      }
+    }
+  }
+
+  // find the blocks in each loop, by walking backward from the back edges to the header.
+  std::vector<std::vector<bool>> in_loop;
+  for (auto& loop : m_loops) {
+    std::vector<bool> in(n_blocks, false);
+    in.at(loop.header) = true;
+    std::vector<int> work;
+    for (auto src : loop.back_edge_sources) {
+      if (!in.at(src)) {
+        in.at(src) = true;
+        work.push_back(src);
+      }
+    }
+    while (!work.empty()) {
+      int b = work.back();
+      work.pop_back();
+      for (auto p : blocks.at(b).pred) {
+        if (!in.at(p) && dom.reachable(p)) {
+          in.at(p) = true;
+          work.push_back(p);
+        }
+      }
+    }
+    for (int b = 0; b < n_blocks; b++) {
+      if (in.at(b)) {
+        loop.blocks.push_back(b);
+      }
+    }
+    in_loop.push_back(std::move(in));
+  }
+
+  // outer loops are bigger, so sorting by size puts parents first.
+  std::vector<int> order(m_loops.size());
+  for (int i = 0; i < int(order.size()); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return m_loops[a].blocks.size() > m_loops[b].blocks.size();
+  });
+
+  std::vector<Loop> sorted;
+  std::vector<std::vector<bool>> sorted_in;
+  for (auto i : order) {
+    sorted.push_back(std::move(m_loops[i]));
+    sorted_in.push_back(std::move(in_loop[i]));
+  }
+  m_loops = std::move(sorted);
+
+  // the parent is the smallest other loop containing the header, which is the last one seen.
+  for (int i = 0; i < int(m_loops.size()); i++) {
+    auto& loop = m_loops[i];
+    for (int j = 0; j < i; j++) {
+      if (sorted_in[j].at(loop.header)) {
+        loop.parent = j;
+      }
+    }
+    if (loop.parent != -1) {
+      loop.depth = m_loops.at(loop.parent).depth + 1;
+    }
+    for (auto b : loop.blocks) {
+      m_innermost.at(b) = i;
+    }
+  }
+}
+
+int LoopNest::max_depth() const {
+  int result = 0;
+  for (auto& loop : m_loops) {
+    result = std::max(result, loop.depth);
+  }
+  return result;
+}
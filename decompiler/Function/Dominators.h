@@ -0,0 +1,76 @@
+#pragma once
+
+/*!
+ * @file Dominators.h
+ * Dominator trees and loop nesting for the basic blocks of a function. These need the succ/pred
+ * of the blocks, from link_basic_blocks.
+ */
+
+#include <vector>
+
+struct BasicBlock;
+
+/*!
+ * Immediate dominators of basic blocks, found with the iterative algorithm from Cooper, Harvey and
+ * Kennedy's "A Simple, Fast Dominance Algorithm". For post dominators, the edges are reversed and
+ * all blocks without a successor are joined to a virtual exit.
+ * After construction, dominance checks are O(1) using the order of a walk of the tree.
+ */
+class DominatorTree {
+ public:
+  explicit DominatorTree(const std::vector<BasicBlock>& blocks, bool post = false);
+
+  /*!
+   * The immediate dominator of a block, or -1 for the first block (or blocks only post dominated
+   * by the virtual exit) and blocks which can't be reached.
+   */
+  int idom(int block) const { return m_idom.at(block); }
+  bool reachable(int block) const { return m_pre.at(block) != -1; }
+  bool dominates(int a, int b) const;
+  bool is_post() const { return m_post_dom; }
+
+ private:
+  bool m_post_dom = false;
+  std::vector<int> m_idom;
+  std::vector<int> m_pre, m_post;  // order of entering and leaving a block in a walk of the tree
+};
+
+/*!
+ * A natural loop: the header and all blocks that can reach a back edge to it without going through
+ * the header. Back edges with the same header are combined into one loop.
+ */
+struct Loop {
+  int header = -1;
+  std::vector<int> blocks;  // sorted, includes the header
+  std::vector<int> back_edge_sources;
+  int parent = -1;  // index of the loop this is nested in, or -1
+  int depth = 1;    // 1 for outermost loops
+};
+
+/*!
+ * The loops of a function, as a forest. Parents always come before their children in loops().
+ */
+class LoopNest {
+ public:
+  LoopNest(const std::vector<BasicBlock>& blocks, const DominatorTree& dom);
+  const std::vector<Loop>& loops() const { return m_loops; }
+  int innermost_loop(int block) const { return m_innermost.at(block); }  // -1 if not in a loop
+  int max_depth() const;
+
+  /*!
+   * Is there a cycle that doesn't go through a single header? Those aren't in loops().
+   */
+  bool irreducible() const { return m_irreducible; }
+
+  /*!
+   * The number of edges that go to a block at or before their source in memory. Every cycle has
+   * at least one of these.
+   */
+  int backward_edges() const { return m_backward_edges; }
+
+ private:
+  std::vector<Loop> m_loops;
+  std::vector<int> m_innermost;
+  bool m_irreducible = false;
+  int m_backward_edges = 0;
+};
@@ -549,4 +549,86 @@ void Function::find_method_defs(LinkedObjectFile& file) {
       }
     }
   }
-}
\ No newline at end of file
+}
+
+/*!
+ * A word of this function, with its link replaced by something that doesn't depend on the layout
+ * of the object file: the symbol for symbol links, and the offset in this function for label
+ * links. Labels outside of the function are all treated the same.
+ */
+uint64_t Function::normalized_word(const LinkedObjectFile& file, int seg, int word_idx) const {
+  const auto& word = file.words_by_seg.at(seg).at(start_word + word_idx);
+  uint64_t kind = uint64_t(word.kind()) << 56;
+  switch (word.kind()) {
+    case LinkedWord::PLAIN_DATA:
+      return kind | word.data;
+    case LinkedWord::PTR:
+    case LinkedWord::HI_PTR:
+    case LinkedWord::LO_PTR: {
+      // the low 16 bits of a hi/lo word are the part of the address filled in by the linker.
+      uint64_t data = word.kind() == LinkedWord::PTR ? 0 : (word.data & 0xffff0000);
+      const auto& label = file.labels.at(word.label_id());
+      int start_byte = start_word * 4;
+      int end_byte = end_word * 4;
+      uint64_t target = 0xffffff;
+      if (label.target_segment == seg && label.offset >= start_byte && label.offset < end_byte) {
+        target = label.offset - start_byte;
+      }
+      return kind | (target << 32) | data;
+    }
+    case LinkedWord::SYM_OFFSET:
+      return kind | (uint64_t(word.symbol_id()) << 32) | (word.data & 0xffff0000);
+    default:
+      return kind | (uint64_t(word.symbol_id()) << 32);
+  }
+}
+
+/*!
+ * Hash of the normalized words of this function.
+ */
+uint64_t Function::code_hash(const LinkedObjectFile& file, int seg) const {
+  // FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (int i = 0; i < end_word - start_word; i++) {
+    hash ^= normalized_word(file, seg, i);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/*!
+ * Does the other function have the same normalized words as this one?
+ */
+bool Function::same_code(const LinkedObjectFile& file,
+                         int seg,
+                         const Function& other,
+                         const LinkedObjectFile& other_file,
+                         int other_seg) const {
+  if (end_word - start_word != other.end_word - other.start_word) {
+    return false;
+  }
+  for (int i = 0; i < end_word - start_word; i++) {
+    if (normalized_word(file, seg, i) != other.normalized_word(other_file, other_seg, i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * Use the basic blocks, prologue and control flow from a function with the same code. The
+ * dominator trees, loops and CFG aren't modified after they are built, so they are shared.
+ */
+void Function::copy_analysis_from(const Function& other) {
+  suspected_asm = other.suspected_asm;
+  basic_blocks = other.basic_blocks;
+  dominators = other.dominators;
+  post_dominators = other.post_dominators;
+  loop_nest = other.loop_nest;
+  cfg = other.cfg;
+  prologue_start = other.prologue_start;
+  prologue_end = other.prologue_end;
+  epilogue_start = other.epilogue_start;
+  epilogue_end = other.epilogue_end;
+  prologue = other.prologue;
+}
@@ -8,6 +8,8 @@
 #include "decompiler/Disasm/Instruction.h"
 #include "BasicBlocks.h"
 #include "CfgVtx.h"
+#include "Dataflow.h"
+#include "Dominators.h"
 
 struct FunctionName {
   enum class FunctionKind {
@@ -63,6 +65,16 @@ class Function {
   void find_global_function_defs(LinkedObjectFile& file);
   void find_method_defs(LinkedObjectFile& file);
 
+  // functions with the same code, ignoring where labels and symbols ended up in memory, get the
+  // same analysis, so it can be shared between versions of an object file.
+  uint64_t code_hash(const LinkedObjectFile& file, int seg) const;
+  bool same_code(const LinkedObjectFile& file,
+                 int seg,
+                 const Function& other,
+                 const LinkedObjectFile& other_file,
+                 int other_seg) const;
+  void copy_analysis_from(const Function& other);
+
   int segment = -1;
   int start_word = -1;
   int end_word = -1;  // not inclusive, but does include padding.
@@ -73,7 +85,11 @@ class Function {
 
   std::vector<Instruction> instructions;
   std::vector<BasicBlock> basic_blocks;
+  std::shared_ptr<DominatorTree> dominators = nullptr;
+  std::shared_ptr<DominatorTree> post_dominators = nullptr;
+  std::shared_ptr<LoopNest> loop_nest = nullptr;
   std::shared_ptr<ControlFlowGraph> cfg = nullptr;
+  std::shared_ptr<FunctionDataflow> dataflow = nullptr;
 
   int prologue_start = -1;
   int prologue_end = -1;
@@ -115,6 +131,7 @@ class Function {
 
  private:
   void check_epilogue(const LinkedObjectFile& file);
+  uint64_t normalized_word(const LinkedObjectFile& file, int seg, int word_idx) const;
 };
 
 #endif  // NEXT_FUNCTION_H
@@ -0,0 +1,129 @@
+/*!
+ * @file DgoDecompressor.cpp
+ * Decompression of LZO compressed ("oZlB") DGO files from Jak 2, using multiple threads.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "DgoDecompressor.h"
+#include "third-party/minilzo/minilzo.h"
+
+namespace {
+uint32_t read_u32(const std::vector<uint8_t>& data, size_t offset) {
+  assert(offset + 4 <= data.size());
+  uint32_t result;
+  memcpy(&result, data.data() + offset, 4);
+  return result;
+}
+}  // namespace
+
+/*!
+ * Does this file start with the "oZlB" header of a compressed DGO?
+ */
+bool DgoDecompressor::is_compressed(const std::vector<uint8_t>& data) {
+  return data.size() >= 8 && !memcmp(data.data(), "oZlB", 4);
+}
+
+DgoDecompressor::DgoDecompressor(const std::vector<uint8_t>& compressed) : m_input(compressed) {
+  if (lzo_init() != LZO_E_OK) {
+    assert(false);
+  }
+  index_chunks();
+  m_chunk_done.resize(m_chunks.size(), false);
+
+  int n_threads = std::max(1, int(std::thread::hardware_concurrency()));
+  n_threads = std::max(1, std::min(n_threads, int(m_chunks.size())));
+  for (int i = 0; i < n_threads; i++) {
+    m_threads.emplace_back([this]() { worker(); });
+  }
+}
+
+DgoDecompressor::~DgoDecompressor() {
+  for (auto& t : m_threads) {
+    t.join();
+  }
+}
+
+/*!
+ * Find all chunks and where their output goes. Each chunk has a size, then its data, then padding
+ * to 4 bytes. A chunk of MAX_CHUNK_SIZE or more is stored uncompressed.
+ */
+void DgoDecompressor::index_chunks() {
+  // skip "oZlB"
+  uint32_t decompressed_size = read_u32(m_input, 4);
+  m_output.resize(decompressed_size);
+
+  size_t seek = 8;
+  uint32_t output_offset = 0;
+  while (output_offset < decompressed_size) {
+    // seek past alignment bytes and read the next chunk size
+    uint32_t chunk_size = 0;
+    while (!chunk_size) {
+      chunk_size = read_u32(m_input, seek);
+      seek += 4;
+    }
+
+    Chunk chunk;
+    chunk.src_offset = seek;
+    chunk.dst_offset = output_offset;
+    chunk.dst_size = std::min(uint32_t(MAX_CHUNK_SIZE), decompressed_size - output_offset);
+    if (chunk_size < MAX_CHUNK_SIZE) {
+      chunk.src_size = chunk_size;
+      seek += chunk_size;
+    } else {
+      // sometimes chunk_size is bigger than MAX, but we should still use max.
+      seek += MAX_CHUNK_SIZE;
+    }
+    assert(seek <= m_input.size());
+    m_chunks.push_back(chunk);
+    output_offset += chunk.dst_size;
+
+    while (seek % 4) {
+      seek++;
+    }
+  }
+}
+
+/*!
+ * Decompress chunks until there are none left. Chunks are taken in order, so the output tends to
+ * be finished from the start.
+ */
+void DgoDecompressor::worker() {
+  for (int i = m_next_chunk++; i < int(m_chunks.size()); i = m_next_chunk++) {
+    const auto& chunk = m_chunks[i];
+    uint8_t* dst = m_output.data() + chunk.dst_offset;
+    if (chunk.src_size) {
+      lzo_uint bytes_written = chunk.dst_size;
+      auto lzo_rv = lzo1x_decompress_safe(m_input.data() + chunk.src_offset, chunk.src_size, dst,
+                                          &bytes_written, nullptr);
+      assert(lzo_rv == LZO_E_OK);
+      assert(bytes_written == chunk.dst_size);
+      (void)lzo_rv;
+    } else {
+      memcpy(dst, m_input.data() + chunk.src_offset, chunk.dst_size);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_chunk_done.at(i) = true;
+    while (m_ready_chunks < int(m_chunks.size()) && m_chunk_done.at(m_ready_chunks)) {
+      m_ready_chunks++;
+    }
+    if (m_ready_chunks == int(m_chunks.size())) {
+      m_decompress_ms = m_timer.getMs();
+    }
+    m_cv.notify_all();
+  }
+}
+
+/*!
+ * Wait until the output bytes before end have been decompressed.
+ */
+void DgoDecompressor::wait_for(size_t end) {
+  assert(end <= m_output.size());
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cv.wait(lock, [&]() {
+    return m_ready_chunks == int(m_chunks.size()) ||
+           m_chunks.at(m_ready_chunks).dst_offset >= end;
+  });
+}
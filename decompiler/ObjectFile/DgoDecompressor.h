@@ -0,0 +1,69 @@
+#pragma once
+
+/*!
+ * @file DgoDecompressor.h
+ * Decompression of LZO compressed ("oZlB") DGO files from Jak 2, using multiple threads.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "common/util/Timer.h"
+
+/*!
+ * A compressed DGO is a sequence of chunks, each of which is either LZO compressed or stored, and
+ * all but the last decompress to MAX_CHUNK_SIZE bytes. The chunks are found in one pass over their
+ * headers, then decompressed by worker threads directly into the output buffer, in order.
+ * Bytes at the start of the output can be used while later chunks are still being decompressed.
+ */
+class DgoDecompressor {
+ public:
+  static constexpr int MAX_CHUNK_SIZE = 0x8000;
+
+  static bool is_compressed(const std::vector<uint8_t>& data);
+
+  // starts decompressing. compressed must outlive this.
+  explicit DgoDecompressor(const std::vector<uint8_t>& compressed);
+  ~DgoDecompressor();
+  DgoDecompressor(const DgoDecompressor&) = delete;
+  DgoDecompressor& operator=(const DgoDecompressor&) = delete;
+
+  /*!
+   * The output buffer. The bytes are only valid once wait_for has returned for them.
+   */
+  std::vector<uint8_t>& data() { return m_output; }
+
+  void wait_for(size_t end);
+  void wait_for_all() { wait_for(m_output.size()); }
+
+  int chunk_count() const { return int(m_chunks.size()); }
+  int thread_count() const { return int(m_threads.size()); }
+  double decompress_ms() const { return m_decompress_ms; }  // only valid after wait_for_all
+
+ private:
+  struct Chunk {
+    uint32_t src_offset = 0;
+    uint32_t src_size = 0;  // 0 if stored uncompressed
+    uint32_t dst_offset = 0;
+    uint32_t dst_size = 0;
+  };
+
+  void index_chunks();
+  void worker();
+
+  const std::vector<uint8_t>& m_input;
+  std::vector<uint8_t> m_output;
+  std::vector<Chunk> m_chunks;
+
+  std::atomic<int> m_next_chunk{0};
+  std::vector<uint8_t> m_chunk_done;  // guarded by m_mutex
+  int m_ready_chunks = 0;             // all chunks before this are done. guarded by m_mutex
+  double m_decompress_ms = 0;         // guarded by m_mutex
+  Timer m_timer;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<std::thread> m_threads;
+};
@@ -18,7 +18,7 @@ void LinkedObjectFile::set_segment_count(int n_segs) {
   assert(segments == 0);
   segments = n_segs;
   words_by_seg.resize(n_segs);
-  label_per_seg_by_offset.resize(n_segs);
+  first_label_per_seg_by_word.resize(n_segs);
   offset_of_data_zone_by_seg.resize(n_segs);
   functions_by_seg.resize(n_segs);
 }
@@ -35,24 +35,30 @@ void LinkedObjectFile::push_back_word_to_segment(uint32_t word, int segment) {
  * Will return an existing label if one exists.
  */
 int LinkedObjectFile::get_label_id_for(int seg, int offset) {
-  auto kv = label_per_seg_by_offset.at(seg).find(offset);
-  if (kv == label_per_seg_by_offset.at(seg).end()) {
-    // create a new label
-    int id = labels.size();
-    Label label;
-    label.target_segment = seg;
-    label.offset = offset;
-    label.name = "L" + std::to_string(id);
-    label_per_seg_by_offset.at(seg)[offset] = id;
-    labels.push_back(label);
-    return id;
-  } else {
+  int existing = get_label_at(seg, offset);
+  if (existing != -1) {
     // return an existing label
-    auto& label = labels.at(kv->second);
-    assert(label.offset == offset);
-    assert(label.target_segment == seg);
-    return kv->second;
+    assert(labels.at(existing).target_segment == seg);
+    return existing;
+  }
+
+  // create a new label. The words it points to may not be added yet.
+  assert(offset >= 0);
+  auto& first_label_by_word = first_label_per_seg_by_word.at(seg);
+  size_t word = offset / 4;
+  if (word >= first_label_by_word.size()) {
+    first_label_by_word.resize(std::max(word + 1, words_by_seg.at(seg).size() + 1), -1);
   }
+
+  int id = labels.size();
+  Label label;
+  label.target_segment = seg;
+  label.offset = offset;
+  label.number = id;
+  label.next_in_word = first_label_by_word[word];
+  first_label_by_word[word] = id;
+  labels.push_back(label);
+  return id;
 }
 
 /*!
@@ -60,12 +66,18 @@ int LinkedObjectFile::get_label_id_for(int seg, int offset) {
  * Returns -1 if there is no label.
  */
 int LinkedObjectFile::get_label_at(int seg, int offset) const {
-  auto kv = label_per_seg_by_offset.at(seg).find(offset);
-  if (kv == label_per_seg_by_offset.at(seg).end()) {
+  auto& first_label_by_word = first_label_per_seg_by_word.at(seg);
+  size_t word = offset / 4;
+  if (offset < 0 || word >= first_label_by_word.size()) {
     return -1;
   }
 
-  return kv->second;
+  for (int id = first_label_by_word[word]; id != -1; id = labels[id].next_in_word) {
+    if (labels[id].offset == offset) {
+      return id;
+    }
+  }
+  return -1;
 }
 
 /*!
@@ -97,7 +109,18 @@ Function& LinkedObjectFile::get_function_at_label(int label_id) {
  * Get the name of the label.
  */
 std::string LinkedObjectFile::get_label_name(int label_id) const {
-  return labels.at(label_id).name;
+  auto& label = labels.at(label_id);
+  if (!label.name.empty()) {
+    return label.name;
+  }
+  return "L" + std::to_string(label.number);
+}
+
+/*!
+ * Get the name of the symbol that a word is linked to.
+ */
+const std::string& LinkedObjectFile::get_symbol_name(const LinkedWord& word) const {
+  return symbol_table->name(word.symbol_id());
 }
 
 /*!
@@ -110,7 +133,7 @@ bool LinkedObjectFile::pointer_link_word(int source_segment,
   assert((source_offset % 4) == 0);
 
   auto& word = words_by_seg.at(source_segment).at(source_offset / 4);
-  assert(word.kind == LinkedWord::PLAIN_DATA);
+  assert(word.kind() == LinkedWord::PLAIN_DATA);
 
   if (dest_offset / 4 > (int)words_by_seg.at(dest_segment).size()) {
     //    printf("HACK bad link ignored!\n");
@@ -118,8 +141,7 @@ bool LinkedObjectFile::pointer_link_word(int source_segment,
   }
   assert(dest_offset / 4 <= (int)words_by_seg.at(dest_segment).size());
 
-  word.kind = LinkedWord::PTR;
-  word.label_id = get_label_id_for(dest_segment, dest_offset);
+  word.set_to_label(LinkedWord::PTR, get_label_id_for(dest_segment, dest_offset));
   return true;
 }
 
@@ -132,12 +154,11 @@ void LinkedObjectFile::symbol_link_word(int source_segment,
                                         LinkedWord::Kind kind) {
   assert((source_offset % 4) == 0);
   auto& word = words_by_seg.at(source_segment).at(source_offset / 4);
-  //  assert(word.kind == LinkedWord::PLAIN_DATA);
-  if (word.kind != LinkedWord::PLAIN_DATA) {
+  //  assert(word.kind() == LinkedWord::PLAIN_DATA);
+  if (word.kind() != LinkedWord::PLAIN_DATA) {
     printf("bad symbol link word\n");
   }
-  word.kind = kind;
-  word.symbol_name = name;
+  word.set_to_symbol(kind, symbol_table->intern(name));
 }
 
 /*!
@@ -147,9 +168,8 @@ void LinkedObjectFile::symbol_link_word(int source_segment,
 void LinkedObjectFile::symbol_link_offset(int source_segment, int source_offset, const char* name) {
   assert((source_offset % 4) == 0);
   auto& word = words_by_seg.at(source_segment).at(source_offset / 4);
-  assert(word.kind == LinkedWord::PLAIN_DATA);
-  word.kind = LinkedWord::SYM_OFFSET;
-  word.symbol_name = name;
+  assert(word.kind() == LinkedWord::PLAIN_DATA);
+  word.set_to_symbol(LinkedWord::SYM_OFFSET, symbol_table->intern(name));
 }
 
 /*!
@@ -167,14 +187,12 @@ void LinkedObjectFile::pointer_link_split_word(int source_segment,
   auto& lo_word = words_by_seg.at(source_segment).at(source_lo_offset / 4);
 
   //  assert(dest_offset / 4 <= (int)words_by_seg.at(dest_segment).size());
-  assert(hi_word.kind == LinkedWord::PLAIN_DATA);
-  assert(lo_word.kind == LinkedWord::PLAIN_DATA);
-
-  hi_word.kind = LinkedWord::HI_PTR;
-  hi_word.label_id = get_label_id_for(dest_segment, dest_offset);
+  assert(hi_word.kind() == LinkedWord::PLAIN_DATA);
+  assert(lo_word.kind() == LinkedWord::PLAIN_DATA);
 
-  lo_word.kind = LinkedWord::LO_PTR;
-  lo_word.label_id = hi_word.label_id;
+  int label_id = get_label_id_for(dest_segment, dest_offset);
+  hi_word.set_to_label(LinkedWord::HI_PTR, label_id);
+  lo_word.set_to_label(LinkedWord::LO_PTR, label_id);
 }
 
 /*!
@@ -196,7 +214,8 @@ uint32_t LinkedObjectFile::set_ordered_label_names() {
 
   for (size_t i = 0; i < indices.size(); i++) {
     auto& label = labels.at(indices[i]);
-    label.name = "L" + std::to_string(i + 1);
+    label.name.clear();
+    label.number = i + 1;
   }
 
   return labels.size();
@@ -222,7 +241,7 @@ std::string LinkedObjectFile::print_words() {
       for (int j = 0; j < 4; j++) {
         auto label_id = get_label_at(seg, i * 4 + j);
         if (label_id != -1) {
-          result += labels.at(label_id).name + ":";
+          result += get_label_name(label_id) + ":";
           if (j != 0) {
             result += " (offset " + std::to_string(j) + ")";
           }
@@ -244,32 +263,32 @@ std::string LinkedObjectFile::print_words() {
 void LinkedObjectFile::append_word_to_string(std::string& dest, const LinkedWord& word) const {
   char buff[128];
 
-  switch (word.kind) {
+  switch (word.kind()) {
     case LinkedWord::PLAIN_DATA:
       sprintf(buff, "    .word 0x%x\n", word.data);
       break;
     case LinkedWord::PTR:
-      sprintf(buff, "    .word %s\n", labels.at(word.label_id).name.c_str());
+      sprintf(buff, "    .word %s\n", get_label_name(word.label_id()).c_str());
       break;
     case LinkedWord::SYM_PTR:
-      sprintf(buff, "    .symbol %s\n", word.symbol_name.c_str());
+      sprintf(buff, "    .symbol %s\n", get_symbol_name(word).c_str());
       break;
     case LinkedWord::TYPE_PTR:
-      sprintf(buff, "    .type %s\n", word.symbol_name.c_str());
+      sprintf(buff, "    .type %s\n", get_symbol_name(word).c_str());
       break;
     case LinkedWord::EMPTY_PTR:
       sprintf(buff, "    .empty-list\n");  // ?
       break;
     case LinkedWord::HI_PTR:
       sprintf(buff, "    .ptr-hi 0x%x %s\n", word.data >> 16,
-              labels.at(word.label_id).name.c_str());
+              get_label_name(word.label_id()).c_str());
       break;
     case LinkedWord::LO_PTR:
       sprintf(buff, "    .ptr-lo 0x%x %s\n", word.data >> 16,
-              labels.at(word.label_id).name.c_str());
+              get_label_name(word.label_id()).c_str());
       break;
     case LinkedWord::SYM_OFFSET:
-      sprintf(buff, "    .sym-off 0x%x %s\n", word.data >> 16, word.symbol_name.c_str());
+      sprintf(buff, "    .sym-off 0x%x %s\n", word.data >> 16, get_symbol_name(word).c_str());
       break;
     default:
       throw std::runtime_error("nyi");
@@ -286,8 +305,8 @@ void LinkedObjectFile::find_code() {
     // single segment object files should never have any code.
     auto& seg = words_by_seg.front();
     for (auto& word : seg) {
-      if (!word.symbol_name.empty()) {
-        assert(word.symbol_name != "function");
+      if (word.has_symbol()) {
+        assert(word.symbol_id() != symbol_table->find("function"));
       }
     }
     offset_of_data_zone_by_seg.at(0) = 0;
@@ -300,13 +319,14 @@ void LinkedObjectFile::find_code() {
     // that (plus one for delay slot) and assume that after that is data.  Additionally, we check to
     // make sure that there are no "function" type tags in the data section, although this is
     // redundant.
+    int function_sym = symbol_table->find("function");
     for (int i = 0; i < segments; i++) {
       // try to find the last reference to "function":
       bool found_function = false;
       size_t function_loc = -1;
       for (size_t j = words_by_seg.at(i).size(); j-- > 0;) {
         auto& word = words_by_seg.at(i).at(j);
-        if (word.kind == LinkedWord::TYPE_PTR && word.symbol_name == "function") {
+        if (word.is_type_ptr(function_sym)) {
           function_loc = j;
           found_function = true;
           break;
@@ -321,7 +341,7 @@ void LinkedObjectFile::find_code() {
 
         for (size_t j = function_loc; j < words_by_seg.at(i).size(); j++) {
           auto& word = words_by_seg.at(i).at(j);
-          if (word.kind == LinkedWord::PLAIN_DATA && word.data == jr_ra) {
+          if (word.kind() == LinkedWord::PLAIN_DATA && word.data == jr_ra) {
             found_jr_ra = true;
             jr_ra_loc = j;
           }
@@ -345,7 +365,7 @@ void LinkedObjectFile::find_code() {
       // verify there are no functions after the data section starts
       for (size_t j = offset_of_data_zone_by_seg.at(i); j < words_by_seg.at(i).size(); j++) {
         auto& word = words_by_seg.at(i).at(j);
-        if (word.kind == LinkedWord::TYPE_PTR && word.symbol_name == "function") {
+        if (word.is_type_ptr(function_sym)) {
           assert(false);
         }
       }
@@ -372,6 +392,7 @@ void LinkedObjectFile::find_functions() {
     // mark the end of the previous function and the start of the next.  This means that some
     // functions will have a few 0x0 words after then for padding (GOAL functions are aligned), but
     // this is something that the disassembler should handle.
+    int function_sym = symbol_table->find("function");
     for (int seg = 0; seg < segments; seg++) {
       // start at the end and work backward...
       int function_end = offset_of_data_zone_by_seg.at(seg);
@@ -381,7 +402,7 @@ void LinkedObjectFile::find_functions() {
         bool found_function_tag_loc = false;
         for (; function_tag_loc-- > 0;) {
           auto& word = words_by_seg.at(seg).at(function_tag_loc);
-          if (word.kind == LinkedWord::TYPE_PTR && word.symbol_name == "function") {
+          if (word.is_type_ptr(function_sym)) {
             found_function_tag_loc = true;
             break;
           }
@@ -500,11 +521,47 @@ void LinkedObjectFile::process_fp_relative_links() {
   }
 }
 
+/*!
+ * The text from the analysis of a function, which goes before and after its instructions in the
+ * disassembly.
+ */
+LinkedObjectFile::FunctionText LinkedObjectFile::print_function_analysis(const Function& func) {
+  FunctionText result;
+  result.header = func.prologue.to_string(2) + "\n";
+  if (!func.warnings.empty()) {
+    result.header += "Warnings: " + func.warnings + "\n";
+  }
+
+  // hack
+  if (func.cfg && !func.cfg->is_fully_resolved()) {
+    result.footer += func.cfg->to_dot();
+    result.footer += "\n";
+  }
+  if (func.cfg) {
+    result.footer += func.cfg->to_form_string() + "\n";
+  }
+  return result;
+}
+
 /*!
  * Print disassembled functions and data segments.
  */
 std::string LinkedObjectFile::print_disassembly() {
-  bool write_hex = get_config().write_hex_near_instructions;
+  std::vector<std::vector<FunctionText>> function_text(segments);
+  for (int seg = 0; seg < segments; seg++) {
+    for (auto& func : functions_by_seg.at(seg)) {
+      function_text.at(seg).push_back(print_function_analysis(func));
+    }
+  }
+  return print_disassembly(get_config().write_hex_near_instructions, function_text);
+}
+
+/*!
+ * Print disassembled functions and data segments, using the given analysis text for each function.
+ */
+std::string LinkedObjectFile::print_disassembly(
+    bool write_hex,
+    const std::vector<std::vector<FunctionText>>& function_text) {
   std::string result;
 
   assert(segments <= 3);
@@ -515,14 +572,13 @@ std::string LinkedObjectFile::print_disassembly() {
     result += "\n;------------------------------------------\n\n";
 
     // functions
-    for (auto& func : functions_by_seg.at(seg)) {
+    for (size_t func_idx = 0; func_idx < functions_by_seg.at(seg).size(); func_idx++) {
+      auto& func = functions_by_seg.at(seg).at(func_idx);
+      auto& text = function_text.at(seg).at(func_idx);
       result += ";;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;\n";
       result += "; .function " + func.guessed_name.to_string() + "\n";
       result += ";;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;\n";
-      result += func.prologue.to_string(2) + "\n";
-      if (!func.warnings.empty()) {
-        result += "Warnings: " + func.warnings + "\n";
-      }
+      result += text.header;
 
       // print each instruction in the function.
       bool in_delay_slot = false;
@@ -530,14 +586,14 @@ std::string LinkedObjectFile::print_disassembly() {
       for (int i = 1; i < func.end_word - func.start_word; i++) {
         auto label_id = get_label_at(seg, (func.start_word + i) * 4);
         if (label_id != -1) {
-          result += labels.at(label_id).name + ":\n";
+          result += get_label_name(label_id) + ":\n";
         }
 
         for (int j = 1; j < 4; j++) {
           //          assert(get_label_at(seg, (func.start_word + i)*4 + j) == -1);
           if (get_label_at(seg, (func.start_word + i) * 4 + j) != -1) {
             result += "BAD OFFSET LABEL: ";
-            result += labels.at(get_label_at(seg, (func.start_word + i) * 4 + j)).name + "\n";
+            result += get_label_name(get_label_at(seg, (func.start_word + i) * 4 + j)) + "\n";
             assert(false);
           }
         }
@@ -580,49 +636,43 @@ std::string LinkedObjectFile::print_disassembly() {
       //        }
       //      }
 
-      // hack
-      if (func.cfg && !func.cfg->is_fully_resolved()) {
-        result += func.cfg->to_dot();
-        result += "\n";
-      }
-      if (func.cfg) {
-        result += func.cfg->to_form_string() + "\n";
-
-        // To debug block stuff.
-        /*
-        int bid = 0;
-        for(auto& block : func.basic_blocks) {
-          in_delay_slot = false;
-          result += "B" + std::to_string(bid++) + "\n";
-          for(auto i = block.start_word; i < block.end_word; i++) {
-            auto label_id = get_label_at(seg, (func.start_word + i) * 4);
-            if (label_id != -1) {
-              result += labels.at(label_id).name + ":\n";
-            }
-            auto& instr = func.instructions.at(i);
-            result += "    " + instr.to_string(*this) + "\n";
-            if (in_delay_slot) {
-              result += "\n";
-              in_delay_slot = false;
-            }
+      result += text.footer;
+
+      // To debug block stuff.
+      /*
+      int bid = 0;
+      for(auto& block : func.basic_blocks) {
+        in_delay_slot = false;
+        result += "B" + std::to_string(bid++) + "\n";
+        for(auto i = block.start_word; i < block.end_word; i++) {
+          auto label_id = get_label_at(seg, (func.start_word + i) * 4);
+          if (label_id != -1) {
+            result += get_label_name(label_id) + ":\n";
+          }
+          auto& instr = func.instructions.at(i);
+          result += "    " + instr.to_string(*this) + "\n";
+          if (in_delay_slot) {
+            result += "\n";
+            in_delay_slot = false;
+          }
 
-            if (gOpcodeInfo[(int)instr.kind].has_delay_slot) {
-              in_delay_slot = true;
-            }
+          if (gOpcodeInfo[(int)instr.kind].has_delay_slot) {
+            in_delay_slot = true;
           }
         }
-         */
       }
+       */
 
       result += "\n\n\n";
     }
 
     // print data
+    int string_sym = symbol_table->find("string");
     for (size_t i = offset_of_data_zone_by_seg.at(seg); i < words_by_seg.at(seg).size(); i++) {
       for (int j = 0; j < 4; j++) {
         auto label_id = get_label_at(seg, i * 4 + j);
         if (label_id != -1) {
-          result += labels.at(label_id).name + ":";
+          result += get_label_name(label_id) + ":";
           if (j != 0) {
             result += " (offset " + std::to_string(j) + ")";
           }
@@ -633,7 +683,7 @@ std::string LinkedObjectFile::print_disassembly() {
       auto& word = words_by_seg[seg][i];
       append_word_to_string(result, word);
 
-      if (word.kind == LinkedWord::TYPE_PTR && word.symbol_name == "string") {
+      if (word.is_type_ptr(string_sym)) {
         result += "; " + get_goal_string(seg, i) + "\n";
       }
     }
@@ -652,7 +702,7 @@ std::string LinkedObjectFile::get_goal_string(int seg, int word_idx) {
     return "invalid string!\n";
   }
   LinkedWord& size_word = words_by_seg[seg].at(word_idx + 1);
-  if (size_word.kind != LinkedWord::PLAIN_DATA) {
+  if (size_word.kind() != LinkedWord::PLAIN_DATA) {
     // sometimes an array of string pointer triggers this!
     return "invalid string!\n";
   }
@@ -663,7 +713,7 @@ std::string LinkedObjectFile::get_goal_string(int seg, int word_idx) {
     int word_offset = word_idx + 2 + (i / 4);
     int byte_offset = i % 4;
     auto& word = words_by_seg[seg].at(word_offset);
-    if (word.kind != LinkedWord::PLAIN_DATA) {
+    if (word.kind() != LinkedWord::PLAIN_DATA) {
       return "invalid string! (check me!)\n";
     }
     char cword[4];
@@ -685,10 +735,10 @@ bool LinkedObjectFile::has_any_functions() {
 }
 
 /*!
- * Print all scripts in this file.
+ * Find all scripts in this file. The Forms are allocated from pool.
  */
-std::string LinkedObjectFile::print_scripts() {
-  std::string result;
+std::vector<Form*> LinkedObjectFile::find_scripts(FormPool& pool) {
+  std::vector<Form*> result;
   for (int seg = 0; seg < segments; seg++) {
     std::vector<bool> already_printed(words_by_seg[seg].size(), false);
 
@@ -706,7 +756,7 @@ std::string LinkedObjectFile::print_scripts() {
       if (label_id != -1) {
         auto& label = labels.at(label_id);
         if ((label.offset & 7) == 2) {
-          result += to_form_script(seg, word_idx, already_printed)->toStringPretty(0, 100) + "\n";
+          result.push_back(to_form_script(pool, seg, word_idx, already_printed));
         }
       }
     }
@@ -714,13 +764,24 @@ std::string LinkedObjectFile::print_scripts() {
   return result;
 }
 
+/*!
+ * Print all scripts in this file.
+ */
+std::string LinkedObjectFile::print_scripts(FormPool& pool) {
+  std::string result;
+  for (auto* script : find_scripts(pool)) {
+    result += script->toStringPretty(0, 100) + "\n";
+  }
+  return result;
+}
+
 /*!
  * Is the object pointed to the empty list?
  */
 bool LinkedObjectFile::is_empty_list(int seg, int byte_idx) {
   assert((byte_idx % 4) == 0);
   auto& word = words_by_seg.at(seg).at(byte_idx / 4);
-  return word.kind == LinkedWord::EMPTY_PTR;
+  return word.kind() == LinkedWord::EMPTY_PTR;
 }
 
 /*!
@@ -728,15 +789,16 @@ bool LinkedObjectFile::is_empty_list(int seg, int byte_idx) {
  * Note : this takes the address of the car of the pair. which is perhaps a bit confusing
  * (in GOAL, this would be (&-> obj car))
  */
-std::shared_ptr<Form> LinkedObjectFile::to_form_script(int seg,
-                                                       int word_idx,
-                                                       std::vector<bool>& seen) {
+Form* LinkedObjectFile::to_form_script(FormPool& pool,
+                                       int seg,
+                                       int word_idx,
+                                       std::vector<bool>& seen) {
   // the object to currently print. to start off, create pair from the car address we've been given.
   int goal_print_obj = word_idx * 4 + 2;
 
   // resulting form. we can't have a totally empty list (as an empty list looks like a symbol,
   // so it wouldn't be flagged), so it's safe to make this a pair.
-  auto result = std::make_shared<Form>();
+  auto result = pool.alloc();
   result->kind = FormKind::PAIR;
 
   // the current pair to fill out.
@@ -747,7 +809,7 @@ std::shared_ptr<Form> LinkedObjectFile::to_form_script(int seg,
     // check the thing to print is a a pair.
     if ((goal_print_obj & 7) == 2) {
       // first convert the car (again, with (&-> obj car))
-      fill->pair[0] = to_form_script_object(seg, goal_print_obj - 2, seen);
+      fill->pair[0] = to_form_script_object(pool, seg, goal_print_obj - 2, seen);
       seen.at(goal_print_obj / 4) = true;
 
       auto cdr_addr = goal_print_obj + 2;
@@ -761,15 +823,16 @@ std::shared_ptr<Form> LinkedObjectFile::to_form_script(int seg,
         assert((cdr_addr % 4) == 0);
         auto& cdr_word = words_by_seg.at(seg).at(cdr_addr / 4);
         // check for proper list
-        if (cdr_word.kind == LinkedWord::PTR && (labels.at(cdr_word.label_id).offset & 7) == 2) {
+        if (cdr_word.kind() == LinkedWord::PTR &&
+            (labels.at(cdr_word.label_id()).offset & 7) == 2) {
           // yes, proper list. add another pair and link it in to the list.
-          goal_print_obj = labels.at(cdr_word.label_id).offset;
-          fill->pair[1] = std::make_shared<Form>();
+          goal_print_obj = labels.at(cdr_word.label_id()).offset;
+          fill->pair[1] = pool.alloc();
           fill->pair[1]->kind = FormKind::PAIR;
           fill = fill->pair[1];
         } else {
           // improper list, put the last thing in and end
-          fill->pair[1] = to_form_script_object(seg, cdr_addr, seen);
+          fill->pair[1] = to_form_script_object(pool, seg, cdr_addr, seen);
           return result;
         }
       }
@@ -795,42 +858,43 @@ bool LinkedObjectFile::is_string(int seg, int byte_idx) {
     return false;
   }
   auto& type_word = words_by_seg.at(seg).at(type_tag_ptr / 4);
-  return type_word.kind == LinkedWord::TYPE_PTR && type_word.symbol_name == "string";
+  return type_word.is_type_ptr(symbol_table->find("string"));
 }
 
 /*!
  * Convert a (pointer object) to some nice representation.
  */
-std::shared_ptr<Form> LinkedObjectFile::to_form_script_object(int seg,
-                                                              int byte_idx,
-                                                              std::vector<bool>& seen) {
-  std::shared_ptr<Form> result;
+Form* LinkedObjectFile::to_form_script_object(FormPool& pool,
+                                              int seg,
+                                              int byte_idx,
+                                              std::vector<bool>& seen) {
+  Form* result = nullptr;
 
   switch (byte_idx & 7) {
     case 0:
     case 4: {
       auto& word = words_by_seg.at(seg).at(byte_idx / 4);
-      if (word.kind == LinkedWord::SYM_PTR) {
+      if (word.kind() == LinkedWord::SYM_PTR) {
         // .symbol xxxx
-        result = toForm(word.symbol_name);
-      } else if (word.kind == LinkedWord::PLAIN_DATA) {
+        result = toForm(pool, get_symbol_name(word));
+      } else if (word.kind() == LinkedWord::PLAIN_DATA) {
         // .word xxxxx
-        result = toForm(std::to_string(word.data));
-      } else if (word.kind == LinkedWord::PTR) {
+        result = toForm(pool, std::to_string(word.data));
+      } else if (word.kind() == LinkedWord::PTR) {
         // might be a sub-list, or some other random pointer
-        auto offset = labels.at(word.label_id).offset;
+        auto offset = labels.at(word.label_id()).offset;
         if ((offset & 7) == 2) {
           // list!
-          result = to_form_script(seg, offset / 4, seen);
+          result = to_form_script(pool, seg, offset / 4, seen);
         } else {
           if (is_string(seg, offset)) {
-            result = toForm(get_goal_string(seg, offset / 4 - 1));
+            result = toForm(pool, get_goal_string(seg, offset / 4 - 1));
           } else {
             // some random pointer, just print the label.
-            result = toForm(labels.at(word.label_id).name);
+            result = toForm(pool, get_label_name(word.label_id()));
           }
         }
-      } else if (word.kind == LinkedWord::EMPTY_PTR) {
+      } else if (word.kind() == LinkedWord::EMPTY_PTR) {
         result = gSymbolTable.getEmptyPair();
       } else {
         std::string debug;
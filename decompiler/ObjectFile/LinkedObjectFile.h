@@ -22,9 +22,11 @@
  * Doesn't have to be word aligned.
  */
 struct Label {
-  std::string name;
+  std::string name;  // if empty, the name is L<number>. Use get_label_name.
+  int number = -1;
   int target_segment;
-  int offset;  // in bytes
+  int offset;             // in bytes
+  int next_in_word = -1;  // another label pointing into the same word, or -1
 };
 
 /*!
@@ -51,14 +53,23 @@ class LinkedObjectFile {
   void symbol_link_offset(int source_segment, int source_offset, const char* name);
   Function& get_function_at_label(int label_id);
   std::string get_label_name(int label_id) const;
+  const std::string& get_symbol_name(const LinkedWord& word) const;
   uint32_t set_ordered_label_names();
   void find_code();
   std::string print_words();
   void find_functions();
   void disassemble_functions();
   void process_fp_relative_links();
-  std::string print_scripts();
+  std::vector<Form*> find_scripts(FormPool& pool);
+  std::string print_scripts(FormPool& pool);
+  // text from the analysis of a function, printed before and after its instructions.
+  struct FunctionText {
+    std::string header, footer;
+  };
+  static FunctionText print_function_analysis(const Function& func);
   std::string print_disassembly();
+  std::string print_disassembly(bool write_hex,
+                                const std::vector<std::vector<FunctionText>>& function_text);
   bool has_any_functions();
   void append_word_to_string(std::string& dest, const LinkedWord& word) const;
 
@@ -122,15 +133,17 @@ class LinkedObjectFile {
   std::vector<uint32_t> offset_of_data_zone_by_seg;
   std::vector<std::vector<Function>> functions_by_seg;
   std::vector<Label> labels;
+  LinkedSymbolTable* symbol_table = nullptr;  // shared with the other files in the ObjectFileDB
 
  private:
-  std::shared_ptr<Form> to_form_script(int seg, int word_idx, std::vector<bool>& seen);
-  std::shared_ptr<Form> to_form_script_object(int seg, int byte_idx, std::vector<bool>& seen);
+  Form* to_form_script(FormPool& pool, int seg, int word_idx, std::vector<bool>& seen);
+  Form* to_form_script_object(FormPool& pool, int seg, int byte_idx, std::vector<bool>& seen);
   bool is_empty_list(int seg, int byte_idx);
   bool is_string(int seg, int byte_idx);
   std::string get_goal_string(int seg, int word_idx);
 
-  std::vector<std::unordered_map<int, int>> label_per_seg_by_offset;
+  // the first label pointing into each word, or -1. Use next_in_word to find the others.
+  std::vector<std::vector<int>> first_label_per_seg_by_word;
 };
 
 #endif  // NEXT_LINKEDOBJECTFILE_H
@@ -775,8 +775,11 @@ static void link_v3(LinkedObjectFile& f,
 /*!
  * Main function to generate LinkedObjectFiles from raw object data.
  */
-LinkedObjectFile to_linked_object_file(const std::vector<uint8_t>& data, const std::string& name) {
+LinkedObjectFile to_linked_object_file(const std::vector<uint8_t>& data,
+                                       const std::string& name,
+                                       LinkedSymbolTable* symbol_table) {
   LinkedObjectFile result;
+  result.symbol_table = symbol_table;
   const auto* header = (const LinkHeaderCommon*)&data.at(0);
 
   // use appropriate linker
@@ -11,6 +11,8 @@
 
 #include "LinkedObjectFile.h"
 
-LinkedObjectFile to_linked_object_file(const std::vector<uint8_t>& data, const std::string& name);
+LinkedObjectFile to_linked_object_file(const std::vector<uint8_t>& data,
+                                       const std::string& name,
+                                       LinkedSymbolTable* symbol_table);
 
 #endif  // NEXT_LINKEDOBJECTFILECREATION_H
@@ -8,14 +8,57 @@
 #ifndef JAK2_DISASSEMBLER_LINKEDWORD_H
 #define JAK2_DISASSEMBLER_LINKEDWORD_H
 
+#include <cassert>
 #include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+/*!
+ * Interned names of symbols that words are linked to. One of these is shared by all object files
+ * in an ObjectFileDB, so each symbol name is only stored once.
+ */
+class LinkedSymbolTable {
+ public:
+  /*!
+   * Get the id of a symbol name, adding it if needed.
+   */
+  int intern(const std::string& name) {
+    auto kv = m_ids.find(name);
+    if (kv != m_ids.end()) {
+      return kv->second;
+    }
+    int id = int(m_names.size());
+    m_names.push_back(name);
+    m_ids[name] = id;
+    return id;
+  }
+
+  /*!
+   * Get the id of a symbol name, or -1 if no word has been linked to it.
+   */
+  int find(const std::string& name) const {
+    auto kv = m_ids.find(name);
+    return kv == m_ids.end() ? -1 : kv->second;
+  }
+
+  const std::string& name(int id) const { return m_names.at(id); }
+  int size() const { return int(m_names.size()); }
+
+ private:
+  std::vector<std::string> m_names;
+  std::unordered_map<std::string, int> m_ids;
+};
+
+/*!
+ * The word data, what kind of link it has, and the label or symbol id for the link packed into 8
+ * bytes. There are a lot of these, so they should stay small.
+ */
 class LinkedWord {
  public:
-  explicit LinkedWord(uint32_t _data) : data(_data) {}
+  explicit LinkedWord(uint32_t _data) : data(_data), m_kind(PLAIN_DATA), m_id(0) {}
 
-  enum Kind {
+  enum Kind : uint8_t {
     PLAIN_DATA,  // just plain data
     PTR,         // pointer to a location
     HI_PTR,      // lower 16-bits of this data are the upper 16 bits of a pointer
@@ -24,12 +67,59 @@ class LinkedWord {
     EMPTY_PTR,   // this is a pointer to the empty list
     SYM_OFFSET,  // this is an offset of a symbol in the symbol table
     TYPE_PTR     // this is a pointer to a type
-  } kind = PLAIN_DATA;
+  };
+
+  static constexpr int MAX_ID = (1 << 24) - 1;
+
+  Kind kind() const { return Kind(m_kind); }
+
+  bool has_label() const { return m_kind == PTR || m_kind == HI_PTR || m_kind == LO_PTR; }
+  bool has_symbol() const {
+    return m_kind == SYM_PTR || m_kind == EMPTY_PTR || m_kind == SYM_OFFSET || m_kind == TYPE_PTR;
+  }
+
+  /*!
+   * Index in the object file's labels.
+   */
+  int label_id() const {
+    assert(has_label());
+    return int(m_id);
+  }
+
+  /*!
+   * Index in the LinkedSymbolTable.
+   */
+  int symbol_id() const {
+    assert(has_symbol());
+    return int(m_id);
+  }
+
+  /*!
+   * Is this a type tag for the given symbol?
+   */
+  bool is_type_ptr(int sym_id) const { return m_kind == TYPE_PTR && int(m_id) == sym_id; }
+
+  void set_to_label(Kind kind, int label_id) {
+    assert(label_id >= 0 && label_id <= MAX_ID);
+    m_kind = kind;
+    m_id = label_id;
+    assert(has_label());
+  }
+
+  void set_to_symbol(Kind kind, int symbol_id) {
+    assert(symbol_id >= 0 && symbol_id <= MAX_ID);
+    m_kind = kind;
+    m_id = symbol_id;
+    assert(has_symbol());
+  }
 
   uint32_t data = 0;
 
-  int label_id = -1;
-  std::string symbol_name;
+ private:
+  uint32_t m_kind : 8;
+  uint32_t m_id : 24;
 };
 
+static_assert(sizeof(LinkedWord) == 8, "LinkedWord should be 8 bytes");
+
 #endif  // JAK2_DISASSEMBLER_LINKEDWORD_H
@@ -0,0 +1,561 @@
+/*!
+ * @file ObjectDump.cpp
+ * A compact binary dump of an analyzed object file, which can be printed in the same text formats
+ * as the .txt and .func dumps without the original DGO files.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include "ObjectDump.h"
+#include "common/util/BinaryWriter.h"
+#include "decompiler/Disasm/Instruction.h"
+#include "third-party/minilzo/minilzo.h"
+
+namespace {
+constexpr char MAGIC[4] = {'O', 'D', 'M', 'P'};
+constexpr uint32_t VERSION = 1;
+
+// sections, in the order they are stored.
+enum Section : uint32_t {
+  SEGMENTS,      // word count, start of data, function count
+  WORDS,         // data of each word
+  WORD_KINDS,    // LinkedWord::Kind of each word
+  WORD_LINKS,    // label or symbol id of each word with a link
+  SYMBOLS,       // names of the symbols used in this object
+  LABELS,        // segment, offset, number, name
+  FUNCTIONS,     // start, end, name, analysis text
+  INSTRUCTIONS,  // kind, atom counts, cop2 fields
+  ATOMS,         // kind, value
+  SECTION_COUNT
+};
+
+void init_lzo() {
+  static bool lzo_ok = lzo_init() == LZO_E_OK;
+  if (!lzo_ok) {
+    throw std::runtime_error("lzo_init failed");
+  }
+}
+
+void check(bool ok, const char* what) {
+  if (!ok) {
+    throw std::runtime_error(std::string("bad object dump: ") + what);
+  }
+}
+
+/*!
+ * A column is a count, then the values.
+ */
+template <typename T>
+void add_column(BinaryWriter& writer, const std::vector<T>& column) {
+  writer.add<uint32_t>(column.size());
+  writer.add_data(column.data(), column.size() * sizeof(T));
+}
+
+/*!
+ * A column of strings is a column of lengths, then all the characters.
+ */
+void add_strings(BinaryWriter& writer, const std::vector<std::string>& strings) {
+  std::vector<uint32_t> lengths;
+  std::string chars;
+  for (auto& str : strings) {
+    lengths.push_back(str.size());
+    chars += str;
+  }
+  add_column(writer, lengths);
+  writer.add_data(chars.data(), chars.size());
+}
+
+/*!
+ * Compress a section, or store it if that doesn't make it smaller.
+ */
+std::vector<uint8_t> compress(BinaryWriter& section, std::vector<lzo_align_t>& work_mem) {
+  auto* src = (const uint8_t*)section.get_data();
+  size_t size = section.get_size();
+  std::vector<uint8_t> result(size + size / 16 + 64 + 3);
+  lzo_uint compressed_size = result.size();
+  if (size && lzo1x_1_compress(src, size, result.data(), &compressed_size, work_mem.data()) ==
+                  LZO_E_OK &&
+      compressed_size < size) {
+    result.resize(compressed_size);
+  } else {
+    result.assign(src, src + size);
+  }
+  return result;
+}
+
+uint32_t register_number(const Register& reg) {
+  switch (reg.get_kind()) {
+    case Reg::GPR:
+      return reg.get_gpr();
+    case Reg::FPR:
+      return reg.get_fpr();
+    case Reg::VF:
+      return reg.get_vf();
+    case Reg::VI:
+      return reg.get_vi();
+    case Reg::COP0:
+      return reg.get_cop0();
+    case Reg::PCR:
+      return reg.get_pcr();
+    default:
+      throw std::runtime_error("Unsupported Register");
+  }
+}
+
+/*!
+ * Reads the header or a section of a dump, checking that it doesn't go past the end.
+ */
+class DumpReader {
+ public:
+  DumpReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+  explicit DumpReader(const std::vector<uint8_t>& data) : DumpReader(data.data(), data.size()) {}
+
+  const uint8_t* take(size_t size) {
+    check(size <= m_size - m_seek, "truncated");
+    auto* result = m_data + m_seek;
+    m_seek += size;
+    return result;
+  }
+
+  template <typename T>
+  T read() {
+    T result;
+    memcpy(&result, take(sizeof(T)), sizeof(T));
+    return result;
+  }
+
+  template <typename T>
+  std::vector<T> read_column() {
+    size_t count = read<uint32_t>();
+    auto* src = take(count * sizeof(T));  // check the size before allocating.
+    std::vector<T> result(count);
+    memcpy((void*)result.data(), src, count * sizeof(T));
+    return result;
+  }
+
+  std::string read_string(size_t size) { return std::string((const char*)take(size), size); }
+
+  std::vector<std::string> read_strings() {
+    std::vector<std::string> result;
+    for (auto length : read_column<uint32_t>()) {
+      result.push_back(read_string(length));
+    }
+    return result;
+  }
+
+  void expect_end() const { check(m_seek == m_size, "extra data"); }
+
+ private:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_seek = 0;
+};
+}  // namespace
+
+/*!
+ * Create a dump of an object file. The functions must have been disassembled.
+ */
+std::vector<uint8_t> ObjectDump::write(const LinkedObjectFile& file, const std::string& name) {
+  init_lzo();
+  LinkedSymbolTable symbols;  // only the symbols used by this object.
+  std::vector<BinaryWriter> sections(SECTION_COUNT);
+
+  // segments and words
+  std::vector<uint32_t> word_counts, data_starts, function_counts, words, links;
+  std::vector<uint8_t> word_kinds;
+  for (int seg = 0; seg < file.segments; seg++) {
+    word_counts.push_back(file.words_by_seg.at(seg).size());
+    data_starts.push_back(file.offset_of_data_zone_by_seg.at(seg));
+    function_counts.push_back(file.functions_by_seg.at(seg).size());
+    for (auto& word : file.words_by_seg.at(seg)) {
+      words.push_back(word.data);
+      word_kinds.push_back(word.kind());
+      if (word.has_label()) {
+        links.push_back(word.label_id());
+      } else if (word.has_symbol()) {
+        links.push_back(symbols.intern(file.get_symbol_name(word)));
+      }
+    }
+  }
+  add_column(sections[SEGMENTS], word_counts);
+  add_column(sections[SEGMENTS], data_starts);
+  add_column(sections[SEGMENTS], function_counts);
+  add_column(sections[WORDS], words);
+  add_column(sections[WORD_KINDS], word_kinds);
+  add_column(sections[WORD_LINKS], links);
+
+  // labels
+  std::vector<uint8_t> label_segs;
+  std::vector<int32_t> label_offsets, label_numbers;
+  std::vector<std::string> label_names;
+  for (auto& label : file.labels) {
+    label_segs.push_back(label.target_segment);
+    label_offsets.push_back(label.offset);
+    label_numbers.push_back(label.number);
+    label_names.push_back(label.name);
+  }
+  add_column(sections[LABELS], label_segs);
+  add_column(sections[LABELS], label_offsets);
+  add_column(sections[LABELS], label_numbers);
+  add_strings(sections[LABELS], label_names);
+
+  // functions and their instructions
+  std::vector<int32_t> starts, ends, method_ids, atom_values;
+  std::vector<uint8_t> name_kinds, n_srcs, n_dsts, cop2_dests, cop2_bcs, ils, atom_kinds;
+  std::vector<uint16_t> ops;
+  std::vector<std::string> function_names, type_names, headers, footers;
+
+  auto add_atom = [&](const InstructionAtom& atom) {
+    int32_t value = 0;
+    switch (atom.kind) {
+      case InstructionAtom::REGISTER:
+        value = (atom.get_reg().get_kind() << 8) | register_number(atom.get_reg());
+        break;
+      case InstructionAtom::IMM:
+        value = atom.get_imm();
+        break;
+      case InstructionAtom::IMM_SYM:
+        value = symbols.intern(atom.get_sym());
+        break;
+      case InstructionAtom::LABEL:
+        value = atom.get_label();
+        break;
+      default:
+        break;
+    }
+    atom_kinds.push_back(atom.kind);
+    atom_values.push_back(value);
+  };
+
+  for (int seg = 0; seg < file.segments; seg++) {
+    for (auto& func : file.functions_by_seg.at(seg)) {
+      assert(int(func.instructions.size()) == func.end_word - func.start_word);
+      starts.push_back(func.start_word);
+      ends.push_back(func.end_word);
+      name_kinds.push_back(uint8_t(func.guessed_name.kind));
+      method_ids.push_back(func.guessed_name.method_id);
+      function_names.push_back(func.guessed_name.function_name);
+      type_names.push_back(func.guessed_name.type_name);
+      auto text = LinkedObjectFile::print_function_analysis(func);
+      headers.push_back(std::move(text.header));
+      footers.push_back(std::move(text.footer));
+
+      for (auto& instr : func.instructions) {
+        ops.push_back(uint16_t(instr.kind));
+        n_srcs.push_back(instr.n_src);
+        n_dsts.push_back(instr.n_dst);
+        cop2_dests.push_back(instr.cop2_dest);
+        cop2_bcs.push_back(instr.cop2_bc);
+        ils.push_back(instr.il);
+        for (int i = 0; i < instr.n_src; i++) {
+          add_atom(instr.src[i]);
+        }
+        for (int i = 0; i < instr.n_dst; i++) {
+          add_atom(instr.dst[i]);
+        }
+      }
+    }
+  }
+  add_column(sections[FUNCTIONS], starts);
+  add_column(sections[FUNCTIONS], ends);
+  add_column(sections[FUNCTIONS], name_kinds);
+  add_column(sections[FUNCTIONS], method_ids);
+  add_strings(sections[FUNCTIONS], function_names);
+  add_strings(sections[FUNCTIONS], type_names);
+  add_strings(sections[FUNCTIONS], headers);
+  add_strings(sections[FUNCTIONS], footers);
+  add_column(sections[INSTRUCTIONS], ops);
+  add_column(sections[INSTRUCTIONS], n_srcs);
+  add_column(sections[INSTRUCTIONS], n_dsts);
+  add_column(sections[INSTRUCTIONS], cop2_dests);
+  add_column(sections[INSTRUCTIONS], cop2_bcs);
+  add_column(sections[INSTRUCTIONS], ils);
+  add_column(sections[ATOMS], atom_kinds);
+  add_column(sections[ATOMS], atom_values);
+
+  // symbols go last, once words and instructions have added all of theirs.
+  std::vector<std::string> symbol_names;
+  for (int i = 0; i < symbols.size(); i++) {
+    symbol_names.push_back(symbols.name(i));
+  }
+  add_strings(sections[SYMBOLS], symbol_names);
+
+  // header, then the sections
+  std::vector<lzo_align_t> work_mem((LZO1X_1_MEM_COMPRESS + sizeof(lzo_align_t) - 1) /
+                                    sizeof(lzo_align_t));
+  BinaryWriter result;
+  result.add_data(MAGIC, sizeof(MAGIC));
+  result.add<uint32_t>(VERSION);
+  result.add<uint32_t>(name.size());
+  result.add_data(name.data(), name.size());
+  result.add<uint32_t>(SECTION_COUNT);
+
+  std::vector<std::vector<uint8_t>> compressed;
+  for (uint32_t i = 0; i < SECTION_COUNT; i++) {
+    compressed.push_back(compress(sections[i], work_mem));
+    result.add<uint32_t>(i);
+    result.add<uint32_t>(sections[i].get_size());
+    result.add<uint32_t>(compressed.back().size());  // same as the size if not compressed
+  }
+  for (auto& section : compressed) {
+    result.add_data(section.data(), section.size());
+  }
+
+  auto* data = (const uint8_t*)result.get_data();
+  return std::vector<uint8_t>(data, data + result.get_size());
+}
+
+/*!
+ * Read a dump and rebuild the object file.
+ */
+ObjectDump::ObjectDump(const std::vector<uint8_t>& data) {
+  init_lzo();
+  DumpReader header(data);
+  check(!memcmp(header.take(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)), "wrong magic");
+  check(header.read<uint32_t>() == VERSION, "unsupported version");
+  m_name = header.read_string(header.read<uint32_t>());
+  check(header.read<uint32_t>() == SECTION_COUNT, "wrong section count");
+
+  std::vector<uint32_t> sizes, stored_sizes;
+  for (uint32_t i = 0; i < SECTION_COUNT; i++) {
+    check(header.read<uint32_t>() == i, "sections out of order");
+    sizes.push_back(header.read<uint32_t>());
+    stored_sizes.push_back(header.read<uint32_t>());
+    // LZO can't compress by more than about 255 times, so anything bigger is corrupt.
+    check(stored_sizes.back() <= sizes.back() &&
+              sizes.back() <= uint64_t(stored_sizes.back()) * 256 + 256,
+          "bad section size");
+  }
+
+  std::vector<std::vector<uint8_t>> sections;
+  for (uint32_t i = 0; i < SECTION_COUNT; i++) {
+    auto* src = header.take(stored_sizes.at(i));
+    if (stored_sizes.at(i) == sizes.at(i)) {
+      sections.emplace_back(src, src + sizes.at(i));
+    } else {
+      sections.emplace_back(sizes.at(i));
+      lzo_uint size = sizes.at(i);
+      auto rv = lzo1x_decompress_safe(src, stored_sizes.at(i), sections.back().data(), &size,
+                                      nullptr);
+      check(rv == LZO_E_OK && size == sizes.at(i), "failed to decompress");
+    }
+  }
+  header.expect_end();
+
+  // segments
+  DumpReader seg_reader(sections[SEGMENTS]);
+  auto word_counts = seg_reader.read_column<uint32_t>();
+  auto data_starts = seg_reader.read_column<uint32_t>();
+  auto function_counts = seg_reader.read_column<uint32_t>();
+  seg_reader.expect_end();
+  int n_segs = int(word_counts.size());
+  check(n_segs <= 3, "too many segments");
+  check(data_starts.size() == word_counts.size(), "wrong data start count");
+  check(function_counts.size() == word_counts.size(), "wrong function count");
+  m_file.symbol_table = &m_symbols;
+  m_file.set_segment_count(n_segs);
+  m_function_text.resize(n_segs);
+
+  // symbols
+  DumpReader symbol_reader(sections[SYMBOLS]);
+  auto symbol_names = symbol_reader.read_strings();
+  symbol_reader.expect_end();
+  for (size_t i = 0; i < symbol_names.size(); i++) {
+    check(m_symbols.intern(symbol_names[i]) == int(i), "duplicate symbol");
+  }
+
+  // words, without their links, so labels can be added.
+  DumpReader word_reader(sections[WORDS]), kind_reader(sections[WORD_KINDS]),
+      link_reader(sections[WORD_LINKS]);
+  auto words = word_reader.read_column<uint32_t>();
+  auto word_kinds = kind_reader.read_column<uint8_t>();
+  auto links = link_reader.read_column<uint32_t>();
+  word_reader.expect_end();
+  kind_reader.expect_end();
+  link_reader.expect_end();
+  check(word_kinds.size() == words.size(), "wrong word kind count");
+
+  size_t word_idx = 0;
+  for (int seg = 0; seg < n_segs; seg++) {
+    check(word_counts[seg] <= words.size() - word_idx, "wrong word count");
+    check(data_starts[seg] <= word_counts[seg], "data starts after the end of the segment");
+    for (uint32_t i = 0; i < word_counts[seg]; i++) {
+      m_file.push_back_word_to_segment(words[word_idx++], seg);
+    }
+    m_file.offset_of_data_zone_by_seg.at(seg) = data_starts[seg];
+  }
+  check(word_idx == words.size(), "wrong word count");
+
+  // labels
+  DumpReader label_reader(sections[LABELS]);
+  auto label_segs = label_reader.read_column<uint8_t>();
+  auto label_offsets = label_reader.read_column<int32_t>();
+  auto label_numbers = label_reader.read_column<int32_t>();
+  auto label_names = label_reader.read_strings();
+  label_reader.expect_end();
+  check(label_offsets.size() == label_segs.size() && label_numbers.size() == label_segs.size() &&
+            label_names.size() == label_segs.size(),
+        "wrong label column size");
+  for (size_t i = 0; i < label_segs.size(); i++) {
+    // labels from split pointers aren't checked to be inside their segment, but they are always in
+    // the object file. This also stops a bad offset from making a huge table in get_label_id_for.
+    check(label_segs[i] < n_segs && label_offsets[i] >= 0 &&
+              size_t(label_offsets[i] / 4) <= words.size(),
+          "bad label");
+    // the disassembly can't print these.
+    check(label_offsets[i] % 4 == 0 || label_offsets[i] / 4 >= int(data_starts[label_segs[i]]),
+          "label in the middle of an instruction");
+    check(m_file.get_label_id_for(label_segs[i], label_offsets[i]) == int(i), "duplicate label");
+    auto& label = m_file.labels.back();
+    label.number = label_numbers[i];
+    label.name = std::move(label_names[i]);
+  }
+
+  // links
+  size_t link_idx = 0;
+  word_idx = 0;
+  for (int seg = 0; seg < n_segs; seg++) {
+    for (auto& word : m_file.words_by_seg.at(seg)) {
+      auto kind = LinkedWord::Kind(word_kinds[word_idx++]);
+      check(kind <= LinkedWord::TYPE_PTR, "bad word kind");
+      if (kind == LinkedWord::PLAIN_DATA) {
+        continue;
+      }
+      check(link_idx < links.size(), "wrong link count");
+      auto id = links[link_idx++];
+      if (kind == LinkedWord::PTR || kind == LinkedWord::HI_PTR || kind == LinkedWord::LO_PTR) {
+        check(id < m_file.labels.size(), "bad label id");
+        word.set_to_label(kind, id);
+      } else {
+        check(id < uint32_t(m_symbols.size()), "bad symbol id");
+        word.set_to_symbol(kind, id);
+      }
+    }
+  }
+  check(link_idx == links.size(), "wrong link count");
+
+  // functions and their instructions
+  DumpReader func_reader(sections[FUNCTIONS]);
+  auto starts = func_reader.read_column<int32_t>();
+  auto ends = func_reader.read_column<int32_t>();
+  auto name_kinds = func_reader.read_column<uint8_t>();
+  auto method_ids = func_reader.read_column<int32_t>();
+  auto function_names = func_reader.read_strings();
+  auto type_names = func_reader.read_strings();
+  auto headers = func_reader.read_strings();
+  auto footers = func_reader.read_strings();
+  func_reader.expect_end();
+  size_t n_funcs = starts.size();
+  check(ends.size() == n_funcs && name_kinds.size() == n_funcs && method_ids.size() == n_funcs &&
+            function_names.size() == n_funcs && type_names.size() == n_funcs &&
+            headers.size() == n_funcs && footers.size() == n_funcs,
+        "wrong function column size");
+
+  DumpReader instr_reader(sections[INSTRUCTIONS]);
+  auto ops = instr_reader.read_column<uint16_t>();
+  auto n_srcs = instr_reader.read_column<uint8_t>();
+  auto n_dsts = instr_reader.read_column<uint8_t>();
+  auto cop2_dests = instr_reader.read_column<uint8_t>();
+  auto cop2_bcs = instr_reader.read_column<uint8_t>();
+  auto ils = instr_reader.read_column<uint8_t>();
+  instr_reader.expect_end();
+  size_t n_instrs = ops.size();
+  check(n_srcs.size() == n_instrs && n_dsts.size() == n_instrs && cop2_dests.size() == n_instrs &&
+            cop2_bcs.size() == n_instrs && ils.size() == n_instrs,
+        "wrong instruction column size");
+
+  DumpReader atom_reader(sections[ATOMS]);
+  auto atom_kinds = atom_reader.read_column<uint8_t>();
+  auto atom_values = atom_reader.read_column<int32_t>();
+  atom_reader.expect_end();
+  check(atom_values.size() == atom_kinds.size(), "wrong atom column size");
+
+  size_t atom_idx = 0;
+  auto read_atom = [&]() {
+    check(atom_idx < atom_kinds.size(), "wrong atom count");
+    InstructionAtom atom;
+    auto value = atom_values[atom_idx];
+    switch (atom_kinds[atom_idx++]) {
+      case InstructionAtom::REGISTER: {
+        auto reg_kind = uint32_t(value) >> 8;
+        auto num = uint32_t(value) & 0xff;
+        check(reg_kind < Reg::MAX_KIND && num < (reg_kind == Reg::PCR ? 2u : 32u), "bad register");
+        atom.set_reg(Register(Reg::RegisterKind(reg_kind), num));
+      } break;
+      case InstructionAtom::IMM:
+        atom.set_imm(value);
+        break;
+      case InstructionAtom::IMM_SYM:
+        check(value >= 0 && value < m_symbols.size(), "bad symbol id");
+        atom.set_sym(m_symbols.name(value));
+        break;
+      case InstructionAtom::LABEL:
+        check(value >= 0 && value < int(m_file.labels.size()), "bad label id");
+        atom.set_label(value);
+        break;
+      case InstructionAtom::VU_ACC:
+        atom.set_vu_acc();
+        break;
+      case InstructionAtom::VU_Q:
+        atom.set_vu_q();
+        break;
+      case InstructionAtom::INVALID:
+        break;
+      default:
+        check(false, "bad atom kind");
+    }
+    return atom;
+  };
+
+  size_t func_idx = 0, instr_idx = 0;
+  for (int seg = 0; seg < n_segs; seg++) {
+    check(function_counts[seg] <= n_funcs - func_idx, "wrong function count");
+    for (uint32_t i = 0; i < function_counts[seg]; i++, func_idx++) {
+      auto start = starts[func_idx], end = ends[func_idx];
+      check(start >= 0 && start <= end && end <= int(word_counts[seg]), "bad function bounds");
+      check(name_kinds[func_idx] <= uint8_t(FunctionName::FunctionKind::TOP_LEVEL_INIT),
+            "bad function name");
+      m_file.functions_by_seg.at(seg).emplace_back(start, end);
+      auto& func = m_file.functions_by_seg.at(seg).back();
+      func.segment = seg;
+      func.guessed_name.kind = FunctionName::FunctionKind(name_kinds[func_idx]);
+      func.guessed_name.method_id = method_ids[func_idx];
+      func.guessed_name.function_name = std::move(function_names[func_idx]);
+      func.guessed_name.type_name = std::move(type_names[func_idx]);
+      m_function_text.at(seg).push_back(
+          {std::move(headers[func_idx]), std::move(footers[func_idx])});
+
+      check(size_t(end - start) <= n_instrs - instr_idx, "wrong instruction count");
+      for (int word = start; word < end; word++, instr_idx++) {
+        Instruction instr;
+        check(ops[instr_idx] < uint16_t(InstructionKind::EE_OP_MAX), "bad instruction kind");
+        check(n_srcs[instr_idx] <= MAX_INSTRUCTION_SOURCE &&
+                  n_dsts[instr_idx] <= MAX_INTRUCTION_DEST,
+              "bad atom count");
+        // loads and stores are printed as offset(base), which needs all of their atoms.
+        auto& info = gOpcodeInfo[ops[instr_idx]];
+        check(!info.is_store || (n_srcs[instr_idx] == 3 && n_dsts[instr_idx] == 0),
+              "bad store atom count");
+        check(!info.is_load || (n_srcs[instr_idx] == 2 && n_dsts[instr_idx] == 1),
+              "bad load atom count");
+        instr.kind = InstructionKind(ops[instr_idx]);
+        instr.cop2_dest = cop2_dests[instr_idx];
+        instr.cop2_bc = cop2_bcs[instr_idx];
+        instr.il = ils[instr_idx];
+        for (int j = 0; j < n_srcs[instr_idx]; j++) {
+          auto atom = read_atom();
+          instr.add_src(atom);
+        }
+        for (int j = 0; j < n_dsts[instr_idx]; j++) {
+          auto atom = read_atom();
+          instr.add_dst(atom);
+        }
+        func.instructions.push_back(instr);
+      }
+    }
+  }
+  check(func_idx == n_funcs, "wrong function count");
+  check(instr_idx == n_instrs, "wrong instruction count");
+  check(atom_idx == atom_kinds.size(), "wrong atom count");
+}
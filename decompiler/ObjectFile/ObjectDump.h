@@ -0,0 +1,44 @@
+#pragma once
+
+/*!
+ * @file ObjectDump.h
+ * A compact binary dump of an analyzed object file, which can be printed in the same text formats
+ * as the .txt and .func dumps without the original DGO files.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "LinkedObjectFile.h"
+#include "LinkedWord.h"
+
+/*!
+ * The dump is a header, then sections for segments, words, link kinds, link ids, symbols, labels,
+ * functions, instructions and instruction atoms. Each section is a few columns of a single type,
+ * so similar values are next to each other, and is LZO compressed unless that doesn't make it
+ * smaller. Symbols are renumbered to only the ones this object uses.
+ *
+ * Reading a dump rebuilds a LinkedObjectFile with its labels, links and decoded instructions. The
+ * analysis of each function is only stored as the text which is printed around its instructions.
+ */
+class ObjectDump {
+ public:
+  static std::vector<uint8_t> write(const LinkedObjectFile& file, const std::string& name);
+
+  // throws std::runtime_error if data isn't a valid dump.
+  explicit ObjectDump(const std::vector<uint8_t>& data);
+  ObjectDump(const ObjectDump&) = delete;
+  ObjectDump& operator=(const ObjectDump&) = delete;
+
+  const std::string& name() const { return m_name; }
+  std::string print_words() { return m_file.print_words(); }
+  std::string print_disassembly(bool write_hex) {
+    return m_file.print_disassembly(write_hex, m_function_text);
+  }
+
+ private:
+  std::string m_name;
+  LinkedSymbolTable m_symbols;
+  LinkedObjectFile m_file;
+  std::vector<std::vector<LinkedObjectFile::FunctionText>> m_function_text;
+};
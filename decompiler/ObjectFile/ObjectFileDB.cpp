@@ -10,15 +10,38 @@
 #include <set>
 #include <cstring>
 #include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
 #include "LinkedObjectFileCreation.h"
 #include "decompiler/config.h"
-#include "third-party/minilzo/minilzo.h"
+#include "DgoDecompressor.h"
+#include "ObjectDump.h"
 #include "common/util/BinaryReader.h"
 #include "decompiler/util/FileIO.h"
 #include "common/util/Timer.h"
 #include "common/util/FileUtil.h"
 #include "decompiler/Function/BasicBlocks.h"
 
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+namespace {
+/*!
+ * Get the most memory this process has used so far, in MB, or -1 if we don't know how.
+ */
+double get_peak_rss_mb() {
+#ifdef __linux__
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    return usage.ru_maxrss / 1024.0;  // kB
+  }
+#endif
+  return -1;
+}
+}  // namespace
+
 /*!
  * Get a unique name for this object file.
  */
@@ -76,6 +99,16 @@ ObjectFileDB::ObjectFileDB(const std::vector<std::string>& _dgos) {
   printf(" total objs: %d\n", stats.total_obj_files);
   printf(" unique objs: %d\n", stats.unique_obj_files);
   printf(" unique data: %d bytes\n", stats.unique_obj_bytes);
+  if (stats.total_decompressed_bytes) {
+    // a small enough DGO can decompress in less time than the timer resolution.
+    double decompress_mb_per_sec =
+        stats.total_decompress_ms > 0
+            ? stats.total_decompressed_bytes / ((1u << 20u) * stats.total_decompress_ms / 1000.)
+            : 0.;
+    printf(" decompressed: %d bytes in %.1f ms (%.3f MB/sec, %d threads)\n",
+           stats.total_decompressed_bytes, stats.total_decompress_ms, decompress_mb_per_sec,
+           stats.decompress_threads);
+  }
   printf(" total %.1f ms (%.3f MB/sec, %.3f obj/sec)\n", timer.getMs(),
          stats.total_dgo_bytes / ((1u << 20u) * timer.getSeconds()),
          stats.total_obj_files / timer.getSeconds());
@@ -138,7 +171,6 @@ std::string get_object_file_name(const std::string& original_name, uint8_t* data
 }
 }  // namespace
 
-constexpr int MAX_CHUNK_SIZE = 0x8000;
 /*!
  * Load the objects stored in the given DGO into the ObjectFileDB
  */
@@ -146,58 +178,20 @@ void ObjectFileDB::get_objs_from_dgo(const std::string& filename) {
   auto dgo_data = file_util::read_binary_file(filename);
   stats.total_dgo_bytes += dgo_data.size();
 
-  const char jak2_header[] = "oZlB";
-  bool is_jak2 = true;
-  for (int i = 0; i < 4; i++) {
-    if (jak2_header[i] != dgo_data[i]) {
-      is_jak2 = false;
-    }
+  // Jak 2 DGOs are compressed. Objects are read while the rest is still being decompressed.
+  std::unique_ptr<DgoDecompressor> decompressor;
+  if (DgoDecompressor::is_compressed(dgo_data)) {
+    decompressor = std::make_unique<DgoDecompressor>(dgo_data);
   }
-
-  if (is_jak2) {
-    if (lzo_init() != LZO_E_OK) {
-      assert(false);
+  auto& data = decompressor ? decompressor->data() : dgo_data;
+  auto wait_for = [&](size_t end) {
+    if (decompressor) {
+      decompressor->wait_for(std::min(end, data.size()));
     }
-    BinaryReader compressed_reader(dgo_data);
-    // seek past oZlB
-    compressed_reader.ffwd(4);
-    auto decompressed_size = compressed_reader.read<uint32_t>();
-    std::vector<uint8_t> decompressed_data;
-    decompressed_data.resize(decompressed_size);
-    size_t output_offset = 0;
-    while (true) {
-      // seek past alignment bytes and read the next chunk size
-      uint32_t chunk_size = 0;
-      while (!chunk_size) {
-        chunk_size = compressed_reader.read<uint32_t>();
-      }
+  };
 
-      if (chunk_size < MAX_CHUNK_SIZE) {
-        lzo_uint bytes_written;
-        auto lzo_rv =
-            lzo1x_decompress(compressed_reader.here(), chunk_size,
-                             decompressed_data.data() + output_offset, &bytes_written, nullptr);
-        assert(lzo_rv == LZO_E_OK);
-        compressed_reader.ffwd(chunk_size);
-        output_offset += bytes_written;
-      } else {
-        // nope - sometimes chunk_size is bigger than MAX, but we should still use max.
-        //        assert(chunk_size == MAX_CHUNK_SIZE);
-        memcpy(decompressed_data.data() + output_offset, compressed_reader.here(), MAX_CHUNK_SIZE);
-        compressed_reader.ffwd(MAX_CHUNK_SIZE);
-        output_offset += MAX_CHUNK_SIZE;
-      }
-
-      if (output_offset >= decompressed_size)
-        break;
-      while (compressed_reader.get_seek() % 4) {
-        compressed_reader.ffwd(1);
-      }
-    }
-    dgo_data = decompressed_data;
-  }
-
-  BinaryReader reader(dgo_data);
+  BinaryReader reader(data);
+  wait_for(sizeof(DgoHeader));
   auto header = reader.read<DgoHeader>();
 
   auto dgo_base_name = base_name(filename);
@@ -206,9 +200,11 @@ void ObjectFileDB::get_objs_from_dgo(const std::string& filename) {
 
   // get all obj files...
   for (uint32_t i = 0; i < header.size; i++) {
+    wait_for(reader.get_seek() + sizeof(DgoHeader));
     auto obj_header = reader.read<DgoHeader>();
     assert(reader.bytes_left() >= obj_header.size);
     assert_string_empty_after(obj_header.name, 60);
+    wait_for(reader.get_seek() + obj_header.size);
 
     auto name = get_object_file_name(obj_header.name, reader.here(), obj_header.size);
 
@@ -218,6 +214,13 @@ void ObjectFileDB::get_objs_from_dgo(const std::string& filename) {
 
   // check we're at the end
   assert(0 == reader.bytes_left());
+
+  if (decompressor) {
+    decompressor->wait_for_all();
+    stats.total_decompressed_bytes += data.size();
+    stats.total_decompress_ms += decompressor->decompress_ms();
+    stats.decompress_threads = std::max(stats.decompress_threads, decompressor->thread_count());
+  }
 }
 
 /*!
@@ -352,12 +355,17 @@ std::string ObjectFileDB::generate_obj_listing() {
 void ObjectFileDB::process_link_data() {
   printf("- Processing Link Data...\n");
   Timer process_link_timer;
+  double peak_rss_before = get_peak_rss_mb();
 
   LinkedObjectFile::Stats combined_stats;
+  uint64_t total_words = 0;
 
   for_each_obj([&](ObjectFileData& obj) {
-    obj.linked_data = to_linked_object_file(obj.data, obj.record.name);
+    obj.linked_data = to_linked_object_file(obj.data, obj.record.name, &symbol_table);
     combined_stats.add(obj.linked_data.stats);
+    for (auto& seg : obj.linked_data.words_by_seg) {
+      total_words += seg.size();
+    }
   });
 
   printf("Processed Link Data:\n");
@@ -379,6 +387,11 @@ void ObjectFileDB::process_link_data() {
   printf(" v3 offset symbol links %d\n", combined_stats.v3_symbol_link_offset);
   printf(" v3 word symbol links %d\n", combined_stats.v3_symbol_link_word);
 
+  printf(" words %lu, %d bytes/word (%.3f MB)\n", (unsigned long)total_words,
+         (int)sizeof(LinkedWord), total_words * sizeof(LinkedWord) / (1024.0 * 1024.0));
+  printf(" unique symbols %d\n", symbol_table.size());
+  printf(" peak RSS %.1f MB -> %.1f MB\n", peak_rss_before, get_peak_rss_mb());
+
   printf(" total %.3f ms\n", process_link_timer.getMs());
   printf("\n");
 }
@@ -398,6 +411,48 @@ void ObjectFileDB::process_labels() {
   printf("\n");
 }
 
+/*!
+ * Time how long it takes to look up labels, the same way that the printers and disassembler do.
+ */
+void ObjectFileDB::benchmark_label_resolution() {
+  printf("- Benchmarking label resolution...\n");
+  constexpr int RUNS = 10;
+  uint64_t lookups = 0, found = 0;
+  Timer timer;
+
+  for (int run = 0; run < RUNS; run++) {
+    for_each_obj([&](ObjectFileData& obj) {
+      auto& file = obj.linked_data;
+      // every byte of every segment, like print_words
+      for (int seg = 0; seg < file.segments; seg++) {
+        int end = int(file.words_by_seg.at(seg).size()) * 4;
+        for (int offset = 0; offset < end; offset++) {
+          lookups++;
+          if (file.get_label_at(seg, offset) != -1) {
+            found++;
+          }
+        }
+      }
+
+      // every existing label, like linking and process_fp_relative_links
+      for (int i = 0; i < int(file.labels.size()); i++) {
+        auto& label = file.labels[i];
+        lookups++;
+        if (file.get_label_id_for(label.target_segment, label.offset) == i) {
+          found++;
+        }
+      }
+    });
+  }
+
+  auto ms = timer.getMs();
+  printf("Benchmarked label resolution:\n");
+  printf(" %lu lookups, %lu found\n", (unsigned long)(lookups / RUNS),
+         (unsigned long)(found / RUNS));
+  printf(" %.3f ms per run, %.2f ns per lookup\n", ms / RUNS, ms * 1e6 / double(lookups));
+  printf("\n");
+}
+
 /*!
  * Dump object files and their linking data to text files for debugging
  */
@@ -456,6 +511,59 @@ void ObjectFileDB::write_disassembly(const std::string& output_dir,
   printf("\n");
 }
 
+/*!
+ * Write a binary dump of each object file, and compare it to the text of the hexdump and
+ * disassembly.
+ * Each dump is read back and printed, to check that it gives the same text.
+ */
+void ObjectFileDB::write_object_dumps(const std::string& output_dir) {
+  printf("- Writing object dumps...\n");
+  uint64_t total_dump_bytes = 0, total_text_bytes = 0;
+  double dump_ms = 0, text_ms = 0, read_ms = 0;
+  int total_files = 0, mismatches = 0;
+
+  for_each_obj([&](ObjectFileData& obj) {
+    auto name = obj.record.to_unique_name();
+    Timer dump_timer;
+    auto dump = ObjectDump::write(obj.linked_data, name);
+    auto file_name = combine_path(output_dir, name + ".dump");
+    file_util::write_binary_file(file_name, dump.data(), dump.size());
+    dump_ms += dump_timer.getMs();
+    total_dump_bytes += dump.size();
+    total_files++;
+
+    // the text is only printed, not written, so this doesn't include the time to write it.
+    Timer text_timer;
+    auto words = obj.linked_data.print_words();
+    auto disassembly = obj.linked_data.print_disassembly();
+    text_ms += text_timer.getMs();
+    total_text_bytes += words.size() + disassembly.size();
+
+    Timer read_timer;
+    ObjectDump read_back(dump);
+    bool match = read_back.print_words() == words &&
+                 read_back.print_disassembly(get_config().write_hex_near_instructions) ==
+                     disassembly;
+    read_ms += read_timer.getMs();
+    if (!match) {
+      printf("object dump of %s doesn't match its text!\n", name.c_str());
+      mismatches++;
+    }
+  });
+
+  printf("Wrote object dumps:\n");
+  printf(" total %d files\n", total_files);
+  printf(" dumps %.3f MB in %.3f ms\n", total_dump_bytes / ((float)(1u << 20u)), dump_ms);
+  printf(" text  %.3f MB in %.3f ms (not written)\n", total_text_bytes / ((float)(1u << 20u)),
+         text_ms);
+  if (total_text_bytes) {
+    printf(" dumps are %.2f%% of the size of the text\n",
+           100.0 * total_dump_bytes / total_text_bytes);
+  }
+  printf(" read back and printed in %.3f ms, %d mismatched\n", read_ms, mismatches);
+  printf("\n");
+}
+
 /*!
  * Find code/data zones, identify functions, and disassemble
  */
@@ -506,9 +614,14 @@ void ObjectFileDB::find_and_write_scripts(const std::string& output_dir) {
   printf("- Finding scripts in object files...\n");
   Timer timer;
   std::string all_scripts;
+  int total_forms = 0, total_blocks = 0;
 
   for_each_obj([&](ObjectFileData& obj) {
-    auto scripts = obj.linked_data.print_scripts();
+    // the forms for each object are freed together once it's printed.
+    FormPool pool;
+    auto scripts = obj.linked_data.print_scripts(pool);
+    total_forms += pool.size();
+    total_blocks += pool.blocks();
     if (!scripts.empty()) {
       all_scripts += ";--------------------------------------\n";
       all_scripts += "; " + obj.record.to_unique_name() + "\n";
@@ -521,10 +634,58 @@ void ObjectFileDB::find_and_write_scripts(const std::string& output_dir) {
   file_util::write_text_file(file_name, all_scripts);
 
   printf("Found scripts:\n");
+  printf(" total %d forms in %d allocations\n", total_forms, total_blocks);
   printf(" total %.3f ms\n", timer.getMs());
   printf("\n");
 }
 
+/*!
+ * Time the linear pretty printer against the legacy one on all scripts, the same way that
+ * find_and_write_scripts prints them, and check that they agree.
+ */
+void ObjectFileDB::benchmark_pretty_print() {
+  printf("- Benchmarking pretty printer...\n");
+  FormPool pool;
+  std::vector<Form*> scripts;
+  for_each_obj([&](ObjectFileData& obj) {
+    for (auto* script : obj.linked_data.find_scripts(pool)) {
+      scripts.push_back(script);
+    }
+  });
+
+  std::vector<std::string> legacy_result, linear_result;
+  Timer legacy_timer;
+  for (auto& script : scripts) {
+    legacy_result.push_back(script->toStringPrettyLegacy(0, 100));
+  }
+  auto legacy_ms = legacy_timer.getMs();
+
+  Timer linear_timer;
+  for (auto& script : scripts) {
+    linear_result.push_back(script->toStringPretty(0, 100));
+  }
+  auto linear_ms = linear_timer.getMs();
+
+  int mismatches = 0;
+  uint64_t total_bytes = 0;
+  for (size_t i = 0; i < scripts.size(); i++) {
+    total_bytes += linear_result[i].size();
+    if (legacy_result[i] != linear_result[i]) {
+      if (!mismatches) {
+        printf("pretty printer mismatch!\nlegacy:\n%s\nlinear:\n%s\n", legacy_result[i].c_str(),
+               linear_result[i].c_str());
+      }
+      mismatches++;
+    }
+  }
+
+  printf("Benchmarked pretty printer:\n");
+  printf(" %d scripts, %.3f MB\n", int(scripts.size()), total_bytes / ((float)(1u << 20u)));
+  printf(" legacy %.3f ms, linear %.3f ms\n", legacy_ms, linear_ms);
+  printf(" %d mismatched\n", mismatches);
+  printf("\n");
+}
+
 void ObjectFileDB::analyze_functions() {
   printf("- Analyzing Functions...\n");
   Timer timer;
@@ -596,14 +757,77 @@ void ObjectFileDB::analyze_functions() {
   if (get_config().find_basic_blocks) {
     timer.start();
     int total_basic_blocks = 0;
+    int total_loops = 0;
+    int functions_with_loops = 0;
+    int irreducible_functions = 0;
+    int max_loop_depth = 0;
+    double cfg_ms = 0;
+    Timer cfg_timer;
+
+    // functions that are the same in different versions of an object file are only analyzed once.
+    struct AnalyzedFunction {
+      const Function* func;
+      const LinkedObjectFile* file;
+      int seg;
+      bool was_asm;          // suspected_asm before the analysis
+      std::string warnings;  // added by the analysis
+    };
+    std::unordered_map<uint64_t, std::vector<AnalyzedFunction>> analyzed_by_hash;
+    int reused_functions = 0, reused_words = 0;
+    int all_functions = 0, total_words = 0;
+
     for_each_function([&](Function& func, int segment_id, ObjectFileData& data) {
-      auto blocks = find_blocks_in_function(data.linked_data, segment_id, func);
-      total_basic_blocks += blocks.size();
-      func.basic_blocks = blocks;
+      uint64_t hash = func.code_hash(data.linked_data, segment_id);
+      const AnalyzedFunction* original = nullptr;
+      for (auto& candidate : analyzed_by_hash[hash]) {
+        if (candidate.was_asm == func.suspected_asm &&
+            func.same_code(data.linked_data, segment_id, *candidate.func, *candidate.file,
+                           candidate.seg)) {
+          original = &candidate;
+          break;
+        }
+      }
+      all_functions++;
+      total_words += func.end_word - func.start_word;
+
+      if (original) {
+        func.copy_analysis_from(*original->func);
+        func.warnings += original->warnings;
+        reused_functions++;
+        reused_words += func.end_word - func.start_word;
+      } else {
+        bool was_asm = func.suspected_asm;
+        auto warnings_start = func.warnings.size();
+        func.basic_blocks = find_blocks_in_function(data.linked_data, segment_id, func);
+        if (!func.suspected_asm) {
+          func.analyze_prologue(data.linked_data);
+        }
+        link_basic_blocks(data.linked_data, segment_id, func);
+
+        if (!func.suspected_asm) {
+          func.dominators = std::make_shared<DominatorTree>(func.basic_blocks);
+          func.post_dominators = std::make_shared<DominatorTree>(func.basic_blocks, true);
+          func.loop_nest = std::make_shared<LoopNest>(func.basic_blocks, *func.dominators);
+          cfg_timer.start();
+          func.cfg = build_cfg(data.linked_data, segment_id, func);
+          cfg_ms += cfg_timer.getMs();
+        }
+
+        analyzed_by_hash[hash].push_back({&func, &data.linked_data, segment_id, was_asm,
+                                          func.warnings.substr(warnings_start)});
+      }
+      total_basic_blocks += func.basic_blocks.size();
 
       if (!func.suspected_asm) {
-        func.analyze_prologue(data.linked_data);
-        func.cfg = build_cfg(data.linked_data, segment_id, func);
+        total_loops += func.loop_nest->loops().size();
+        if (!func.loop_nest->loops().empty()) {
+          functions_with_loops++;
+        }
+        if (func.loop_nest->irreducible()) {
+          irreducible_functions++;
+        }
+        max_loop_depth = std::max(max_loop_depth, func.loop_nest->max_depth());
+
         total_functions++;
         if (func.cfg->is_fully_resolved()) {
           resolved_cfg_functions++;
@@ -634,6 +858,12 @@ void ObjectFileDB::analyze_functions() {
     printf("Named %d/%d functions (%.2f%%)\n", total_named_functions, total_functions,
            100.f * float(total_named_functions) / float(total_functions));
     printf("Found %d basic blocks in %.3f ms\n", total_basic_blocks, timer.getMs());
+    printf(" %d loops in %d functions (max depth %d), %d functions with irreducible loops\n",
+           total_loops, functions_with_loops, max_loop_depth, irreducible_functions);
+    printf(" build_cfg took %.3f ms\n", cfg_ms);
+    printf(" reused analysis of %d/%d functions with the same code (%.2f%% of words)\n",
+           reused_functions, all_functions,
+           100.f * float(reused_words) / float(std::max(total_words, 1)));
     printf(" %d/%d functions passed cfg analysis stage (%.2f%%)\n", resolved_cfg_functions,
            total_functions, 100.f * float(resolved_cfg_functions) / float(total_functions));
     printf(" %d/%d nontrivial cfg's resolved (%.2f%%)\n", total_resolved_nontrivial_functions,
@@ -646,5 +876,58 @@ void ObjectFileDB::analyze_functions() {
         printf("  %s\n", x.c_str());
       }
     }
+
+    if (config.run_dataflow) {
+      // dataflow only reads the function and its object file, so functions are analyzed in
+      // parallel.
+      timer.start();
+      std::vector<Function*> dataflow_funcs;
+      for_each_function([&](Function& func, int segment_id, ObjectFileData& data) {
+        (void)segment_id;
+        (void)data;
+        if (!func.suspected_asm) {
+          func.dataflow = std::make_shared<FunctionDataflow>();
+          dataflow_funcs.push_back(&func);
+        }
+      });
+
+      std::atomic<int> next_func(0);
+      auto dataflow_worker = [&]() {
+        for (int i = next_func++; i < int(dataflow_funcs.size()); i = next_func++) {
+          auto* func = dataflow_funcs.at(i);
+          func->dataflow->run(*func);
+        }
+      };
+
+      int n_threads = std::max(1, int(std::thread::hardware_concurrency()));
+      std::vector<std::thread> threads;
+      for (int i = 0; i < n_threads; i++) {
+        threads.emplace_back(dataflow_worker);
+      }
+      for (auto& t : threads) {
+        t.join();
+      }
+
+      FunctionDataflow::Stats totals;
+      for (auto* func : dataflow_funcs) {
+        const auto& st = func->dataflow->stats;
+        totals.blocks += st.blocks;
+        totals.instructions += st.instructions;
+        totals.def_sites += st.def_sites;
+        totals.iterations += st.iterations;
+        totals.uses += st.uses;
+        totals.uses_with_single_def += st.uses_with_single_def;
+        totals.constants += st.constants;
+      }
+
+      printf("Dataflow on %d functions (%d blocks, %d instructions) in %.3f ms with %d threads\n",
+             int(dataflow_funcs.size()), totals.blocks, totals.instructions, timer.getMs(),
+             n_threads);
+      printf(" %d definitions, %d solver iterations\n", totals.def_sites, totals.iterations);
+      printf(" %d/%d register uses have a single reaching definition (%.2f%%)\n",
+             totals.uses_with_single_def, totals.uses,
+             100.f * float(totals.uses_with_single_def) / float(std::max(totals.uses, 1)));
+      printf(" %d instructions produce a known constant\n", totals.constants);
+    }
   }
 }
@@ -49,14 +49,18 @@ class ObjectFileDB {
   void process_link_data();
   void process_labels();
   void find_code();
+  void benchmark_label_resolution();
   void find_and_write_scripts(const std::string& output_dir);
+  void benchmark_pretty_print();
 
   void write_object_file_words(const std::string& output_dir, bool dump_v3_only);
   void write_disassembly(const std::string& output_dir, bool disassemble_objects_without_functions);
+  void write_object_dumps(const std::string& output_dir);
   void analyze_functions();
   ObjectFileData& lookup_record(ObjectFileRecord rec);
 
  private:
+  friend class ObjectFileQuery;
   void get_objs_from_dgo(const std::string& filename);
   void add_obj_from_dgo(const std::string& obj_name,
                         const std::string& name_in_dgo,
@@ -104,11 +108,17 @@ class ObjectFileDB {
 
   std::vector<std::string> obj_file_order;
 
+  // names of all symbols linked to in any object file.
+  LinkedSymbolTable symbol_table;
+
   struct {
     uint32_t total_dgo_bytes = 0;
     uint32_t total_obj_files = 0;
     uint32_t unique_obj_files = 0;
     uint32_t unique_obj_bytes = 0;
+    uint32_t total_decompressed_bytes = 0;
+    double total_decompress_ms = 0;  // from starting each DGO until its last chunk was done
+    int decompress_threads = 0;
   } stats;
 };
 
@@ -0,0 +1,206 @@
+/*!
+ * @file ObjectFileQuery.cpp
+ * Indexes over an analyzed ObjectFileDB for answering lookups interactively, without writing and
+ * searching the text dumps.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include "ObjectFileQuery.h"
+#include "ObjectFileDB.h"
+#include "common/util/Timer.h"
+
+ObjectFileQuery::ObjectFileQuery(ObjectFileDB& db) : m_db(db) {
+  Timer timer;
+  m_refs_by_symbol.resize(db.symbol_table.size());
+
+  db.for_each_obj([&](ObjectFileData& obj) {
+    auto& file = obj.linked_data;
+    for (int seg = 0; seg < file.segments; seg++) {
+      // functions are in order, so the function containing each word is found in one pass.
+      const auto& funcs = file.functions_by_seg.at(seg);
+      size_t func_idx = 0;
+      const auto& words = file.words_by_seg.at(seg);
+      for (int word_idx = 0; word_idx < int(words.size()); word_idx++) {
+        while (func_idx < funcs.size() && funcs[func_idx].end_word <= word_idx) {
+          func_idx++;
+        }
+        const Function* func = nullptr;
+        if (func_idx < funcs.size() && funcs[func_idx].start_word <= word_idx) {
+          func = &funcs[func_idx];
+        }
+
+        if (words[word_idx].has_symbol()) {
+          m_refs_by_symbol.at(words[word_idx].symbol_id()).push_back({&obj, seg, word_idx, func});
+        }
+      }
+
+      for (auto& func : funcs) {
+        Location loc = {&obj, seg, func.start_word, &func};
+        if (func.guessed_name.kind == FunctionName::FunctionKind::METHOD) {
+          m_methods[{func.guessed_name.type_name, func.guessed_name.method_id}].push_back(loc);
+        }
+        if (!func.guessed_name.empty()) {
+          m_functions[func.guessed_name.to_string()].push_back(loc);
+        }
+      }
+    }
+  });
+
+  m_build_ms = timer.getMs();
+}
+
+std::string ObjectFileQuery::help() {
+  return "Queries:\n"
+         " sym <symbol>         objects and functions that reference a symbol\n"
+         " method <type> <id>   functions defining a method\n"
+         " func <name>          objects that define a function\n"
+         " cfg <name>           control flow of a function\n"
+         " asm <name>           instructions of a function\n"
+         " help                 show this\n"
+         " quit\n";
+}
+
+/*!
+ * Run a single query, and get the result as text.
+ */
+std::string ObjectFileQuery::run(const std::string& line) {
+  std::istringstream ss(line);
+  std::string cmd;
+  ss >> cmd;
+
+  // the rest of the line, since function names like (method 7 process) have spaces.
+  std::string arg;
+  std::getline(ss >> std::ws, arg);
+
+  if (cmd.empty()) {
+    return "";
+  } else if (cmd == "sym") {
+    return query_symbol(arg);
+  } else if (cmd == "method") {
+    std::istringstream args(arg);
+    std::string type_name;
+    int method_id = -1;
+    if (!(args >> type_name >> method_id)) {
+      return "usage: method <type> <id>\n";
+    }
+    return query_method(type_name, method_id);
+  } else if (cmd == "func") {
+    return query_function(arg);
+  } else if (cmd == "cfg") {
+    return query_cfg(arg);
+  } else if (cmd == "asm") {
+    return query_asm(arg);
+  } else if (cmd == "help") {
+    return help();
+  }
+  return "unknown query " + cmd + ", try help\n";
+}
+
+/*!
+ * Read queries from stdin until it ends or "quit", printing each result and how long it took.
+ */
+void ObjectFileQuery::repl() {
+  printf("Built query indexes in %.3f ms\n", m_build_ms);
+  printf("%s", help().c_str());
+  std::string line;
+  for (;;) {
+    printf("query> ");
+    fflush(stdout);
+    if (!std::getline(std::cin, line) || line == "quit") {
+      break;
+    }
+    Timer timer;
+    auto result = run(line);
+    printf("%s(%.3f ms)\n", result.c_str(), timer.getMs());
+  }
+}
+
+std::string ObjectFileQuery::describe(const Location& loc) {
+  std::string result = loc.obj->record.to_unique_name() + " seg " + std::to_string(loc.seg) +
+                       " word " + std::to_string(loc.word_idx);
+  if (loc.func) {
+    result += " in " + loc.func->guessed_name.to_string();
+  }
+  return result;
+}
+
+std::string ObjectFileQuery::query_symbol(const std::string& name) {
+  int id = m_db.symbol_table.find(name);
+  if (id == -1 || m_refs_by_symbol.at(id).empty()) {
+    return "no references to " + name + "\n";
+  }
+
+  const auto& refs = m_refs_by_symbol.at(id);
+  std::string result = std::to_string(refs.size()) + " references to " + name + "\n";
+  for (auto& ref : refs) {
+    result += " " + describe(ref) + "\n";
+  }
+  return result;
+}
+
+std::string ObjectFileQuery::query_method(const std::string& type_name, int method_id) {
+  auto it = m_methods.find({type_name, method_id});
+  if (it == m_methods.end()) {
+    return "no definitions of method " + std::to_string(method_id) + " of " + type_name + "\n";
+  }
+  std::string result;
+  for (auto& loc : it->second) {
+    result += describe(loc) + "\n";
+  }
+  return result;
+}
+
+std::string ObjectFileQuery::query_function(const std::string& name) {
+  auto it = m_functions.find(name);
+  if (it == m_functions.end()) {
+    return "no function named " + name + "\n";
+  }
+  std::string result;
+  for (auto& loc : it->second) {
+    result += describe(loc) + ", " + std::to_string(loc.func->end_word - loc.func->start_word) +
+              " words\n";
+    if (!loc.func->warnings.empty()) {
+      result += loc.func->warnings + "\n";
+    }
+  }
+  return result;
+}
+
+std::string ObjectFileQuery::query_cfg(const std::string& name) {
+  auto it = m_functions.find(name);
+  if (it == m_functions.end()) {
+    return "no function named " + name + "\n";
+  }
+  std::string result;
+  for (auto& loc : it->second) {
+    result += describe(loc) + "\n";
+    if (loc.func->cfg) {
+      result += loc.func->cfg->to_form_string() + "\n";
+    } else {
+      result += "no cfg (asm function, or find_basic_blocks is off)\n";
+    }
+  }
+  return result;
+}
+
+std::string ObjectFileQuery::query_asm(const std::string& name) {
+  auto it = m_functions.find(name);
+  if (it == m_functions.end()) {
+    return "no function named " + name + "\n";
+  }
+  std::string result;
+  for (auto& loc : it->second) {
+    const auto& file = loc.obj->linked_data;
+    result += describe(loc) + "\n";
+    for (int i = 1; i < int(loc.func->instructions.size()); i++) {
+      auto label_id = file.get_label_at(loc.seg, (loc.func->start_word + i) * 4);
+      if (label_id != -1) {
+        result += file.get_label_name(label_id) + ":\n";
+      }
+      result += "    " + loc.func->instructions.at(i).to_string(file) + "\n";
+    }
+  }
+  return result;
+}
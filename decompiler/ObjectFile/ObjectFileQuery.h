@@ -0,0 +1,52 @@
+#pragma once
+
+/*!
+ * @file ObjectFileQuery.h
+ * Indexes over an analyzed ObjectFileDB for answering lookups interactively, without writing and
+ * searching the text dumps.
+ */
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class ObjectFileDB;
+struct ObjectFileData;
+class Function;
+
+/*!
+ * Lookups by symbol, method and function name. The indexes are built once, from an ObjectFileDB
+ * that has already been through analyze_functions, and must not outlive it.
+ */
+class ObjectFileQuery {
+ public:
+  explicit ObjectFileQuery(ObjectFileDB& db);
+  std::string run(const std::string& line);
+  void repl();
+  static std::string help();
+
+ private:
+  // a place in an object file, and the function it's in, if any.
+  struct Location {
+    ObjectFileData* obj;
+    int seg;
+    int word_idx;
+    const Function* func;
+  };
+
+  std::string query_symbol(const std::string& name);
+  std::string query_method(const std::string& type_name, int method_id);
+  std::string query_function(const std::string& name);
+  std::string query_cfg(const std::string& name);
+  std::string query_asm(const std::string& name);
+
+  static std::string describe(const Location& loc);
+
+  std::vector<std::vector<Location>> m_refs_by_symbol;  // by LinkedSymbolTable id
+  std::map<std::pair<std::string, int>, std::vector<Location>> m_methods;
+  std::unordered_map<std::string, std::vector<Location>> m_functions;  // by FunctionName
+  const ObjectFileDB& m_db;
+  double m_build_ms = 0;
+};
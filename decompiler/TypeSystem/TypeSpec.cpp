@@ -15,16 +15,16 @@ std::string TypeSpec::to_string() const {
   }
 }
 
-std::shared_ptr<Form> TypeSpec::to_form() const {
+Form* TypeSpec::to_form(FormPool& pool) const {
   if (m_args.empty()) {
-    return toForm(m_base_type);
+    return toForm(pool, m_base_type);
   } else {
-    std::vector<std::shared_ptr<Form>> all;
-    all.push_back(toForm(m_base_type));
+    std::vector<Form*> all;
+    all.push_back(toForm(pool, m_base_type));
     for (const auto& x : m_args) {
-      all.push_back(x.to_form());
+      all.push_back(x.to_form(pool));
     }
-    return buildList(all);
+    return buildList(pool, all);
   }
 }
 
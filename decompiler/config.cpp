@@ -22,8 +22,12 @@ void set_config(const std::string& path_to_config_file) {
   gConfig.write_hexdump_on_v3_only = cfg.at("write_hexdump_on_v3_only").get<bool>();
   gConfig.disassemble_objects_without_functions =
       cfg.at("disassemble_objects_without_functions").get<bool>();
+  gConfig.write_object_dumps = cfg.at("write_object_dumps").get<bool>();
   gConfig.find_basic_blocks = cfg.at("find_basic_blocks").get<bool>();
+  gConfig.run_dataflow = cfg.at("run_dataflow").get<bool>();
   gConfig.write_hex_near_instructions = cfg.at("write_hex_near_instructions").get<bool>();
+  gConfig.benchmark_label_resolution = cfg.at("benchmark_label_resolution").get<bool>();
+  gConfig.benchmark_pretty_print = cfg.at("benchmark_pretty_print").get<bool>();
 
   std::vector<std::string> asm_functions_by_name =
       cfg.at("asm_functions_by_name").get<std::vector<std::string>>();
@@ -15,8 +15,12 @@ struct Config {
   bool write_scripts = false;
   bool write_hexdump_on_v3_only = false;
   bool disassemble_objects_without_functions = false;
+  bool write_object_dumps = false;
   bool find_basic_blocks = false;
+  bool run_dataflow = false;
   bool write_hex_near_instructions = false;
+  bool benchmark_label_resolution = false;
+  bool benchmark_pretty_print = false;
   std::unordered_set<std::string> asm_functions_by_name;
   // ...
 };
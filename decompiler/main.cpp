@@ -1,19 +1,49 @@
 #include <cstdio>
 #include <string>
 #include <vector>
+#include "ObjectFile/ObjectDump.h"
 #include "ObjectFile/ObjectFileDB.h"
+#include "ObjectFile/ObjectFileQuery.h"
 #include "config.h"
 #include "util/FileIO.h"
 #include "TypeSystem/TypeInfo.h"
 #include "common/util/FileUtil.h"
 
+/*!
+ * Print an object file from a .dump, in the format of the hexdump (words) or disassembly.
+ */
+int render(int argc, char** argv) {
+  std::string mode = argc > 3 ? argv[3] : "disasm";
+  bool write_hex = argc > 4 && std::string(argv[4]) == "--hex";
+  if (argc > 5 || (mode != "words" && mode != "disasm") || (argc == 5 && !write_hex)) {
+    printf("usage: jak_disassembler render <dump_file> [words|disasm] [--hex]\n");
+    return 1;
+  }
+
+  try {
+    ObjectDump dump(file_util::read_binary_file(argv[2]));
+    auto text = mode == "words" ? dump.print_words() : dump.print_disassembly(write_hex);
+    fwrite(text.data(), 1, text.size(), stdout);
+  } catch (std::exception& e) {
+    printf("failed to render %s: %s\n", argv[2], e.what());
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, char** argv) {
+  init_opcode_info();
+  if (argc >= 3 && std::string(argv[1]) == "render") {
+    return render(argc, argv);
+  }
+
   printf("Jak Disassembler\n");
   init_crc();
-  init_opcode_info();
 
-  if (argc != 4) {
-    printf("usage: jak_disassembler <config_file> <in_folder> <out_folder>\n");
+  bool query_mode = argc == 5 && std::string(argv[4]) == "query";
+  if (argc != 4 && !query_mode) {
+    printf("usage: jak_disassembler <config_file> <in_folder> <out_folder> [query]\n");
+    printf("       jak_disassembler render <dump_file> [words|disasm] [--hex]\n");
     return 1;
   }
 
@@ -34,10 +64,18 @@ int main(int argc, char** argv) {
   db.find_code();
   db.process_labels();
 
+  if (get_config().benchmark_label_resolution) {
+    db.benchmark_label_resolution();
+  }
+
   if (get_config().write_scripts) {
     db.find_and_write_scripts(out_folder);
   }
 
+  if (get_config().benchmark_pretty_print) {
+    db.benchmark_pretty_print();
+  }
+
   if (get_config().write_hexdump) {
     db.write_object_file_words(out_folder, get_config().write_hexdump_on_v3_only);
   }
@@ -48,7 +86,16 @@ int main(int argc, char** argv) {
     db.write_disassembly(out_folder, get_config().disassemble_objects_without_functions);
   }
 
+  if (get_config().write_object_dumps) {
+    db.write_object_dumps(out_folder);
+  }
+
   printf("%s\n", get_type_info().get_summary().c_str());
+
+  if (query_mode) {
+    ObjectFileQuery query(db);
+    query.repl();
+  }
   //  printf("%d\n", InstructionKind::EE_OP_MAX);
   //  printf("%s\n", get_type_info().get_all_symbols_debug().c_str());
   return 0;
@@ -12,13 +12,13 @@
  * String interning
  */
 std::string* SymbolTable::intern(const std::string& str) {
-  if (map.find(str) == map.end()) {
-    auto* new_string = new std::string(str);
-    map[str] = new_string;
-    return new_string;
-  } else {
-    return map[str];
+  auto it = map.find(str);
+  if (it != map.end()) {
+    return it->second;
   }
+  auto* new_string = new std::string(str);
+  map[str] = new_string;
+  return new_string;
 }
 
 /*!
@@ -27,8 +27,7 @@ std::string* SymbolTable::intern(const std::string& str) {
 SymbolTable gSymbolTable;
 
 SymbolTable::SymbolTable() {
-  empty_pair = std::make_shared<Form>();
-  empty_pair->kind = FormKind::EMPTY_LIST;
+  empty_pair.kind = FormKind::EMPTY_LIST;
 }
 
 SymbolTable::~SymbolTable() {
@@ -88,7 +87,7 @@ void Form::toTokenList(std::vector<FormToken>& tokens) {
       for (;;) {
         if (toPrint->kind == FormKind::PAIR) {
           toPrint->pair[0]->toTokenList(tokens);  // print CAR
-          toPrint = toPrint->pair[1].get();
+          toPrint = toPrint->pair[1];
           if (toPrint->kind == FormKind::EMPTY_LIST) {
             tokens.emplace_back(TokenKind::CLOSE_PAREN);
             return;
@@ -402,7 +401,12 @@ static void insertSpecialBreaks(PrettyPrinterNode* node) {
   }
 }
 
-std::string Form::toStringPretty(int indent, int line_length) {
+/*!
+ * The original pretty printer. This repeatedly finds the first line that is too long, breaks lists
+ * on it, and recomputes the layout of the whole form, which is slow for large forms. Kept to check
+ * and benchmark toStringPretty against.
+ */
+std::string Form::toStringPrettyLegacy(int indent, int line_length) {
   (void)indent;
   (void)line_length;
   std::vector<FormToken> tokens;
@@ -476,41 +480,314 @@ std::string Form::toStringPretty(int indent, int line_length) {
   return pretty;
 }
 
-std::shared_ptr<Form> toForm(const std::string& str) {
-  auto f = std::make_shared<Form>();
+///////////////////////////
+// Linear Pretty Printer
+///////////////////////////
+
+namespace {
+
+/*!
+ * The width of some text, and the length of its last token. The legacy printer considers a line
+ * too long if its last token starts past the line length.
+ */
+struct TextSpan {
+  int width = 0;
+  int last_len = 0;
+
+  TextSpan then(const TextSpan& other) const {
+    if (!other.width) {
+      return *this;
+    }
+    return {width + other.width, other.last_len};
+  }
+};
+
+/*!
+ * A single pass pretty printer, in the style of Oppen's algorithm: each list is a group that is
+ * printed flat if it fits, and otherwise has one element per line. The width of each list is found
+ * once up front, so layout is linear in the number of tokens.
+ *
+ * This makes the same choices as the legacy printer: a list is broken if the line it starts on is
+ * too long, the close paren of a list spanning multiple lines gets its own line, and "deftype"
+ * gets a line break after its parent type.
+ */
+class LinearPrettyPrinter {
+ public:
+  LinearPrettyPrinter(std::vector<FormToken>& tokens, int line_length)
+      : m_tokens(tokens), m_line_length(line_length) {
+    int n = int(tokens.size());
+    m_len.resize(n);
+    m_len_prefix.resize(n + 1, 0);
+    m_match.resize(n, -1);
+    m_break_after.resize(n, false);
+    m_break_prefix.resize(n + 1, 0);
+    m_first_span.resize(n);
+    m_first_span_done.resize(n, false);
+
+    std::vector<int> paren_stack;
+    for (int i = 0; i < n; i++) {
+      m_len[i] = int(tokens[i].toString().length());
+      m_len_prefix[i + 1] = m_len_prefix[i] + m_len[i];
+      if (tokens[i].kind == TokenKind::OPEN_PAREN) {
+        paren_stack.push_back(i);
+      } else if (tokens[i].kind == TokenKind::CLOSE_PAREN) {
+        assert(!paren_stack.empty());
+        m_match[i] = paren_stack.back();
+        m_match[paren_stack.back()] = i;
+        paren_stack.pop_back();
+      }
+    }
+    assert(paren_stack.empty());
+
+    find_special_breaks();
+    for (int i = 0; i < n; i++) {
+      m_break_prefix[i + 1] = m_break_prefix[i] + (m_break_after[i] ? 1 : 0);
+    }
+  }
+
+  std::string run() {
+    if (is_open(0)) {
+      // the legacy printer indents a list starting a line by one more.
+      emit_list(0, {}, true);
+    } else {
+      emit_flat(0, int(m_tokens.size()) - 1);
+    }
+    return std::move(m_out);
+  }
+
+ private:
+  bool is_open(int i) const { return m_tokens[i].kind == TokenKind::OPEN_PAREN; }
+  bool is_whitespace(int i) const { return m_tokens[i].kind == TokenKind::WHITESPACE; }
+  int end_of(int i) const { return is_open(i) ? m_match[i] : i; }
+
+  /*!
+   * Does the list at open paren i have a forced line break inside?
+   */
+  bool is_multiline(int i) const {
+    return is_open(i) && m_break_prefix[m_match[i]] - m_break_prefix[i] > 0;
+  }
+
+  /*!
+   * Same as insertSpecialBreaks: after "deftype", break after the next list, unless there's already
+   * a break between them.
+   */
+  void find_special_breaks() {
+    int n = int(m_tokens.size());
+    std::vector<int> next_open(n + 1, -1);
+    for (int i = n; i-- > 0;) {
+      next_open[i] = is_open(i) ? i : next_open[i + 1];
+    }
+
+    for (int i = 0; i < n; i++) {
+      if (m_tokens[i].kind == TokenKind::SYMBOL && *m_tokens[i].str == "deftype") {
+        int list = next_open[i + 1];
+        if (list == -1) {
+          continue;
+        }
+        // a break between here and the list stops the search.
+        bool blocked = false;
+        for (int j = i; j < list; j++) {
+          blocked = blocked || m_break_after[j];
+        }
+        int close = m_match[list];
+        if (!blocked && close + 1 < n) {
+          m_break_after[close] = true;
+        }
+      }
+    }
+  }
+
+  /*!
+   * The text of the list at i up to its first line break, if it isn't broken.
+   */
+  TextSpan first_span(int i) {
+    if (!is_open(i)) {
+      return {m_len[i], m_len[i]};
+    }
+    if (m_first_span_done[i]) {
+      return m_first_span[i];
+    }
+
+    TextSpan result;
+    int close = m_match[i];
+    if (!is_multiline(i)) {
+      result = {m_len_prefix[close + 1] - m_len_prefix[i], m_len[close]};
+    } else {
+      result = {m_len[i], m_len[i]};
+      for (int item = i + 1; item < close; item = end_of(item) + 1) {
+        if (is_whitespace(item)) {
+          result = result.then({m_len[item], m_len[item]});
+          continue;
+        }
+        result = result.then(first_span(item));
+        if (is_multiline(item) || m_break_after[end_of(item)]) {
+          break;
+        }
+      }
+    }
+
+    m_first_span_done[i] = true;
+    m_first_span[i] = result;
+    return result;
+  }
+
+  bool fits(const TextSpan& line) const {
+    return m_col + line.width - line.last_len <= m_line_length;
+  }
+
+  void newline(int indent) {
+    m_out.push_back('\n');
+    m_out.append(indent, ' ');
+    m_col = indent;
+  }
+
+  void emit_token(int i) {
+    m_out.append(m_tokens[i].toString());
+    m_col += m_len[i];
+  }
+
+  void emit_flat(int start, int end) {
+    for (int i = start; i <= end; i++) {
+      emit_token(i);
+    }
+  }
+
+  /*!
+   * Emit the list with open paren at i. The text in rest follows it on the same line, if it isn't
+   * broken. Returns true if it takes more than one line.
+   */
+  bool emit_list(int i, const TextSpan& rest, bool starts_line = false) {
+    int close = m_match[i];
+    bool multiline = is_multiline(i);
+    auto line = multiline ? first_span(i) : first_span(i).then(rest);
+    bool broken = !fits(line);
+
+    if (!broken && !multiline) {
+      emit_flat(i, close);
+      return false;
+    }
+
+    // the indent of the following lines in this list.
+    int indent = starts_line ? m_col + 2 : m_col;
+    emit_token(i);
+
+    // the items of the list, and what's after each on its line if this list isn't broken.
+    std::vector<int> items;
+    for (int item = i + 1; item < close; item = end_of(item) + 1) {
+      if (!is_whitespace(item)) {
+        items.push_back(item);
+      }
+    }
+
+    std::vector<TextSpan> rest_of_line(items.size());
+    if (!broken) {
+      for (int k = int(items.size()) - 1; k >= 0; k--) {
+        bool line_ends = k + 1 == int(items.size()) || is_multiline(items[k]) ||
+                         m_break_after[end_of(items[k])];
+        if (!line_ends) {
+          rest_of_line[k] = TextSpan{1, 1}.then(first_span(items[k + 1]));
+          if (!(is_multiline(items[k + 1]) || m_break_after[end_of(items[k + 1])])) {
+            rest_of_line[k] = rest_of_line[k].then(rest_of_line[k + 1]);
+          }
+        }
+      }
+    }
+
+    bool prev_ended_line = false;
+    for (int k = 0; k < int(items.size()); k++) {
+      int item = items[k];
+      if (k > 0) {
+        if (broken || prev_ended_line) {
+          // the whitespace starting the line isn't printed, but the legacy printer counts it.
+          newline(indent);
+          m_col++;
+        } else {
+          m_out.push_back(' ');
+          m_col++;
+        }
+      }
+
+      bool item_multiline = false;
+      if (is_open(item)) {
+        item_multiline = emit_list(item, broken ? TextSpan() : rest_of_line[k]);
+      } else {
+        emit_token(item);
+      }
+      prev_ended_line = item_multiline || m_break_after[end_of(item)];
+    }
+
+    newline(indent);
+    emit_token(close);
+    return true;
+  }
+
+  std::vector<FormToken>& m_tokens;
+  int m_line_length;
+  std::vector<int> m_len;         // length of each token
+  std::vector<int> m_len_prefix;  // total length of tokens before each
+  std::vector<int> m_match;       // matching paren, or -1
+  std::vector<bool> m_break_after;
+  std::vector<int> m_break_prefix;  // number of special breaks before each
+  std::vector<TextSpan> m_first_span;
+  std::vector<bool> m_first_span_done;
+  std::string m_out;
+  int m_col = 0;
+};
+
+}  // namespace
+
+/*!
+ * Convert a form to a string with line breaks and indentation so lines fit in line_length when
+ * possible. Linear time in the size of the form.
+ */
+std::string Form::toStringPretty(int indent, int line_length) {
+  (void)indent;
+  std::vector<FormToken> tokens;
+  toTokenList(tokens);
+  assert(!tokens.empty());
+  return LinearPrettyPrinter(tokens, line_length).run();
+}
+
+/*!
+ * Get a new Form, which lives until the pool is destroyed.
+ */
+Form* FormPool::alloc() {
+  if (m_used_in_block == BLOCK_SIZE) {
+    m_blocks.emplace_back(new Form[BLOCK_SIZE]);
+    m_used_in_block = 0;
+  }
+  m_size++;
+  return &m_blocks.back()[m_used_in_block++];
+}
+
+Form* toForm(FormPool& pool, const std::string& str) {
+  auto f = pool.alloc();
   f->kind = FormKind::SYMBOL;
   f->symbol = gSymbolTable.intern(str);
   return f;
 }
 
-std::shared_ptr<Form> buildList(std::shared_ptr<Form> form) {
-  auto f = std::make_shared<Form>();
-  f->kind = FormKind::PAIR;
-  f->pair[0] = form;
-  f->pair[1] = gSymbolTable.getEmptyPair();
-  return f;
+Form* buildList(FormPool& pool, Form* form) {
+  return buildList(pool, &form, 1);
 }
 
-std::shared_ptr<Form> buildList(const std::string& str) {
-  return buildList(toForm(str));
+Form* buildList(FormPool& pool, const std::string& str) {
+  return buildList(pool, toForm(pool, str));
 }
 
-std::shared_ptr<Form> buildList(std::shared_ptr<Form>* forms, int count) {
-  auto f = std::make_shared<Form>();
-  f->kind = FormKind::PAIR;
-  f->pair[0] = forms[0];
-  if (count - 1) {
-    f->pair[1] = buildList(forms + 1, count - 1);
-  } else {
-    f->pair[1] = gSymbolTable.getEmptyPair();
+Form* buildList(FormPool& pool, Form* const* forms, int count) {
+  // build from the end, so long lists don't recurse deeply.
+  Form* result = gSymbolTable.getEmptyPair();
+  for (int i = count; i-- > 0;) {
+    auto f = pool.alloc();
+    f->kind = FormKind::PAIR;
+    f->pair[0] = forms[i];
+    f->pair[1] = result;
+    result = f;
   }
-
-  return f;
+  return result;
 }
 
-std::shared_ptr<Form> buildList(std::vector<std::shared_ptr<Form>>& forms) {
-  if (forms.empty()) {
-    return gSymbolTable.getEmptyPair();
-  }
-  return buildList(forms.data(), forms.size());
+Form* buildList(FormPool& pool, const std::vector<Form*>& forms) {
+  return buildList(pool, forms.data(), int(forms.size()));
 }
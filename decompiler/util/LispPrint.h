@@ -79,17 +79,19 @@ struct FormToken {
 };
 
 /*!
- * S-Expression Form
+ * S-Expression Form. These are owned by a FormPool, so pair points to Forms in the same pool, or to
+ * the shared empty list.
  */
 class Form {
  public:
-  FormKind kind;
+  FormKind kind = FormKind::EMPTY_LIST;
 
-  std::string* symbol;
-  std::shared_ptr<Form> pair[2];
+  std::string* symbol = nullptr;
+  Form* pair[2] = {nullptr, nullptr};
 
   std::string toStringSimple();
   std::string toStringPretty(int indent = 0, int line_length = 80);
+  std::string toStringPrettyLegacy(int indent = 0, int line_length = 80);
   void toTokenList(std::vector<FormToken>& tokens);
 
  private:
@@ -104,11 +106,11 @@ class SymbolTable {
   SymbolTable();
   std::string* intern(const std::string& str);
   ~SymbolTable();
-  std::shared_ptr<Form> getEmptyPair() { return empty_pair; }
+  Form* getEmptyPair() { return &empty_pair; }
 
  private:
   std::unordered_map<std::string, std::string*> map;
-  std::shared_ptr<Form> empty_pair;
+  Form empty_pair;
 };
 
 /*!
@@ -116,28 +118,50 @@ class SymbolTable {
  */
 extern SymbolTable gSymbolTable;
 
-std::shared_ptr<Form> toForm(const std::string& str);  //
+/*!
+ * Allocator for Forms. Forms are allocated in large blocks and all freed at once when the pool is
+ * destroyed, so building and dropping a big tree doesn't allocate or free each node. Forms must
+ * not be used after their pool is gone.
+ */
+class FormPool {
+ public:
+  FormPool() = default;
+  FormPool(const FormPool&) = delete;
+  FormPool& operator=(const FormPool&) = delete;
+
+  Form* alloc();
+  int size() const { return m_size; }  // number of Forms allocated
+  int blocks() const { return int(m_blocks.size()); }
+
+ private:
+  static constexpr int BLOCK_SIZE = 4096;
+  std::vector<std::unique_ptr<Form[]>> m_blocks;
+  int m_used_in_block = BLOCK_SIZE;
+  int m_size = 0;
+};
+
+Form* toForm(FormPool& pool, const std::string& str);
 
-std::shared_ptr<Form> buildList(const std::string& str);
-std::shared_ptr<Form> buildList(std::shared_ptr<Form> form);
-std::shared_ptr<Form> buildList(std::vector<std::shared_ptr<Form>>& forms);
-std::shared_ptr<Form> buildList(std::shared_ptr<Form>* forms, int count);
+Form* buildList(FormPool& pool, const std::string& str);
+Form* buildList(FormPool& pool, Form* form);
+Form* buildList(FormPool& pool, const std::vector<Form*>& forms);
+Form* buildList(FormPool& pool, Form* const* forms, int count);
 
 template <typename... Args>
-std::shared_ptr<Form> buildList(const std::string& str, Args... rest) {
-  auto f = std::make_shared<Form>();
+Form* buildList(FormPool& pool, const std::string& str, Args... rest) {
+  auto f = pool.alloc();
   f->kind = FormKind::PAIR;
-  f->pair[0] = toForm(str);
-  f->pair[1] = buildList(rest...);
+  f->pair[0] = toForm(pool, str);
+  f->pair[1] = buildList(pool, rest...);
   return f;
 }
 
 template <typename... Args>
-std::shared_ptr<Form> buildList(std::shared_ptr<Form> car, Args... rest) {
-  auto f = std::make_shared<Form>();
+Form* buildList(FormPool& pool, Form* car, Args... rest) {
+  auto f = pool.alloc();
   f->kind = FormKind::PAIR;
   f->pair[0] = car;
-  f->pair[1] = buildList(rest...);
+  f->pair[1] = buildList(pool, rest...);
   return f;
 }
 
@@ -8,6 +8,8 @@
 #include <cstring>
 #include <cstdio>
 #include "game/sce/stubs.h"
+#include "game/system/FileCache.h"
+#include "common/util/FileUtil.h"
 #include "fileio.h"
 #include "kprint.h"
 
@@ -449,9 +451,33 @@ s32 FileLength(char* filename) {
  * @param malloc_flags : flags for the kmalloc
  * @param size_out : file size is written here, if it's not null
  * @return pointer to file data
- * DONE, EXACT
+ * DONE, host file cache added
  */
 Ptr<u8> FileLoad(char* name, Ptr<kheapinfo> heap, Ptr<u8> memory, u32 malloc_flags, s32* size_out) {
+  // added: files on the host are read through the file cache, so reloading the same file doesn't
+  // go back to the disk.
+  if (!strncmp(name, "host:", 5)) {
+    auto data = file_cache.get(file_util::get_file_path({name + 5}));
+    if (data) {
+      s32 size = data->size();
+      if (size > 0) {
+        if (memory.offset == 0) {
+          memory = kmalloc(heap, size + 0x40, malloc_flags, name);
+        }
+        if (memory.offset == 0) {
+          MsgErr("dkernel: mem full for file read: '%s' (%d bytes)\n", name, size);
+          return Ptr<u8>(0xfffffffd);
+        }
+        memcpy(memory.c(), data->data(), size);
+        if (size_out)
+          *size_out = size;
+        return memory;
+      } else {
+        return Ptr<u8>(0);
+      }
+    }
+  }
+
   s32 fd = sceOpen(name, SCE_RDONLY);
   if (fd < 0) {
     MsgErr("dkernel: file read !open \'%s\' (%d)\n", name, fd);
@@ -512,4 +538,33 @@ s32 FileSave(char* name, u8* data, s32 size) {
 
   sceClose(fd);
   return 0;
-}
\ No newline at end of file
+}
+
+/*!
+ * Print the status of the host file cache to the GOAL print buffer, so it is visible from the
+ * listener. Doesn't exist in the game.
+ */
+u64 file_cache_status() {
+  auto stats = file_cache.stats();
+  cprintf(
+      "file cache:\n"
+      "\thits: %lld\n"
+      "\tmisses: %lld\n"
+      "\tbytes saved: %lld\n"
+      "\tbytes loaded: %lld\n"
+      "\tevictions: %lld\n"
+      "\tused: %lld of %lld bytes in %lld files\n",
+      (long long)stats.hits, (long long)stats.misses, (long long)stats.bytes_saved,
+      (long long)stats.bytes_loaded, (long long)stats.evictions, (long long)stats.bytes_used,
+      (long long)stats.budget, (long long)stats.file_count);
+  return stats.hits;
+}
+
+/*!
+ * Set the byte budget of the host file cache. A budget of 0 disables the cache.
+ * Doesn't exist in the game.
+ */
+u64 file_cache_set_budget(u64 budget) {
+  file_cache.set_budget(budget);
+  return budget;
+}
@@ -68,6 +68,8 @@ void FileCopy(const char* a, const char* b);
 s32 FileLength(char* filename);
 Ptr<u8> FileLoad(char* name, Ptr<kheapinfo> heap, Ptr<u8> memory, u32 malloc_flags, s32* size_out);
 s32 FileSave(char* name, u8* data, s32 size);
+u64 file_cache_status();
+u64 file_cache_set_budget(u64 budget);
 void fileio_init_globals();
 
 #endif  // RUNTIME_FILEIO_H
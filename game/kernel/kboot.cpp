@@ -16,6 +16,7 @@
 #include "ksocket.h"
 #include "klisten.h"
 #include "kprint.h"
+#include "kdsnetm.h"
 
 #ifdef _WIN32
 #include "Windows.h"
@@ -131,6 +132,8 @@ void KernelCheckAndDispatch() {
     Ptr<char> new_message = WaitForMessageAndAck();
     if (new_message.offset) {
       ProcessListenerMessage(new_message);
+      // added, the message buffer can be reused now.
+      GoalProtoMessageDone();
     }
 
     // remember the old listener function
@@ -168,7 +171,11 @@ void KernelCheckAndDispatch() {
       SendAck();
     }
 
-    std::this_thread::sleep_for(std::chrono::microseconds(1000));
+    // added: if we got a message, check for another one right away, the listener may have sent
+    // several in a row. Otherwise wait, but wake up when a message arrives.
+    if (!new_message.offset) {
+      WaitForGoalProtoMessage(1000);
+    }
   }
 }
 
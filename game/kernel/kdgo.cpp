@@ -10,6 +10,7 @@
 #include "kmalloc.h"
 #include "fileio.h"
 #include "klink.h"
+#include "kscheme.h"
 #include "game/sce/sif_ee.h"
 #include "game/common/dgo_rpc_types.h"
 #include "game/common/player_rpc_types.h"
@@ -301,6 +302,8 @@ void load_and_link_dgo(u64 name_gstr, u64 heap_info, u64 flag, u64 buffer_size)
 void load_and_link_dgo_from_c(const char* name, Ptr<kheapinfo> heap, u32 linkFlag, s32 bufferSize) {
   printf("[Load and Link DGO From C] %s\n", name);
   u32 oldShowStall = sShowStallMsg;
+  auto old_link_stats = symbol_link_stats;     // added
+  auto old_method_set_stats = method_set_stats;  // added
 
   // remember where the heap top point is so we can clear temporary allocations
   auto oldHeapTop = heap->top;
@@ -357,4 +360,12 @@ void load_and_link_dgo_from_c(const char* name, Ptr<kheapinfo> heap, u32 linkFla
     }
   }
   sShowStallMsg = oldShowStall;
+
+  // added, report how long it took to find symbols.
+  printf("[Load and Link DGO From C] %s: resolved %lld symbols in %.3f ms\n", name,
+         (long long)(symbol_link_stats.symbol_count - old_link_stats.symbol_count),
+         (double)(symbol_link_stats.resolve_ns - old_link_stats.resolve_ns) / 1.e6);
+  printf("[Load and Link DGO From C] %s: propagated %lld methods in %.3f ms\n", name,
+         (long long)(method_set_stats.propagate_count - old_method_set_stats.propagate_count),
+         (double)(method_set_stats.propagate_ns - old_method_set_stats.propagate_ns) / 1.e6);
 }
\ No newline at end of file
@@ -7,6 +7,12 @@
 #include <cstring>
 #include <cstdio>
 #include <cassert>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
 #include "game/sce/deci2.h"
 #include "game/system/deci_common.h"  // todo, reorganize to avoid this include
 #include "kdsnetm.h"
@@ -20,11 +26,46 @@ using namespace ee;
 
 GoalProtoBlock protoBlock;
 
+// added, used to wake up the kernel when a message is received.
+static std::mutex receive_mutex;
+static std::condition_variable receive_cv;
+// added, set when a message is received and cleared once the kernel is done with the buffer.
+// Read by the Deci2Server thread, so it can't be part of protoBlock.
+static std::atomic<bool> message_pending;
+// added, messages received while the kernel is busy with another one. The listener can send
+// several messages without waiting for acks, and the kernel takes the next one as soon as it is
+// done, without waiting for the Deci2Server thread.  Protected by receive_mutex.
+static std::deque<std::vector<u8>> message_queue;
+// added, a message which is being received while the buffer is in use.  Only used by the
+// Deci2Server thread.
+static std::vector<u8> queued_receive;
+static bool receive_to_queue = false;
+
 /*!
  * Initialize global variables for kdsnetm
  */
 void kdsnetm_init_globals() {
   protoBlock.reset();
+  message_pending = false;
+  message_queue.clear();
+  queued_receive.clear();
+  receive_to_queue = false;
+}
+
+/*!
+ * Move the oldest queued message into the receive buffer.
+ * Added. The receive_mutex must be held and the receive buffer must be free.
+ */
+static void ReceiveQueuedMessage() {
+  while (!message_queue.empty() && !message_pending) {
+    auto& msg = message_queue.front();
+    if (msg.size() >= sizeof(GoalMessageHeader)) {
+      memcpy(protoBlock.receive_buffer, msg.data(), msg.size());
+      protoBlock.last_receive_size = msg.size();
+      message_pending = true;
+    }
+    message_queue.pop_front();
+  }
 }
 
 /*!
@@ -82,11 +123,22 @@ void GoalProtoHandler(int event, int param, void* opt) {
   switch (event) {
     // get some data - param is the size
     case DECI2_READ:
+      // added, if the kernel is still using the receive buffer, receive into the queue instead.
+      if (pb->receive_progress == 0) {
+        std::lock_guard<std::mutex> lk(receive_mutex);
+        receive_to_queue = message_pending || !message_queue.empty();
+        queued_receive.clear();
+      }
+
       // sanity check the size
       if (pb->receive_progress + param <= (int)DEBUG_MESSAGE_BUFFER_SIZE) {
         // actually get data from DECI2
-        s32 received =
-            sceDeci2ExRecv(pb->socket, ((u8*)pb->receive_buffer) + pb->receive_progress, param);
+        u8* dest = ((u8*)pb->receive_buffer) + pb->receive_progress;
+        if (receive_to_queue) {
+          queued_receive.resize(pb->receive_progress + param);
+          dest = queued_receive.data() + pb->receive_progress;
+        }
+        s32 received = sceDeci2ExRecv(pb->socket, dest, param);
 
         if (received < 0) {
           // receive failure
@@ -105,11 +157,25 @@ void GoalProtoHandler(int event, int param, void* opt) {
       break;
 
     // read is finished!
-    case DECI2_READDONE:
-      // set last_receive_size to indicate that there is a pending message in the buffer.
-      pb->last_receive_size = pb->receive_progress;
+    case DECI2_READDONE: {
+      // added, hold off further receives and wake up the kernel if it's waiting.
+      std::lock_guard<std::mutex> lk(receive_mutex);
+      if (receive_to_queue) {
+        // added, the kernel takes this message from the queue once it is done with the buffer.
+        queued_receive.resize(pb->receive_progress);
+        message_queue.push_back(std::move(queued_receive));
+        queued_receive.clear();
+        ReceiveQueuedMessage();
+      } else {
+        // set last_receive_size to indicate that there is a pending message in the buffer.
+        pb->last_receive_size = pb->receive_progress;
+        if (pb->last_receive_size >= (int)sizeof(GoalMessageHeader)) {
+          message_pending = true;
+        }
+      }
       pb->receive_progress = 0;
-      break;
+      receive_cv.notify_all();
+    } break;
 
     // send some data
     case DECI2_WRITE: {
@@ -220,3 +286,38 @@ void GoalProtoStatus() {
   Msg(6, "gproto: got %d %d\n", protoBlock.most_recent_event, protoBlock.most_recent_param);
   Msg(6, "gproto: %d %d\n", protoBlock.last_receive_size, protoBlock.send_remaining);
 }
+
+/*!
+ * Sleep for up to timeout_us, but wake up as soon as a message is received.
+ * Added, the kernel uses this instead of a fixed sleep so it can respond to the listener sooner.
+ */
+void WaitForGoalProtoMessage(u32 timeout_us) {
+  std::unique_lock<std::mutex> lk(receive_mutex);
+  receive_cv.wait_for(lk, std::chrono::microseconds(timeout_us),
+                      [] { return message_pending.load(); });
+}
+
+/*!
+ * Is there a received message which the kernel hasn't finished processing?
+ */
+bool GoalProtoMessagePending() {
+  return message_pending;
+}
+
+/*!
+ * Are there too many received messages waiting for the kernel to receive more?
+ */
+bool GoalProtoQueueFull() {
+  std::lock_guard<std::mutex> lk(receive_mutex);
+  return message_queue.size() >= GOAL_PROTO_MAX_QUEUED;
+}
+
+/*!
+ * Mark the received message as processed, and move the next queued message into the buffer.
+ */
+void GoalProtoMessageDone() {
+  std::lock_guard<std::mutex> lk(receive_mutex);
+  protoBlock.last_receive_size = -1;
+  message_pending = false;
+  ReceiveQueuedMessage();
+}
@@ -21,6 +21,8 @@ struct GoalMessageHeader {
 };
 
 constexpr u16 DECI2_PROTOCOL = 0xe042;
+// added, max number of messages received while the kernel is busy.
+constexpr size_t GOAL_PROTO_MAX_QUEUED = 16;
 
 struct GoalProtoBlock {
   s32 socket = 0;
@@ -85,4 +87,28 @@ s32 SendFromBufferD(s32 p1, u64 p2, char* data, s32 size);
  */
 void GoalProtoStatus();
 
+/*!
+ * Sleep for up to timeout_us, but wake up as soon as a message is received.
+ * Added, the kernel uses this instead of a fixed sleep so it can respond to the listener sooner.
+ */
+void WaitForGoalProtoMessage(u32 timeout_us);
+
+/*!
+ * Is there a received message which the kernel hasn't finished processing?
+ * Added.
+ */
+bool GoalProtoMessagePending();
+
+/*!
+ * Are there too many received messages waiting for the kernel to receive more?
+ * Added, the Deci2Server waits for this to be false before receiving another message.
+ */
+bool GoalProtoQueueFull();
+
+/*!
+ * Mark the received message as processed, and move the next queued message into the buffer.
+ * Added.
+ */
+void GoalProtoMessageDone();
+
 #endif  // JAK_KDSNETM_H
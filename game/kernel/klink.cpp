@@ -8,6 +8,7 @@
 
 #include <cstring>
 #include <cassert>
+#include <vector>
 #include "klink.h"
 #include "fileio.h"
 #include "kscheme.h"
@@ -15,6 +16,7 @@
 #include "kprint.h"
 #include "common/symbols.h"
 #include "common/goal_constants.h"
+#include "common/util/Timer.h"
 
 namespace {
 // turn on printf's for debugging linking issues.
@@ -27,9 +29,13 @@ link_control saved_link_control;
 // pointer to GOAL *ultimate-memcpy*, if its loaded.
 Ptr<Function> gfunc_774;
 
+// added, statistics about time spent resolving symbols in symlink_v3
+SymbolLinkStats symbol_link_stats;
+
 void klink_init_globals() {
   saved_link_control.reset();
   gfunc_774.offset = 0;
+  symbol_link_stats = SymbolLinkStats();
 }
 
 /*!
@@ -65,6 +71,7 @@ void link_control::begin(Ptr<uint8_t> object_file,
   m_code_start = object_file;
   m_state = 0;
   m_segment_process = 0;
+  m_link_ns = 0;
 
   ObjectFileHeader* ofh = m_link_block_ptr.cast<ObjectFileHeader>().c();
   if (link_debug_printfs) {
@@ -138,6 +145,7 @@ void link_control::begin(Ptr<uint8_t> object_file,
  * Make progress on linking.
  */
 uint32_t link_control::work() {
+  Timer link_timer;
   auto old_debug_segment = DebugSegment;
   if (m_keep_debug) {
     DebugSegment = s7.offset + FIX_SYM_TRUE;
@@ -157,14 +165,62 @@ uint32_t link_control::work() {
   }
 
   DebugSegment = old_debug_segment;
+  m_link_ns += link_timer.getNs();
   return rv;
 }
 
+namespace {
+/*!
+ * Relocations decoded from the link table of a single segment.  The linker first decodes the whole
+ * link table into these flat arrays, then applies them all at once, so the patching loop doesn't
+ * have to parse the variable-length link table or check every pointer it writes through.
+ * All offsets are relative to the start of the segment being linked.
+ */
+struct SegmentRelocations {
+  struct SymbolReloc {
+    u32 offset;
+    u32 sym_addr;    // stored if the word to patch is -1
+    s32 sym_offset;  // stored otherwise
+  };
+
+  struct Reloc32 {
+    u32 offset;
+    s32 value;
+  };
+
+  struct Reloc64 {
+    u32 offset;
+    s64 value;
+  };
+
+  std::vector<SymbolReloc> symbols;
+  std::vector<Reloc32> words32;  // type pointers and 32-bit cross-segment distances
+  std::vector<Reloc64> words64;  // 64-bit cross-segment distances
+  u32 end = 0;                   // one past the last byte patched
+
+  void clear() {
+    symbols.clear();
+    words32.clear();
+    words64.clear();
+    end = 0;
+  }
+
+  void grow_end(u32 offset, u32 size) {
+    if (offset + size > end) {
+      end = offset + size;
+    }
+  }
+};
+
+// reused for each segment so we don't allocate on every link.
+SegmentRelocations segment_relocs;
+}  // namespace
+
 /*!
- * Link type pointers for a single type in "v3 equivalent" link data
+ * Decode type pointers for a single type in "v3 equivalent" link data
  * Returns a pointer to the link table data after the typelinking data.
  */
-uint32_t typelink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
+uint32_t typelink_v3(Ptr<uint8_t> link, SegmentRelocations* relocs) {
   // get the name of the type
   uint32_t seek = 0;
   char sym_name[256];
@@ -183,25 +239,27 @@ uint32_t typelink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
   auto type_ptr = intern_type_from_c(sym_name, method_count);
 
   // prepare to read the locations of the type pointers
-  Ptr<uint32_t> offsets = link.cast<uint32_t>() + seek;
-  uint32_t offset_count = *offsets;
-  offsets = offsets + 4;
+  u32 offset_count;
+  memcpy(&offset_count, link.c() + seek, 4);
   seek += 4;
 
-  // write the type pointers into memory
+  // remember where to write the type pointers
+  const u8* offsets = link.c() + seek;
   for (uint32_t i = 0; i < offset_count; i++) {
-    *(data + offsets.c()[i]).cast<int32_t>() = type_ptr.offset;
-    seek += 4;
+    u32 offset;
+    memcpy(&offset, offsets + 4 * i, 4);
+    relocs->words32.push_back({offset, (s32)type_ptr.offset});
+    relocs->grow_end(offset, 4);
   }
 
-  return seek;
+  return seek + 4 * offset_count;
 }
 
 /*!
- * Link symbols (both offsets and pointers) in "v3 equivalent" link data.
+ * Decode symbol links (both offsets and pointers) in "v3 equivalent" link data.
  * Returns a pointer to the link table data after the linking data for this symbol.
  */
-uint32_t symlink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
+uint32_t symlink_v3(Ptr<uint8_t> link, SegmentRelocations* relocs) {
   // get the symbol name
   uint32_t seek = 0;
   char sym_name[256];
@@ -214,63 +272,99 @@ uint32_t symlink_v3(Ptr<uint8_t> link, Ptr<uint8_t> data) {
   seek++;
 
   // intern
+  Timer intern_timer;
   auto sym = intern_from_c(sym_name);
+  symbol_link_stats.symbol_count++;
+  symbol_link_stats.resolve_ns += intern_timer.getNs();
   int32_t sym_offset = sym.cast<u32>() - s7;
   uint32_t sym_addr = sym.cast<u32>().offset;
 
   // prepare to read locations of symbol links
-  Ptr<uint32_t> offsets = link.cast<uint32_t>() + seek;
-  uint32_t offset_count = *offsets;
-  offsets = offsets + 4;
+  u32 offset_count;
+  memcpy(&offset_count, link.c() + seek, 4);
   seek += 4;
 
+  const u8* offsets = link.c() + seek;
   for (uint32_t i = 0; i < offset_count; i++) {
-    uint32_t offset = offsets.c()[i];
-    seek += 4;
-    auto data_ptr = (data + offset).cast<int32_t>();
-
-    if (*data_ptr == -1) {
-      // a "-1" indicates that we should store the address.
-      *(data + offset).cast<int32_t>() = sym_addr;
-    } else {
-      // otherwise store the offset to st.  Eventually this should become an s16 instead.
-      *(data + offset).cast<int32_t>() = sym_offset;
-    }
+    u32 offset;
+    memcpy(&offset, offsets + 4 * i, 4);
+    relocs->symbols.push_back({offset, sym_addr, sym_offset});
+    relocs->grow_end(offset, 4);
   }
 
-  return seek;
+  return seek + 4 * offset_count;
 }
 
 /*!
- * Link a single pointer.
+ * Decode a single pointer.
  */
 uint32_t cross_seg_dist_link_v3(Ptr<uint8_t> link,
                                 ObjectFileHeader* ofh,
                                 int current_seg,
-                                int size) {
+                                int size,
+                                SegmentRelocations* relocs) {
   // target seg, dist into mine, dist into target, patch loc in mine
   uint8_t target_seg = *link;
   assert(target_seg < ofh->segment_count);
-  uint32_t* link_data = (link + 1).cast<uint32_t>().c();
+  u32 link_data[3];
+  memcpy(link_data, (link + 1).c(), sizeof(link_data));
   int32_t mine = link_data[0] + ofh->code_infos[current_seg].offset;
   int32_t tgt = link_data[1] + ofh->code_infos[target_seg].offset;
   int32_t diff = tgt - mine;
-  uint32_t offset_of_patch = link_data[2] + ofh->code_infos[current_seg].offset;
-  // printf("link object in seg %d diff %d at %d (%d + %d)\n", target_seg, diff, offset_of_patch,
-  // link_data[2], ofh->code_infos[current_seg].offset);
+  uint32_t offset_of_patch = link_data[2];
 
   // both 32-bit and 64-bit pointer links are supported, though 64-bit ones should disappear soon.
   if (size == 4) {
-    *Ptr<int32_t>(offset_of_patch).c() = diff;
+    relocs->words32.push_back({offset_of_patch, diff});
   } else if (size == 8) {
-    *Ptr<int64_t>(offset_of_patch).c() = diff;
+    relocs->words64.push_back({offset_of_patch, diff});
   } else {
     throw std::runtime_error("unknown size in cross_seg_dist_link_v3");
   }
+  relocs->grow_end(offset_of_patch, size);
 
   return 1 + 3 * 4;
 }
 
+/*!
+ * Apply decoded relocations to a segment.  The bounds are checked once for the whole segment.
+ * Returns false if a relocation is outside of the segment.
+ */
+bool apply_relocations_v3(const SegmentRelocations& relocs, const SegmentInfo& seg) {
+  if (relocs.end == 0) {
+    return true;
+  }
+
+  if (relocs.end > seg.size) {
+    if (seg.offset == 0) {
+      // segment wasn't loaded (debug segment without DebugSegment), nothing to patch.
+      return true;
+    }
+    return false;
+  }
+
+  u8* base = Ptr<u8>(seg.offset).c();
+
+  for (auto& r : relocs.symbols) {
+    s32 old_value;
+    memcpy(&old_value, base + r.offset, 4);
+    // a "-1" indicates that we should store the address.
+    // otherwise store the offset to st.  Eventually this should become an s16 instead.
+    s32 new_value = (old_value == -1) ? (s32)r.sym_addr : r.sym_offset;
+    memcpy(base + r.offset, &new_value, 4);
+  }
+
+  for (auto& r : relocs.words32) {
+    memcpy(base + r.offset, &r.value, 4);
+  }
+
+  for (auto& r : relocs.words64) {
+    memcpy(base + r.offset, &r.value, 8);
+  }
+
+  return true;
+}
+
 /*!
  * Run the linker. For now, all linking is done in two runs.  If this turns out to be too slow,
  * this should be modified to do incremental linking over multiple runs.
@@ -353,7 +447,9 @@ uint32_t link_control::work_v3() {
     // state 1: linking. For now all links are done at once. This is probably going to be fine on a
     // modern computer.  But the game broke this into multiple steps.
     if (m_segment_process < ofh->segment_count) {
+      // decode the whole link table, then patch the segment in one pass.
       Ptr<u8> lp(ofh->link_infos[m_segment_process].offset);
+      segment_relocs.clear();
 
       while (*lp) {
         switch (*lp) {
@@ -361,21 +457,21 @@ uint32_t link_control::work_v3() {
             break;
           case LINK_SYMBOL_OFFSET:
             lp = lp + 1;
-            lp = lp + symlink_v3(lp, Ptr<u8>(ofh->code_infos[m_segment_process].offset));
+            lp = lp + symlink_v3(lp, &segment_relocs);
             break;
           case LINK_TYPE_PTR:
             lp = lp + 1;  // seek past id
-            lp = lp + typelink_v3(lp, Ptr<u8>(ofh->code_infos[m_segment_process].offset));
+            lp = lp + typelink_v3(lp, &segment_relocs);
             break;
 
           case LINK_DISTANCE_TO_OTHER_SEG_64:
             lp = lp + 1;
-            lp = lp + cross_seg_dist_link_v3(lp, ofh, m_segment_process, 8);
+            lp = lp + cross_seg_dist_link_v3(lp, ofh, m_segment_process, 8, &segment_relocs);
             break;
 
           case LINK_DISTANCE_TO_OTHER_SEG_32:
             lp = lp + 1;
-            lp = lp + cross_seg_dist_link_v3(lp, ofh, m_segment_process, 4);
+            lp = lp + cross_seg_dist_link_v3(lp, ofh, m_segment_process, 4, &segment_relocs);
             break;
           default:
             printf("unknown link table thing %d\n", *lp);
@@ -384,6 +480,12 @@ uint32_t link_control::work_v3() {
         }
       }
 
+      if (!apply_relocations_v3(segment_relocs, ofh->code_infos[m_segment_process])) {
+        MsgErr("dkernel: link table for %s segment %d patches past the end of the segment\n",
+               m_object_name, m_segment_process);
+        return 1;
+      }
+
       m_segment_process++;
     } else {
       // all done, can set the entry point to the top-level.
@@ -428,7 +530,7 @@ void link_control::finish() {
 
     // inform compiler that we loaded.
     if (m_flags & LINK_FLAG_OUTPUT_LOAD) {
-      output_segment_load(m_object_name, m_link_block_ptr, m_flags);
+      output_segment_load(m_object_name, m_link_block_ptr, m_flags, m_link_ns);
     }
   } else {
     printf("UNHANDELD OBJECT FILE VERSION IN FINISH\n");
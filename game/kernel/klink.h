@@ -39,6 +39,7 @@ struct link_control {
   uint32_t m_state;
   uint32_t m_segment_process;
   uint32_t m_version;
+  s64 m_link_ns;  //! added, time spent in work(), summed over all calls
   void begin(Ptr<uint8_t> object_file,
              const char* name,
              int32_t size,
@@ -63,6 +64,7 @@ struct link_control {
     m_state = 0;
     m_segment_process = 0;
     m_version = 0;
+    m_link_ns = 0;
   }
 };
 
@@ -81,6 +83,16 @@ struct ObjectFileHeader {
   uint32_t link_block_length;
 };
 
+/*!
+ * Added. Counts the symbols resolved by the linker, and how long it took.
+ */
+struct SymbolLinkStats {
+  u64 symbol_count = 0;
+  s64 resolve_ns = 0;
+};
+
+extern SymbolLinkStats symbol_link_stats;
+
 void klink_init_globals();
 
 u64 link_and_exec_wrapper(u64 data, u64 name, s64 size, u64 heap, u64 flags);
@@ -584,6 +584,11 @@ void InitMachineScheme() {
   make_function_symbol_from_c("dma-to-iop", (void*)dma_to_iop);                           // unused
   make_function_symbol_from_c("kernel-shutdown", (void*)KernelShutdown);                  // used
   make_function_symbol_from_c("aybabtu", (void*)sceCdMmode);                              // used
+  make_function_symbol_from_c("file-cache-status", (void*)file_cache_status);             // added
+  make_function_symbol_from_c("file-cache-set-budget!", (void*)file_cache_set_budget);    // added
+  make_function_symbol_from_c("kheap-profile", (void*)kheap_profile);                     // added
+  make_function_symbol_from_c("kmalloc-track!", (void*)kmalloc_track);                    // added
+  make_function_symbol_from_c("kmalloc-dump-timeline", (void*)kmalloc_dump_timeline);     // added
   InitSoundScheme();
   intern_from_c("*stack-top*")->value = 0x07ffc000;
   intern_from_c("*stack-base*")->value = 0x07ffffff;
@@ -5,19 +5,127 @@
  * DONE
  */
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <unordered_map>
 #include "kmalloc.h"
 #include "kprint.h"
 #include "kscheme.h"
+#include "common/util/FileUtil.h"
 
 // global and debug kernel heaps
 Ptr<kheapinfo> kglobalheap;
 Ptr<kheapinfo> kdebugheap;
 
+namespace {
+/*!
+ * Added. Optional tracker of every kmalloc, used to figure out what is using up a heap.
+ * Allocations are grouped by their name, so the same name on different call sites is combined. The
+ * summary keeps the host call site of the first allocation with each name, and the timeline keeps
+ * the call site of every allocation.
+ */
+struct KmallocRecord {
+  u32 heap;
+  u32 addr;  // 0 if the allocation failed
+  s32 size;
+  u32 waste;
+  u32 flags;
+  u32 name_id;
+  u32 used;  // bytes used on the heap (top and bottom) after this allocation
+  const void* call_site;
+};
+
+struct KmallocHeapProfile {
+  u64 alloc_count = 0;
+  u64 failed_count = 0;
+  u64 bytes = 0;
+  u64 waste = 0;
+  u32 bottom_high_water = 0;
+  u32 top_high_water = 0;
+  u32 high_water = 0;
+  std::unordered_map<u32, KmallocNameStats> names;
+};
+
+// stop recording the timeline after this many allocations, the summaries are still updated.
+constexpr u32 KMALLOC_TIMELINE_MAX = 256 * 1024;
+
+struct KmallocTracker {
+  bool enabled = false;
+  std::unordered_map<std::string, u32> name_ids;
+  std::vector<std::string> names;
+  std::unordered_map<u32, KmallocHeapProfile> heaps;
+  std::vector<KmallocRecord> timeline;
+  u64 timeline_dropped = 0;
+
+  void reset() {
+    name_ids.clear();
+    names.clear();
+    heaps.clear();
+    timeline.clear();
+    timeline_dropped = 0;
+  }
+
+  u32 name_id(const char* name) {
+    auto kv = name_ids.find(name);
+    if (kv != name_ids.end()) {
+      return kv->second;
+    }
+    u32 id = names.size();
+    names.push_back(name);
+    name_ids[name] = id;
+    return id;
+  }
+
+  void record(Ptr<kheapinfo> heap,
+              u32 addr,
+              s32 size,
+              u32 waste,
+              u32 flags,
+              const char* name,
+              const void* call_site) {
+    auto& prof = heaps[heap.offset];
+    u32 id = name_id(name ? name : "");
+    u32 bottom_used = heap->current - heap->base;
+    u32 top_used = heap->top_base - heap->top;
+
+    if (addr) {
+      prof.alloc_count++;
+      prof.bytes += size;
+      prof.waste += waste;
+      auto& ns = prof.names[id];
+      if (ns.name.empty()) {
+        ns.name = names[id];
+        ns.call_site = call_site;
+      }
+      ns.count++;
+      ns.bytes += size;
+      ns.waste += waste;
+      prof.bottom_high_water = std::max(prof.bottom_high_water, bottom_used);
+      prof.top_high_water = std::max(prof.top_high_water, top_used);
+      prof.high_water = std::max(prof.high_water, bottom_used + top_used);
+    } else {
+      prof.failed_count++;
+    }
+
+    if (timeline.size() < KMALLOC_TIMELINE_MAX) {
+      timeline.push_back(
+          {heap.offset, addr, size, waste, flags, id, bottom_used + top_used, call_site});
+    } else {
+      timeline_dropped++;
+    }
+  }
+};
+
+KmallocTracker kmalloc_tracker;
+}  // namespace
+
 void kmalloc_init_globals() {
   // _globalheap and _debugheap
   kglobalheap.offset = GLOBAL_HEAP_INFO_ADDR;
   kdebugheap.offset = DEBUG_HEAP_INFO_ADDR;
+  kmalloc_tracker.enabled = false;
+  kmalloc_tracker.reset();
 }
 
 /*!
@@ -74,6 +182,11 @@ void kheapstatus(Ptr<kheapinfo> heap) {
   if (heap == kglobalheap) {
     Msg(6, "\t %d bytes before stack\n", GLOBAL_HEAP_END - heap->current.offset);
   }
+
+  // added
+  if (kmalloc_tracker.enabled) {
+    Msg(6, "\t high water: %d bytes\n", kheap_high_water(heap));
+  }
 }
 
 /*!
@@ -108,6 +221,11 @@ u32 kheapused(Ptr<kheapinfo> heap) {
  */
 Ptr<u8> kmalloc(Ptr<kheapinfo> heap, s32 size, u32 flags, char const* name) {
   uint32_t alignment_flag = flags & 0xfff;
+#ifdef __linux__
+  const void* call_site = __builtin_return_address(0);  // added
+#else
+  const void* call_site = nullptr;
+#endif
 
   // if we got a null heap, put it on the global heap, but warn about it
   if (!heap.offset) {
@@ -137,10 +255,17 @@ Ptr<u8> kmalloc(Ptr<kheapinfo> heap, s32 size, u32 flags, char const* name) {
     if (heap->top.offset < memend) {
       kheapstatus(heap);
       Msg(6, "kmalloc: !alloc mem %s (%d bytes) heap %x\n", name, size, heap.offset);
+      if (kmalloc_tracker.enabled) {
+        kmalloc_tracker.record(heap, 0, size, 0, flags, name, call_site);
+      }
       return Ptr<u8>(0);
     }
 
+    u32 waste = memstart - heap->current.offset;
     heap->current.offset = memend;
+    if (kmalloc_tracker.enabled) {
+      kmalloc_tracker.record(heap, memstart, size, waste, flags, name, call_site);
+    }
     if (flags & KMALLOC_MEMSET)
       std::memset(Ptr<u8>(memstart).c(), 0, (size_t)size);
     return Ptr<u8>(memstart);
@@ -160,10 +285,17 @@ Ptr<u8> kmalloc(Ptr<kheapinfo> heap, s32 size, u32 flags, char const* name) {
     if (heap->current.offset >= memstart) {
       Msg(6, "kmalloc: !alloc mem from top %s (%d bytes) heap %x\n", name, size, heap.offset);
       kheapstatus(heap);
+      if (kmalloc_tracker.enabled) {
+        kmalloc_tracker.record(heap, 0, size, 0, flags, name, call_site);
+      }
       return Ptr<u8>(0);
     }
 
+    u32 waste = heap->top.offset - size - memstart;
     heap->top.offset = memstart;
+    if (kmalloc_tracker.enabled) {
+      kmalloc_tracker.record(heap, memstart, size, waste, flags, name, call_site);
+    }
 
     if (flags & 0x1000)
       std::memset(Ptr<u8>(memstart).c(), 0, (size_t)size);
@@ -180,3 +312,124 @@ void kfree(Ptr<u8> a) {
   (void)a;
   Msg(6, "[ERROR] kmalloc: kfree called\n");
 }
+
+/*!
+ * Turn the allocation tracker on or off.  Turning it on clears everything recorded so far.
+ * Doesn't exist in the game.
+ */
+void kmalloc_set_tracking(bool enable) {
+  if (enable && !kmalloc_tracker.enabled) {
+    kmalloc_tracker.reset();
+  }
+  kmalloc_tracker.enabled = enable;
+}
+
+bool kmalloc_tracking() {
+  return kmalloc_tracker.enabled;
+}
+
+/*!
+ * Get the most memory used on a heap (top and bottom together) since tracking was turned on.
+ * Doesn't exist in the game.
+ */
+u32 kheap_high_water(Ptr<kheapinfo> heap) {
+  auto kv = kmalloc_tracker.heaps.find(heap.offset);
+  return kv == kmalloc_tracker.heaps.end() ? 0 : kv->second.high_water;
+}
+
+/*!
+ * Get the allocation totals for each name used on a heap, largest first.
+ * Doesn't exist in the game.
+ */
+std::vector<KmallocNameStats> kheap_name_stats(Ptr<kheapinfo> heap) {
+  std::vector<KmallocNameStats> result;
+  auto kv = kmalloc_tracker.heaps.find(heap.offset);
+  if (kv != kmalloc_tracker.heaps.end()) {
+    for (auto& name : kv->second.names) {
+      result.push_back(name.second);
+    }
+  }
+  std::sort(result.begin(), result.end(),
+            [](const KmallocNameStats& a, const KmallocNameStats& b) { return a.bytes > b.bytes; });
+  return result;
+}
+
+/*!
+ * Print a summary of the allocations on a heap to the listener. Returns the high water mark.
+ * Doesn't exist in the game.
+ */
+u64 kheap_profile(u32 heap) {
+  // the print buffer is small, so only show the biggest users.
+  constexpr int max_names = 32;
+  Ptr<kheapinfo> h(heap);
+  if (!kmalloc_tracker.enabled) {
+    cprintf("kmalloc tracking is off, enable with (kmalloc-track! 1)\n");
+    return 0;
+  }
+
+  auto kv = kmalloc_tracker.heaps.find(heap);
+  if (kv == kmalloc_tracker.heaps.end()) {
+    cprintf("[%8x] kheap: no allocations\n", heap);
+    return 0;
+  }
+
+  auto& prof = kv->second;
+  cprintf(
+      "[%8x] kheap profile\n"
+      "\tallocations: %lld (%lld failed)\n"
+      "\tbytes: %lld, alignment waste: %lld\n"
+      "\thigh water: %d of %d bytes (bottom %d, top %d)\n",
+      heap, (long long)prof.alloc_count, (long long)prof.failed_count, (long long)prof.bytes,
+      (long long)prof.waste, prof.high_water, h->top_base - h->base, prof.bottom_high_water,
+      prof.top_high_water);
+
+  auto names = kheap_name_stats(h);
+  for (int i = 0; i < (int)names.size() && i < max_names; i++) {
+    auto& ns = names[i];
+    cprintf("\t%-32s %10lld bytes %6lld allocs %6lld waste %p\n", ns.name.c_str(),
+            (long long)ns.bytes, (long long)ns.count, (long long)ns.waste, ns.call_site);
+  }
+  if ((int)names.size() > max_names) {
+    cprintf("\t... and %d more\n", (int)names.size() - max_names);
+  }
+  return prof.high_water;
+}
+
+/*!
+ * Turn the allocation tracker on (nonzero) or off (zero) from GOAL.
+ * Doesn't exist in the game.
+ */
+u64 kmalloc_track(u64 enable) {
+  kmalloc_set_tracking(enable != 0);
+  return enable;
+}
+
+/*!
+ * Write every tracked allocation, in order, to a CSV file. The path is relative to the project.
+ * Returns the number of allocations written.
+ * Doesn't exist in the game.
+ */
+u64 kmalloc_dump_timeline(u32 file_name) {
+  auto path = file_util::get_file_path({Ptr<String>(file_name)->data()});
+  FILE* fp = fopen(path.c_str(), "w");
+  if (!fp) {
+    MsgErr("kmalloc: can't open %s for the allocation timeline\n", path.c_str());
+    return 0;
+  }
+
+  fprintf(fp, "index,heap,name,addr,size,waste,flags,used,call-site\n");
+  u64 idx = 0;
+  for (auto& rec : kmalloc_tracker.timeline) {
+    fprintf(fp, "%lld,#x%x,\"%s\",#x%x,%d,%d,#x%x,%d,%p\n", (long long)idx++, rec.heap,
+            kmalloc_tracker.names[rec.name_id].c_str(), rec.addr, rec.size, rec.waste, rec.flags,
+            rec.used, rec.call_site);
+  }
+  fclose(fp);
+
+  if (kmalloc_tracker.timeline_dropped) {
+    MsgErr("kmalloc: timeline is missing the last %lld allocations\n",
+           (long long)kmalloc_tracker.timeline_dropped);
+  }
+  cprintf("wrote %lld allocations to %s\n", (long long)idx, path.c_str());
+  return idx;
+}
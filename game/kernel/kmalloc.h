@@ -10,6 +10,8 @@
 #ifndef JAK_KMALLOC_H
 #define JAK_KMALLOC_H
 
+#include <string>
+#include <vector>
 #include "common/common_types.h"
 #include "Ptr.h"
 #include "kmachine.h"
@@ -45,4 +47,24 @@ void kfree(Ptr<u8> a);
 
 void kmalloc_init_globals();
 
+/*!
+ * Added. Allocation totals for a single kmalloc name on a single heap.
+ */
+struct KmallocNameStats {
+  std::string name;
+  u64 count = 0;                    //! number of allocations
+  u64 bytes = 0;                    //! bytes requested
+  u64 waste = 0;                    //! bytes lost to alignment
+  const void* call_site = nullptr;  //! host code which made the first allocation
+};
+
+// allocation tracker
+void kmalloc_set_tracking(bool enable);
+bool kmalloc_tracking();
+u32 kheap_high_water(Ptr<kheapinfo> heap);
+std::vector<KmallocNameStats> kheap_name_stats(Ptr<kheapinfo> heap);
+u64 kheap_profile(u32 heap);
+u64 kmalloc_track(u64 enable);
+u64 kmalloc_dump_timeline(u32 file_name);
+
 #endif  // JAK_KMALLOC_H
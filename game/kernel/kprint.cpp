@@ -43,6 +43,18 @@ Ptr<u8> OutputBufArea;
 // Pointer to print buffer, the buffer for printing and string formatting.
 Ptr<u8> PrintBufArea;
 
+// Added. The end of the text in the print and output buffers, so appending doesn't have to search
+// for it with strend.  Null if it isn't known, in which case the end is found from the pending
+// pointer, like the original code.
+Ptr<u8> PrintEnd;
+Ptr<u8> OutputEnd;
+
+// Added. Size of the print buffer, which is smaller without a compiler connection.
+u32 PrintBufSize;
+
+// Added. Set after a print didn't fit in the print buffer, so the error is only reported once.
+bool PrintOverflow;
+
 // integer printing conversion table
 char ConvertTable[16];
 
@@ -59,6 +71,10 @@ void kprint_init_globals() {
   MessBufArea.offset = 0;
   OutputBufArea.offset = 0;
   PrintBufArea.offset = 0;
+  PrintEnd.offset = 0;
+  OutputEnd.offset = 0;
+  PrintBufSize = 0;
+  PrintOverflow = false;
   memcpy(ConvertTable, "0123456789abcdef", 16);
   memset(AckBufArea, 0, sizeof(AckBufArea));
 }
@@ -76,6 +92,7 @@ void init_output() {
                             KMALLOC_MEMSET | KMALLOC_ALIGN_256, "output-buf");
     PrintBufArea = kmalloc(kdebugheap, DEBUG_PRINT_BUFFER_SIZE, KMALLOC_MEMSET | KMALLOC_ALIGN_256,
                            "print-buf");
+    PrintBufSize = DEBUG_PRINT_BUFFER_SIZE;  // added
   } else {
     // no compiler connection, so we do not allocate buffers
     MessBufArea = Ptr<u8>(0);
@@ -84,7 +101,10 @@ void init_output() {
     // we still need a (small) print buffer for string maniuplation and debugging prints.
     PrintBufArea =
         kmalloc(kglobalheap, PRINT_BUFFER_SIZE, KMALLOC_MEMSET | KMALLOC_ALIGN_256, "print-buf");
+    PrintBufSize = PRINT_BUFFER_SIZE;  // added
   }
+  PrintEnd.offset = 0;   // added
+  OutputEnd.offset = 0;  // added
 }
 
 /*!
@@ -96,6 +116,7 @@ void clear_output() {
   if (MasterDebug) {
     kstrcpy((char*)Ptr<u8>(OutputBufArea + sizeof(GoalMessageHeader)).c(), "");
     OutputPending = Ptr<u8>(0);
+    OutputEnd = OutputBufArea + sizeof(GoalMessageHeader);  // added
   }
 }
 
@@ -107,6 +128,98 @@ void clear_output() {
 void clear_print() {
   *Ptr<u8>(PrintBufArea + sizeof(GoalMessageHeader)) = 0;
   PrintPending = Ptr<u8>(0);
+  PrintEnd = PrintBufArea + sizeof(GoalMessageHeader);  // added
+  PrintOverflow = false;                                // added
+}
+
+/*!
+ * Get the end of the text in the print buffer, and make it the start of the pending print.
+ * The next print should be written here. Added, replaces the strend search at each print.
+ */
+char* start_print() {
+  char* start = PrintPending.cast<char>().c();
+  if (!start) {
+    start = PrintBufArea.cast<char>().c() + sizeof(GoalMessageHeader);
+  }
+  char* end = PrintEnd.cast<char>().c();
+  if (!end || end < start) {
+    end = start;
+  }
+  // normally already at the end, unless something appended without using end_print.
+  end = strend(end);
+  PrintPending = make_ptr(end).cast<u8>();
+  return end;
+}
+
+/*!
+ * Record the end of the text in the print buffer, after writing a print up to end. Added.
+ */
+void end_print(char* end) {
+  PrintEnd = make_ptr(end).cast<u8>();
+}
+
+/*!
+ * Get the number of bytes that can be written at ptr in the print buffer, including the null
+ * terminator. Added.
+ */
+u32 print_buffer_room(const char* ptr) {
+  const char* limit = PrintBufArea.cast<char>().c() + PrintBufSize;
+  return ptr < limit ? limit - ptr : 0;
+}
+
+/*!
+ * Report that a print didn't fit in the print buffer. Only reported once until the buffer is
+ * cleared. Added.
+ */
+void print_buffer_overflow() {
+  if (!PrintOverflow) {
+    MsgErr("dkernel: print buffer overflow, output will be truncated\n");
+    PrintOverflow = true;
+  }
+}
+
+/*!
+ * Check that there is room for a print of up to PRINT_APPEND_RESERVE bytes at ptr.  If not, the
+ * overflow is reported and the print should be skipped. Added.
+ */
+bool print_buffer_check(const char* ptr) {
+  if (print_buffer_room(ptr) >= PRINT_APPEND_RESERVE) {
+    return true;
+  }
+  print_buffer_overflow();
+  return false;
+}
+
+/*!
+ * Get the end of the text in the output buffer. Added, replaces the strend search at each output.
+ */
+char* output_buffer_end() {
+  char* start = OutputBufArea.cast<char>().c() + sizeof(GoalMessageHeader);
+  char* end = OutputEnd.cast<char>().c();
+  if (!end || end < start) {
+    end = start;
+  }
+  return strend(end);
+}
+
+/*!
+ * Append a message to the output buffer, if it fits. Added.
+ */
+void output_append(const char* format, ...) {
+  char* end = output_buffer_end();
+  s32 room = OutputBufArea.cast<char>().c() + DEBUG_OUTPUT_BUFFER_SIZE - end;
+  va_list args;
+  va_start(args, format);
+  s32 len = vsnprintf(end, room > 0 ? room : 0, format, args);
+  va_end(args);
+  if (len >= room) {
+    MsgErr("dkernel: output buffer overflow, message dropped\n");
+    if (room > 0) {
+      *end = 0;
+    }
+    len = 0;
+  }
+  OutputEnd = make_ptr(end + len).cast<u8>();
 }
 
 /*!
@@ -116,7 +229,8 @@ void clear_print() {
  */
 void reset_output() {
   if (MasterDebug) {
-    sprintf(OutputBufArea.cast<char>().c() + sizeof(GoalMessageHeader), "reset #x%x\n", s7.offset);
+    char* buffer = OutputBufArea.cast<char>().c() + sizeof(GoalMessageHeader);
+    OutputEnd = make_ptr(buffer + sprintf(buffer, "reset #x%x\n", s7.offset)).cast<u8>();
     OutputPending = OutputBufArea + sizeof(GoalMessageHeader);
   }
 }
@@ -127,24 +241,24 @@ void reset_output() {
  */
 void output_unload(const char* name) {
   if (!MasterDebug) {
-    sprintf(strend(OutputBufArea.cast<char>().c() + sizeof(GoalMessageHeader)), "unload \"%s\"\n",
-            name);
+    output_append("unload \"%s\"\n", name);
     OutputPending = OutputBufArea + sizeof(GoalMessageHeader);
   }
 }
 
 /*!
  * Buffer message to compiler indicating some object file has been loaded.
+ * The last field is the time spent linking, in microseconds (added).
  */
-void output_segment_load(const char* name, Ptr<u8> link_block, u32 flags) {
+void output_segment_load(const char* name, Ptr<u8> link_block, u32 flags, s64 link_ns) {
   if (MasterDebug) {
-    char* buffer = strend(OutputBufArea.cast<char>().c() + sizeof(GoalMessageHeader));
     char true_str[] = "t";
     char false_str[] = "nil";
     char* flag_str = (flags & LINK_FLAG_OUTPUT_TRUE) ? true_str : false_str;
     auto lbp = link_block.cast<ObjectFileHeader>();
-    sprintf(buffer, "load \"%s\" %s #x%x #x%x #x%x\n", name, flag_str, lbp->code_infos[0].offset,
-            lbp->code_infos[1].offset, lbp->code_infos[2].offset);
+    output_append("load \"%s\" %s #x%x #x%x #x%x %lld\n", name, flag_str,
+                  lbp->code_infos[0].offset, lbp->code_infos[1].offset, lbp->code_infos[2].offset,
+                  (long long)(link_ns / 1000));
     OutputPending = OutputBufArea + sizeof(GoalMessageHeader);
   }
 }
@@ -153,16 +267,20 @@ void output_segment_load(const char* name, Ptr<u8> link_block, u32 flags) {
  * Print to the GOAL print buffer from C
  * seeks PrintPending to begining of what was just printed.
  * This is a different behavior from all the other prints!
- * DONE, EXACT
+ * DONE, modified to not search for the end of the buffer, and to not overflow it.
  */
 void cprintf(const char* format, ...) {
   va_list args;
   va_start(args, format);
-  char* str = PrintPending.cast<char>().c();
-  if (!PrintPending.offset)
-    str = PrintBufArea.cast<char>().c() + sizeof(GoalMessageHeader);
-  PrintPending = make_ptr(strend(str)).cast<u8>();
-  vsprintf((char*)PrintPending.c(), format, args);
+  char* str = start_print();
+  // modified to not write past the end of the print buffer.
+  s32 room = print_buffer_room(str);
+  s32 len = vsnprintf(str, room, format, args);
+  if (len >= room) {
+    len = room > 0 ? room - 1 : 0;
+    print_buffer_overflow();
+  }
+  end_print(str + len);
 
   va_end(args);
 }
@@ -277,6 +395,35 @@ char* round(float x, s32* param1, char* start, char* sEnd, char padchar, s32* pa
   return local_58;
 }
 
+namespace {
+// "00" to "99", for converting decimal numbers two digits at a time.
+const char DecimalPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/*!
+ * Write the decimal digits of value backward, ending just before end. Returns the first digit.
+ * Added.
+ */
+char* write_decimal_digits(char* end, u64 value) {
+  char* ptr = end;
+  while (value >= 100) {
+    u32 pair = value % 100;
+    value /= 100;
+    ptr -= 2;
+    memcpy(ptr, DecimalPairs + 2 * pair, 2);
+  }
+  if (value >= 10) {
+    ptr -= 2;
+    memcpy(ptr, DecimalPairs + 2 * value, 2);
+  } else {
+    *--ptr = '0' + value;
+  }
+  return ptr;
+}
+}  // namespace
+
 /*!
  * Convert floating point to string intermediate function.
  * Places a null character as the first character, then the integers, decimal, fraction digits
@@ -293,7 +440,12 @@ char* round(float x, s32* param1, char* start, char* sEnd, char padchar, s32* pa
  * DONE, added some sanity checks and removed support for "rounding" as round isn't implemented and
  * rounding is never used in the game.
  */
-s32 cvt_float(float x, s32 precision, s32* lead_char, char* buff_start, char* buff_end, u32 flags) {
+s32 cvt_float_reference(float x,
+                        s32 precision,
+                        s32* lead_char,
+                        char* buff_start,
+                        char* buff_end,
+                        u32 flags) {
   // put a null at the beginning of the output
   *buff_start = 0;
   s32 forward_count = 0;
@@ -415,6 +567,64 @@ s32 cvt_float(float x, s32 precision, s32* lead_char, char* buff_start, char* bu
   return count_chrp - start_ptr;
 }
 
+/*!
+ * Faster version of cvt_float_reference with byte-identical output.
+ * The reference splits off integer digits with float division. For integer parts below
+ * CVT_FLOAT_FAST_LIMIT, every step of that is exact enough to give the true decimal digits, so
+ * they are converted as an integer, two digits at a time.  The fraction digits are generated with
+ * the same float multiplies as the reference, without the calls to modf. Everything else (large
+ * numbers, NaN/inf, negative precision, rounding flag) goes to the reference.
+ * Added.
+ */
+s32 cvt_float(float x, s32 precision, s32* lead_char, char* buff_start, char* buff_end, u32 flags) {
+  float abs_x = x < 0.0f ? -x : x;
+  if (!(abs_x < CVT_FLOAT_FAST_LIMIT) || precision < 0 || (flags & 1)) {
+    return cvt_float_reference(x, precision, lead_char, buff_start, buff_end, flags);
+  }
+
+  *buff_start = 0;
+  *lead_char = x < 0.0f ? '-' : 0;
+
+  u32 integer_part = (u32)abs_x;
+  float fraction_part = abs_x - (float)integer_part;  // exact, like modf
+
+  char* start_ptr = buff_start + 1;
+  char* count_chrp = start_ptr;
+  if (integer_part == 0) {
+    *count_chrp++ = '0';
+  } else {
+    char digits[16];
+    char* end = digits + sizeof(digits);
+    char* ptr = write_decimal_digits(end, integer_part);
+    while (ptr < end) {
+      *count_chrp++ = *ptr++;
+    }
+  }
+
+  if (precision) {
+    *count_chrp++ = '.';
+  }
+
+  s32 prec = precision;
+  if (fraction_part != 0.0f && precision) {
+    do {
+      // v < 10, so the truncation and subtraction are exact.
+      float v = fraction_part * 10.f;
+      s32 digit = (s32)v;
+      fraction_part = v - (float)digit;
+      *count_chrp++ = '0' + digit;
+      prec--;
+    } while (prec && fraction_part != 0.f);
+  }
+
+  while (prec > 0) {
+    *count_chrp++ = '0';
+    prec--;
+  }
+
+  return count_chrp - start_ptr;
+}
+
 /*!
  * Convert floating point to a string.
  * Don't set the precision too high or you get NaN (if float is longer than 31 digits without
@@ -496,7 +706,7 @@ void ftoa(char* out_str, float x, s32 desired_len, char pad_char, s32 precision,
  * binary/hexadecimal truncated numbers.  Something like -1 (0xffffffff) will print as -fffffff....
  */
 
-char* kitoa(char* buffer, s64 value, u64 base, s32 length, char pad, u32 flag) {
+char* kitoa_reference(char* buffer, s64 value, u64 base, s32 length, char pad, u32 flag) {
   s64 negativeValue = 0;
   s64 value_to_print = value;
 
@@ -547,6 +757,64 @@ char* kitoa(char* buffer, s64 value, u64 base, s32 length, char pad, u32 flag) {
   return buffer;
 }
 
+/*!
+ * Faster version of kitoa_reference with byte-identical output.  Digits are written backward into
+ * a temporary buffer (two at a time in base 10), so there is no division by a variable base and
+ * no reverse. Bases other than 2, 10 and 16 go to the reference.
+ * Added.
+ */
+char* kitoa(char* buffer, s64 value, u64 base, s32 length, char pad, u32 flag) {
+  if (base != 10 && base != 16 && base != 2) {
+    return kitoa_reference(buffer, value, base, length, pad, flag);
+  }
+
+  char digits[72];
+  char* end = digits + sizeof(digits);
+  char* ptr;
+  bool negative = value < 0 && base == 10;
+  if (base == 10) {
+    // negating INT64_MIN gives INT64_MIN, which prints as 2^63, like the reference.
+    ptr = write_decimal_digits(end, negative ? -(u64)value : (u64)value);
+  } else {
+    u32 shift = base == 16 ? 4 : 1;
+    u64 mask = base - 1;
+    u64 v = value;
+    ptr = end;
+    do {
+      *--ptr = ConvertTable[v & mask];
+      v >>= shift;
+    } while (v);
+  }
+
+  if (negative) {
+    *--ptr = '-';
+  }
+  s32 count = end - ptr;
+
+  char* out = buffer;
+  if (length > count) {
+    // pad
+    for (s32 i = count; i < length; i++) {
+      *out++ = pad;
+    }
+  } else if (length > 0 && value < 0 && base != 10 && length < count) {
+    // truncate f's / 1's
+    char c = (base == 16) ? 'f' : '1';
+    while (length < count && *ptr == c) {
+      ptr++;
+      count--;
+    }
+
+    if (!(flag & 2)) {
+      *out++ = '-';
+    }
+  }
+
+  memcpy(out, ptr, count);
+  out[count] = 0;
+  return buffer;
+}
+
 /*!
  * Convert 128-bit integer to string.  Not implemented because it is never used in the game.
  * It would also require passing 128-bit values between GOAL and C++ and this is not worth
@@ -591,15 +859,8 @@ s32 format_impl(uint64_t* args) {
 
   u32 original_dest = args[0];
 
-  // set up print pending
-  char* print_temp = PrintPending.cast<char>().c();
-  if (!PrintPending.offset) {
-    print_temp = PrintBufArea.cast<char>().c() + sizeof(GoalMessageHeader);
-  }
-  PrintPending = make_ptr(strend(print_temp)).cast<u8>();
-
-  // what we write to
-  char* output_ptr = PrintPending.cast<char>().c();
+  // set up print pending, what we write to
+  char* output_ptr = start_print();
 
   // convert gstring to cstring
   char* format_cstring = format_gstring + 4;
@@ -633,6 +894,11 @@ s32 format_impl(uint64_t* args) {
 
   // loop over the format string
   while (*format_ptr) {
+    // added: stop if the print buffer is full.
+    if (!print_buffer_check(output_ptr)) {
+      break;
+    }
+
     // got a command?
     if (*format_ptr == '~') {
       char* arg_start = format_ptr;
@@ -763,7 +1029,7 @@ s32 format_impl(uint64_t* args) {
         case 'g': {
           *output_ptr = 0;
           u32 in = arg_regs[arg_reg_idx++];
-          kstrcat(output_ptr, Ptr<char>(in).c());
+          kstrncat(output_ptr, Ptr<char>(in).c(), print_buffer_room(output_ptr) - 1);
           output_ptr = strend(output_ptr);
         } break;
 
@@ -773,6 +1039,7 @@ s32 format_impl(uint64_t* args) {
           s8 arg0 = argument_data[0].data[0];
           s32 desired_length = arg0;
           *output_ptr = 0;
+          end_print(output_ptr);  // added
           u32 in = arg_regs[arg_reg_idx++];
           print_object(in);
           if (desired_length != -1) {
@@ -783,7 +1050,8 @@ s32 format_impl(uint64_t* args) {
                 output_ptr[desired_length - 1] = '~';
               }
               output_ptr[desired_length] = 0;  // and truncate
-            } else if (print_len < desired_length) {
+            } else if (print_len < desired_length &&
+                       print_buffer_room(output_ptr) > (u32)desired_length) {
               // too short
               if (justify == 0) {
                 char pad = ' ';
@@ -816,6 +1084,7 @@ s32 format_impl(uint64_t* args) {
           s8 arg0 = argument_data[0].data[0];
           s32 desired_length = arg0;
           *output_ptr = 0;
+          end_print(output_ptr);  // added
           u32 in = arg_regs[arg_reg_idx++];
 
           // if it's a string
@@ -833,7 +1102,8 @@ s32 format_impl(uint64_t* args) {
                 output_ptr[desired_length - 1] = '~';
               }
               output_ptr[desired_length] = 0;  // and truncate
-            } else if (print_len < desired_length) {
+            } else if (print_len < desired_length &&
+                       print_buffer_room(output_ptr) > (u32)desired_length) {
               // too short
               if (justify == 0) {
                 char pad = ' ';
@@ -872,6 +1142,7 @@ s32 format_impl(uint64_t* args) {
         case 'P':  // like ~A, but can specify type explicitly
         case 'p': {
           *output_ptr = 0;
+          end_print(output_ptr);  // added
           s8 arg0 = argument_data[0].data[0];
           u32 in = arg_regs[arg_reg_idx++];
           if (arg0 == -1) {
@@ -895,6 +1166,7 @@ s32 format_impl(uint64_t* args) {
         case 'I':  // like ~P, but calls inpsect
         case 'i': {
           *output_ptr = 0;
+          end_print(output_ptr);  // added
           s8 arg0 = argument_data[0].data[0];
           u32 in = arg_regs[arg_reg_idx++];
           if (arg0 == -1) {
@@ -1042,6 +1314,7 @@ s32 format_impl(uint64_t* args) {
 
   // end
   *output_ptr = 0;
+  end_print(output_ptr);  // added, the other destinations move this back to PrintPendingLocal3
   output_ptr++;
 
   if (original_dest == s7.offset + FIX_SYM_TRUE) {
@@ -1052,12 +1325,14 @@ s32 format_impl(uint64_t* args) {
     u32 string = make_string_from_c(PrintPendingLocal3);
     PrintPending = make_ptr(PrintPendingLocal2).cast<u8>();
     *PrintPendingLocal3 = 0;
+    end_print(PrintPendingLocal3);  // added
     return string;
   } else if (original_dest == 0) {
     printf("%s", PrintPendingLocal3);
     fflush(stdout);
     PrintPending = make_ptr(PrintPendingLocal2).cast<u8>();
     *PrintPendingLocal3 = 0;
+    end_print(PrintPendingLocal3);  // added
     return 0;
   } else {
     if ((original_dest & OFFSET_MASK) == BASIC_OFFSET) {
@@ -1068,6 +1343,7 @@ s32 format_impl(uint64_t* args) {
         kstrncat(str, PrintPendingLocal3, len);
         PrintPending = make_ptr(PrintPendingLocal2).cast<u8>();
         *PrintPendingLocal3 = 0;
+        end_print(PrintPendingLocal3);  // added
         return 0;
       } else if (type == *Ptr<Ptr<Type>>(s7.offset + FIX_SYM_FILE_STREAM_TYPE)) {
         throw std::runtime_error("FORMAT into a file stream not supported");
@@ -14,6 +14,9 @@ constexpr u32 DEBUG_MESSAGE_BUFFER_SIZE = 0x80000;
 constexpr u32 DEBUG_OUTPUT_BUFFER_SIZE = 0x80000;
 constexpr u32 DEBUG_PRINT_BUFFER_SIZE = 0x200000;
 constexpr u32 PRINT_BUFFER_SIZE = 0x2000;
+// added, the space checked for before a print that isn't size limited (like a number or a format
+// directive), so it can't write past the end of the print buffer.
+constexpr u32 PRINT_APPEND_RESERVE = 0x400;
 
 ///////////
 // SDATA
@@ -48,6 +51,31 @@ void clear_output();
  */
 void clear_print();
 
+/*!
+ * Get the end of the text in the print buffer, and make it the start of the pending print.
+ */
+char* start_print();
+
+/*!
+ * Record the end of the text in the print buffer, after writing a print up to end.
+ */
+void end_print(char* end);
+
+/*!
+ * Get the number of bytes that can be written at ptr in the print buffer.
+ */
+u32 print_buffer_room(const char* ptr);
+
+/*!
+ * Report that a print didn't fit in the print buffer.
+ */
+void print_buffer_overflow();
+
+/*!
+ * Check that there is room for a print of up to PRINT_APPEND_RESERVE bytes at ptr.
+ */
+bool print_buffer_check(const char* ptr);
+
 /*!
  * Buffer message to compiler indicating the target has reset.
  * Write to the beginning of the output buffer.
@@ -62,7 +90,7 @@ void output_unload(const char* name);
 /*!
  * Buffer message to compiler indicating some object file has been loaded.
  */
-void output_segment_load(const char* name, Ptr<u8> link_block, u32 flags);
+void output_segment_load(const char* name, Ptr<u8> link_block, u32 flags, s64 link_ns);
 
 #ifdef __linux__
 /*!
@@ -123,11 +151,24 @@ void MsgErr(const char* format, ...);
  */
 void reverse(char* s);
 
+// integer parts below this are converted as integers by cvt_float. added
+constexpr float CVT_FLOAT_FAST_LIMIT = 1048576.f;
+
 /*!
  * Helper function for floating point to string conversion.
  */
 s32 cvt_float(float x, s32 precision, s32* lead_char, char* buff_start, char* buff_end, u32 flags);
 
+/*!
+ * Original digit-by-digit version of cvt_float.
+ */
+s32 cvt_float_reference(float x,
+                        s32 precision,
+                        s32* lead_char,
+                        char* buff_start,
+                        char* buff_end,
+                        u32 flags);
+
 /*!
  * Convert floating point to a string.
  */
@@ -138,6 +179,11 @@ void ftoa(char* out_str, float x, s32 desired_len, char pad_char, s32 precision,
  */
 char* kitoa(char* buffer, s64 value, u64 base, s32 length, char pad, u32 flag);
 
+/*!
+ * Original digit-by-digit version of kitoa. Supports any base up to 16.
+ */
+char* kitoa_reference(char* buffer, s64 value, u64 base, s32 length, char pad, u32 flag);
+
 /*!
  * Convert 128-bit integer to string.  Not implemented because it is never used in the game.
  * The format function does have the ability to call it, but it always passes a zero because
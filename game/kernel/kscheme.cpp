@@ -5,6 +5,8 @@
 
 #include <cstring>
 #include <cassert>
+#include <unordered_map>
+#include <vector>
 #include "kscheme.h"
 #include "common/common_types.h"
 #include "kmachine.h"
@@ -19,6 +21,7 @@
 #include "common/symbols.h"
 #include "common/versions.h"
 #include "common/goal_constants.h"
+#include "common/util/Timer.h"
 
 //! Controls link mode when EnableMethodSet = 0, MasterDebug = 1, DiskBoot = 0. Will enable a
 //! warning message if EnableMethodSet = 1
@@ -41,9 +44,54 @@ s32 NumSymbols;
 // but is enabled when loading the engine.
 Ptr<u32> EnableMethodSet;
 
+// added, statistics about time spent propagating methods in method_set
+MethodSetStats method_set_stats;
+
 // used for crc32 calculation
 u32 crc_table[0x100];
 
+// tables for the crc32 of 4 bytes at a time, computed from crc_table. Added.
+u32 crc_table_4[4][0x100];
+
+// Added. Host-side index from symbol name hash to symbol, to speed up symbol lookups.
+// This is only an accelerator: every entry is checked against the symbol table before it is used,
+// and symbols missing from the index are found with the normal hash table probe.
+namespace {
+struct SymbolIndexEntry {
+  u32 hash;
+  u32 offset;
+};
+
+constexpr u32 SYMBOL_INDEX_SIZE = GOAL_MAX_SYMBOLS * 2;  // must be a power of two
+SymbolIndexEntry symbol_index[SYMBOL_INDEX_SIZE];
+u32 symbol_index_count;
+
+// Added. Host-side index from a type to the types that have it as their parent, updated whenever
+// set_type_values sets a parent. method_set uses this to visit only the children of a type instead
+// of searching the whole symbol table.
+std::unordered_map<u32, std::vector<u32>> type_children;
+
+// Added. Host-side ancestor display for types: the chain of parents from the root of the type tree
+// down to each type, so type_typep can check a single slot instead of walking up the parents.
+// Displays are built when set_type_values sets a parent, which also rebuilds the displays of all
+// child types, found with type_children.  If GOAL code changes the parent of a type directly, the
+// subtree is rebuilt the next time that type is checked.
+struct TypeDisplay {
+  u32 type;
+  u32 parent;     // parent of the type when the display was built
+  u32 depth;      // number of ancestors, or MAX_TYPE_DEPTH if too deep
+  u32 ancestors;  // index of the root in type_display_ancestors, followed by the rest of the chain
+};
+
+constexpr u32 TYPE_TYPEP_WALK_DEPTH = 4;  // parents checked before using the displays
+constexpr u32 TYPE_DISPLAY_INDEX_BITS = 14;
+constexpr u32 TYPE_DISPLAY_INDEX_SIZE = 1 << TYPE_DISPLAY_INDEX_BITS;  // twice GOAL_MAX_SYMBOLS
+TypeDisplay type_display_index[TYPE_DISPLAY_INDEX_SIZE];
+std::vector<u32> type_display_ancestors;  // MAX_TYPE_DEPTH entries per type
+u32 type_display_object;                  // the object type, which is the root of all displays
+u32 type_display_generation;              // incremented when the displays are cleared
+}  // namespace
+
 // value of the GOAL s7 register, pointing to the middle of the symbol table
 Ptr<u32> s7;
 
@@ -57,6 +105,10 @@ void kscheme_init_globals() {
   LastSymbol.offset = 0;
   EnableMethodSet.offset = 0;
   FastLink = 0;
+  clear_symbol_index();
+  type_children.clear();
+  clear_type_displays();
+  method_set_stats = MethodSetStats();
 }
 
 /*!
@@ -70,13 +122,31 @@ void init_crc() {
     }
     crc_table[i] = n;
   }
+
+  // crc_table_4[k][i] is the crc of byte i followed by k zero bytes, then shifted past 4 bytes of
+  // new data, so a crc can be advanced by 4 bytes with 4 lookups.
+  for (u32 i = 0; i < 0x100; i++) {
+    u32 n = crc_table[i];
+    crc_table_4[0][i] = n;
+    for (u32 k = 1; k < 4; k++) {
+      n = crc_table[n >> 24] ^ (n << 8);
+      crc_table_4[k][i] = n;
+    }
+  }
 }
 
 /*!
  * Take the CRC32 hash of some data
+ * Modified to process 4 bytes at a time, the result is the same as the game's byte-at-a-time loop.
  */
 u32 crc32(const u8* data, s32 size) {
   uint32_t crc = 0;
+  for (; size >= 4; size -= 4, data += 4) {
+    u32 word = (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+    crc = crc_table_4[3][crc >> 24] ^ crc_table_4[2][(crc >> 16) & 0xff] ^
+          crc_table_4[1][(crc >> 8) & 0xff] ^ crc_table_4[0][crc & 0xff] ^ word;
+  }
+
   for (int i = size; i != 0; i--, data++) {
     crc = crc_table[crc >> 24] ^ ((crc << 8) | *data);
   }
@@ -320,18 +390,30 @@ Ptr<Function> make_function_from_c_linux(void* func) {
   auto f = (uint64_t)func;
   auto fp = (u8*)&f;
 
+  int i = 0;
   // we will put the function address in RAX with a movabs rax, imm8
-  mem.c()[0] = 0x48;
-  mem.c()[1] = 0xb8;
-  for (int i = 0; i < 8; i++) {
-    mem.c()[2 + i] = fp[i];
+  mem.c()[i++] = 0x48;
+  mem.c()[i++] = 0xb8;
+  for (int j = 0; j < 8; j++) {
+    mem.c()[i++] = fp[j];
   }
 
-  // jmp rax
-  mem.c()[10] = 0xff;
-  mem.c()[11] = 0xe0;
-
-  // the C function's ret will return to the caller of this trampoline.
+  /*
+   * GOAL expects r10 and r11 to be saved by the callee, but in C they are temporaries.
+   * Modified to save them instead of jumping to the C function directly.
+push r10
+push r11
+sub rsp, 8
+call rax
+add rsp, 8
+pop r11
+pop r10
+ret
+   */
+  for (auto x : {0x41, 0x52, 0x41, 0x53, 0x48, 0x83, 0xEC, 0x08, 0xFF, 0xD0, 0x48, 0x83, 0xC4, 0x08,
+                 0x41, 0x5B, 0x41, 0x5A, 0xC3}) {
+    mem.c()[i++] = x;
+  }
 
   // CacheFlush(mem, 0x34);
 
@@ -571,6 +653,51 @@ Ptr<Symbol> find_symbol_in_area(u32 hash, const char* name, u32 start, u32 end)
   return Ptr<Symbol>(1);
 }
 
+/*!
+ * Remove all symbols from the symbol index. Added.
+ */
+void clear_symbol_index() {
+  memset(symbol_index, 0, sizeof(symbol_index));
+  symbol_index_count = 0;
+}
+
+/*!
+ * Look up a symbol in the symbol index. Returns null if it isn't there. Added.
+ */
+Ptr<Symbol> find_symbol_in_index(u32 hash, const char* name) {
+  for (u32 i = hash & (SYMBOL_INDEX_SIZE - 1); symbol_index[i].offset;
+       i = (i + 1) & (SYMBOL_INDEX_SIZE - 1)) {
+    if (symbol_index[i].hash == hash) {
+      auto sym = Ptr<Symbol>(symbol_index[i].offset);
+      if (info(sym)->hash == hash && !strcmp(info(sym)->str->data(), name)) {
+        return sym;
+      }
+    }
+  }
+  return Ptr<Symbol>(0);
+}
+
+/*!
+ * Add a symbol to the symbol index. Added.
+ */
+void add_symbol_to_index(u32 hash, Ptr<Symbol> sym) {
+  if (symbol_index_count >= SYMBOL_INDEX_SIZE / 2) {
+    // only happens if the symbol table was recreated without clearing the index. All entries are
+    // found again by the normal lookup, so it's safe to start over.
+    clear_symbol_index();
+  }
+
+  u32 i = hash & (SYMBOL_INDEX_SIZE - 1);
+  while (symbol_index[i].offset && symbol_index[i].offset != sym.offset) {
+    i = (i + 1) & (SYMBOL_INDEX_SIZE - 1);
+  }
+  if (!symbol_index[i].offset) {
+    symbol_index_count++;
+  }
+  symbol_index[i].hash = hash;
+  symbol_index[i].offset = sym.offset;
+}
+
 /*!
  * Searches the table for a symbol.  If the symbol is found, returns it.
  * If not, returns 0, but symbol_slot will contain the slot for the symbol.
@@ -578,8 +705,15 @@ Ptr<Symbol> find_symbol_in_area(u32 hash, const char* name, u32 start, u32 end)
  * Also allows you to find the empty pair by searching for _empty_
  */
 Ptr<Symbol> find_symbol_from_c(const char* name) {
+  return find_symbol_from_c(crc32((const u8*)name, (int)strlen(name)), name);
+}
+
+/*!
+ * Like find_symbol_from_c, but with an already computed hash of the name.
+ * Modified to check the symbol index before probing the symbol table.
+ */
+Ptr<Symbol> find_symbol_from_c(u32 hash, const char* name) {
   symbol_slot = 0;  // nowhere to put the symbol yet, clear any old symbol_slot result.
-  u32 hash = crc32((const u8*)name, (int)strlen(name));
 
   // check if we've got the empty pair.
   if (hash == EMPTY_HASH) {
@@ -588,6 +722,23 @@ Ptr<Symbol> find_symbol_from_c(const char* name) {
     }
   }
 
+  auto indexed = find_symbol_in_index(hash, name);
+  if (indexed.offset) {
+    return indexed;
+  }
+
+  auto sym = probe_symbol_table(hash, name);
+  if (sym.offset) {
+    add_symbol_to_index(hash, sym);
+  }
+  return sym;
+}
+
+/*!
+ * Search the symbol table's hash table for a symbol. This is the original lookup, without the
+ * symbol index.
+ */
+Ptr<Symbol> probe_symbol_table(u32 hash, const char* name) {
   s32 sh1 = hash << 0x13;
   s32 sh2 = sh1 >> 0x10;
   // will be signed, bottom 3 bits 0 (for alignment, symbol are every 8 bytes)
@@ -634,7 +785,9 @@ Ptr<Symbol> find_symbol_from_c(const char* name) {
  * returns the old one. Basically a LISP symbol intern
  */
 Ptr<Symbol> intern_from_c(const char* name) {
-  auto symbol = find_symbol_from_c(name);
+  // the hash is computed once and reused for the lookup and the new symbol.
+  u32 hash = crc32((const u8*)name, (int)strlen(name));
+  auto symbol = find_symbol_from_c(hash, name);
   if (symbol.offset) {
     // already exists, return it!
     return symbol;
@@ -645,10 +798,10 @@ Ptr<Symbol> intern_from_c(const char* name) {
   // set type tag
   symbol.cast<u32>().c()[-1] = *(s7 + FIX_SYM_SYMBOL_TYPE);
 
-  u32 hash = crc32((const u8*)name, (int)strlen(name));
   auto str = make_string_from_c(name);
   info(symbol)->str = Ptr<String>(str);
   info(symbol)->hash = hash;
+  add_symbol_to_index(hash, symbol);
 
   NumSymbols++;
   return symbol;
@@ -831,11 +984,161 @@ u64 new_type(u32 symbol, u32 parent, u64 flags) {
   return set_type_values(new_type, Ptr<Type>(parent), flags).offset;
 }
 
+/*!
+ * Move a type from the children of old_parent to the children of new_parent in the child index.
+ * Added.
+ */
+void index_type_parent(Ptr<Type> type, Ptr<Type> old_parent, Ptr<Type> new_parent) {
+  auto old_siblings = type_children.find(old_parent.offset);
+  if (old_siblings != type_children.end()) {
+    auto& children = old_siblings->second;
+    for (auto& child : children) {
+      if (child == type.offset) {
+        child = children.back();
+        children.pop_back();
+        break;
+      }
+    }
+  }
+  type_children[new_parent.offset].push_back(type.offset);
+}
+
+/*!
+ * Get the types which have the given type as their parent. Added.
+ */
+std::vector<u32> get_type_children(Ptr<Type> type) {
+  auto kv = type_children.find(type.offset);
+  if (kv == type_children.end()) {
+    return {};
+  }
+  return kv->second;
+}
+
+/*!
+ * Remove all ancestor displays. They are rebuilt as types are used. Added.
+ */
+void clear_type_displays() {
+  memset(type_display_index, 0, sizeof(type_display_index));
+  type_display_ancestors.clear();
+  type_display_object = 0;
+  type_display_generation++;
+}
+
+namespace {
+u32 type_display_hash(u32 type) {
+  // types are 16-byte aligned and usually allocated together, so keep them close in the index.
+  return (type >> 4) & (TYPE_DISPLAY_INDEX_SIZE - 1);
+}
+
+/*!
+ * Displays end at the object type, so they must be rebuilt if it changes.
+ */
+void check_type_display_object() {
+  if (type_display_object != *(s7 + FIX_SYM_OBJECT_TYPE)) {
+    clear_type_displays();
+    type_display_object = *(s7 + FIX_SYM_OBJECT_TYPE);
+  }
+}
+
+/*!
+ * Build the ancestor display of a type from its parents. This stops at the same types as the
+ * parent walk in type_typep_walk: object, or a type without a parent.
+ */
+TypeDisplay* build_type_display(Ptr<Type> type) {
+  check_type_display_object();
+  u32 i = type_display_hash(type.offset);
+  while (type_display_index[i].type && type_display_index[i].type != type.offset) {
+    i = (i + 1) & (TYPE_DISPLAY_INDEX_SIZE - 1);
+  }
+  auto& display = type_display_index[i];
+  if (!display.type) {
+    if (type_display_ancestors.size() >= MAX_TYPE_DEPTH * TYPE_DISPLAY_INDEX_SIZE / 2) {
+      // only happens if types were recreated without clearing the displays.
+      clear_type_displays();
+      return build_type_display(type);
+    }
+    display.type = type.offset;
+    display.ancestors = type_display_ancestors.size();
+    type_display_ancestors.resize(type_display_ancestors.size() + MAX_TYPE_DEPTH);
+  }
+  display.parent = type->parent.offset;
+
+  // collect the chain from the type up to the root, then store it in reverse.
+  u32 chain[MAX_TYPE_DEPTH];
+  u32 count = 0;
+  Ptr<Type> t = type;
+  while (true) {
+    if (count == MAX_TYPE_DEPTH) {
+      display.depth = MAX_TYPE_DEPTH;
+      return &display;
+    }
+    chain[count++] = t.offset;
+    if (t.offset == type_display_object || !t->parent.offset || t->parent == t) {
+      break;
+    }
+    t = t->parent;
+  }
+
+  display.depth = count - 1;
+  for (u32 j = 0; j < count; j++) {
+    type_display_ancestors[display.ancestors + j] = chain[count - 1 - j];
+  }
+  return &display;
+}
+
+/*!
+ * Rebuild the displays of a type and everything below it, after the type's parent changed.
+ * Returns the display of the type.
+ */
+TypeDisplay* rebuild_type_displays(Ptr<Type> type) {
+  build_type_display(type);
+  std::vector<u32> to_visit = {type.offset};
+  while (!to_visit.empty()) {
+    Ptr<Type> parent(to_visit.back());
+    to_visit.pop_back();
+    auto children = type_children.find(parent.offset);
+    if (children == type_children.end()) {
+      continue;
+    }
+    for (auto child : children->second) {
+      if (child != parent.offset && Ptr<Type>(child)->parent.offset == parent.offset) {
+        build_type_display(Ptr<Type>(child));
+        to_visit.push_back(child);
+      }
+    }
+  }
+  // look it up again, building the displays may have cleared them.
+  return build_type_display(type);
+}
+
+/*!
+ * Get the ancestor display of a type, building it if it is missing. If the parent of the type was
+ * changed without set_type_values, the child index is fixed and the whole subtree is rebuilt.
+ * Returns null if the type is too deep for a display.
+ */
+TypeDisplay* get_type_display(Ptr<Type> type) {
+  u32 i = type_display_hash(type.offset);
+  while (type_display_index[i].type && type_display_index[i].type != type.offset) {
+    i = (i + 1) & (TYPE_DISPLAY_INDEX_SIZE - 1);
+  }
+  TypeDisplay* display = &type_display_index[i];
+  if (!display->type) {
+    display = build_type_display(type);
+  } else if (display->parent != type->parent.offset) {
+    index_type_parent(type, Ptr<Type>(display->parent), type->parent);
+    display = rebuild_type_displays(type);
+  }
+  return display->depth < MAX_TYPE_DEPTH ? display : nullptr;
+}
+}  // namespace
+
 /*!
  * Configure a type.
  */
 Ptr<Type> set_type_values(Ptr<Type> type, Ptr<Type> parent, u64 flags) {
+  index_type_parent(type, type->parent, parent);  // added
   type->parent = parent;
+  rebuild_type_displays(type);  // added
   type->allocated_size = (flags & 0xffff);
   type->heap_base = (flags >> 16) & 0xffff;
   type->padded_size = ((type->allocated_size + 0xf) & 0xfff0);
@@ -848,14 +1151,68 @@ Ptr<Type> set_type_values(Ptr<Type> type, Ptr<Type> parent, u64 flags) {
   return type;
 }
 
+/*!
+ * Get the number of ancestors of a type, according to its display. Added.
+ */
+u32 type_depth(Ptr<Type> type) {
+  check_type_display_object();
+  auto display = get_type_display(type);
+  return display ? display->depth : MAX_TYPE_DEPTH;
+}
+
 /*!
  * Is t1 a t2?
+ * Modified to check the ancestor displays: t2 is an ancestor of t1 if it is in the display of t1 at
+ * t2's depth.  The first few parents are still checked directly, as that is faster than looking up
+ * two displays for the shallow builtin types.  Types deeper than MAX_TYPE_DEPTH walk the parents.
  */
 u64 type_typep(Ptr<Type> t1, Ptr<Type> t2) {
   if (t1 == t2) {
     return (s7 + FIX_SYM_TRUE).offset;
   }
 
+  u32 object_type = *(s7 + FIX_SYM_OBJECT_TYPE);
+  for (u32 i = 0; i < TYPE_TYPEP_WALK_DEPTH; i++) {
+    t1 = t1->parent;
+    if (t1 == t2) {
+      return (s7 + FIX_SYM_TRUE).offset;
+    }
+    if (!t1.offset || t1.offset == object_type) {
+      return s7.offset;
+    }
+  }
+
+  // t1 is now an ancestor of the original t1, with the same ancestors above it.
+  check_type_display_object();
+  auto d1 = get_type_display(t1);
+  if (!d1) {
+    return type_typep_walk(t1, t2);
+  }
+  u32 generation = type_display_generation;
+  auto d2 = get_type_display(t2);
+  if (generation != type_display_generation) {
+    // the displays were cleared while looking up t2, so d1 is gone.
+    return type_typep_walk(t1, t2);
+  }
+  if (!d2) {
+    // t2 is too deep to fit in t1's display.
+    return s7.offset;
+  }
+  if (d2->depth <= d1->depth &&
+      type_display_ancestors[d1->ancestors + d2->depth] == t2.offset) {
+    return (s7 + FIX_SYM_TRUE).offset;
+  }
+  return s7.offset;
+}
+
+/*!
+ * Is t1 a t2? The original implementation, walking up the parents of t1.
+ */
+u64 type_typep_walk(Ptr<Type> t1, Ptr<Type> t2) {
+  if (t1 == t2) {
+    return (s7 + FIX_SYM_TRUE).offset;
+  }
+
   do {
     t1 = t1->parent;
     if (t1 == t2) {
@@ -865,6 +1222,13 @@ u64 type_typep(Ptr<Type> t1, Ptr<Type> t2) {
   return s7.offset;
 }
 
+/*!
+ * Wrapper of type_typep to use with GOAL. Added.
+ */
+u64 type_type_fast(u32 t1, u32 t2) {
+  return type_typep(Ptr<Type>(t1), Ptr<Type>(t2));
+}
+
 /*!
  * Set method of type.
  * Looks at the EnableMethodSet symbol to determine if it should loop through all types looking for
@@ -905,88 +1269,52 @@ u64 method_set(u32 type_, u32 method_id, u32 method) {
 
   // this is kind of a strange combination...
   if (*EnableMethodSet || (!FastLink && MasterDebug && !DiskBoot)) {
-    // upper table
-    auto sym = s7.offset;
-    for (; sym < LastSymbol.offset; sym += 8) {
-      auto symValue = *Ptr<u32>(sym);
-      if ((symValue < SymbolTable2.offset || 0x7ffffff < symValue) &&  // not in normal memory
-          (symValue < 0x84000 || 0x100000 <= symValue)) {              // not in kernel memory
-        continue;
-      }
-
-      if ((symValue & OFFSET_MASK) != BASIC_OFFSET) {
+    Timer propagate_timer;  // added
+
+    // added: instead of checking every symbol in the symbol table for a type that is a child of
+    // this type, walk the child index.  This visits the same types, as the index has every type
+    // with a parent, but only the ones below this type.
+    std::vector<u32> to_visit;
+    to_visit.push_back(type.offset);
+    while (!to_visit.empty()) {
+      Ptr<Type> parent(to_visit.back());
+      to_visit.pop_back();
+      auto children = type_children.find(parent.offset);
+      if (children == type_children.end()) {
         continue;
       }
 
-      auto objType = *Ptr<Ptr<Type>>(symValue - 4);
-      if (objType.offset != *(s7 + FIX_SYM_TYPE_TYPE)) {
-        continue;
-      }
+      for (auto child : children->second) {
+        auto symAsType = Ptr<Type>(child);
+        // object is its own parent, and the index may be out of date if GOAL changes a parent.
+        if (symAsType == parent || symAsType->parent.offset != parent.offset ||
+            *Ptr<u32>(child - 4) != *(s7 + FIX_SYM_TYPE_TYPE)) {
+          continue;
+        }
+        to_visit.push_back(child);
 
-      auto symAsType = Ptr<Type>(symValue);
-      if (method_id >= symAsType->num_methods) {
-        continue;
-      }
+        if (method_id >= symAsType->num_methods) {
+          continue;
+        }
 
-      if (symAsType->get_method(method_id).offset != existing_method) {
-        continue;
-      }
+        if (symAsType->get_method(method_id).offset != existing_method) {
+          continue;
+        }
 
-      if (type_typep(symAsType, type) == s7.offset) {
-        continue;
-      }
+        if (FastLink) {
+          // you were saved by EnableMethodSet.  I guess we warn.
+          printf("************ WARNING **************\n");
+          printf("method %d of %s redefined - you must define class heirarchies in order now\n",
+                 method_id, info(symAsType->symbol)->str->data());
+          printf("***********************************\n");
+        }
 
-      if (FastLink) {
-        // you were saved by EnableMethodSet.  I guess we warn.
-        printf("************ WARNING **************\n");
-        printf("method %d of %s redefined - you must define class heirarchies in order now\n",
-               method_id, info(symAsType->symbol)->str->data());
-        printf("***********************************\n");
+        symAsType->get_method(method_id).offset = method;
       }
-
-      symAsType->get_method(method_id).offset = method;
     }
 
-    sym = SymbolTable2.offset;
-    for (; sym < s7.offset; sym += 8) {
-      auto symValue = *Ptr<u32>(sym);
-      if ((symValue < SymbolTable2.offset || 0x7ffffff < symValue) &&  // not in normal memory
-          (symValue < 0x84000 || 0x100000 <= symValue)) {              // not in kernel memory
-        continue;
-      }
-
-      if ((symValue & OFFSET_MASK) != BASIC_OFFSET) {
-        continue;
-      }
-
-      auto objType = *Ptr<Ptr<Type>>(symValue - 4);
-      if (objType.offset != *(s7 + FIX_SYM_TYPE_TYPE)) {
-        continue;
-      }
-
-      auto symAsType = Ptr<Type>(symValue);
-      if (method_id >= symAsType->num_methods) {
-        continue;
-      }
-
-      if (symAsType->get_method(method_id).offset != existing_method) {
-        continue;
-      }
-
-      if (type_typep(symAsType, type) == s7.offset) {
-        continue;
-      }
-
-      if (FastLink) {
-        // you were saved by EnableMethodSet.  I guess we warn.
-        printf("************ WARNING **************\n");
-        printf("method %d of %s redefined - you must define class heirarchies in order now\n",
-               method_id, info(symAsType->symbol)->str->data());
-        printf("***********************************\n");
-      }
-
-      symAsType->get_method(method_id).offset = method;
-    }
+    method_set_stats.propagate_count++;
+    method_set_stats.propagate_ns += propagate_timer.getNs();
   }
   return method;
 }
@@ -1171,13 +1499,12 @@ u64 print_pair(u32 obj) {
  */
 u64 print_integer(u64 obj) {
   // not sure why this is any better than cprintf("%ld") or similar. Maybe a tiny bit faster?
-  char* str = PrintPending.cast<char>().c();
-  if (!str) {
-    str = (PrintBufArea + 0x18).cast<char>().c();
+  // modified to use start_print/end_print instead of searching for the end of the print buffer.
+  char* str = start_print();
+  if (print_buffer_check(str)) {
+    kitoa(str, obj, 10, 0xffffffff, '0', 0);
+    end_print(strend(str));
   }
-
-  PrintPending = make_ptr(strend(str)).cast<u8>();
-  kitoa((char*)PrintPending.c(), obj, 10, 0xffffffff, '0', 0);
   return obj;
 }
 
@@ -1185,13 +1512,11 @@ u64 print_integer(u64 obj) {
  * Print a boxed integer. Works correctly for 64-bit integers. Assumes signed.
  */
 u64 print_binteger(u64 obj) {
-  char* str = PrintPending.cast<char>().c();
-  if (!PrintPending.offset) {
-    str = (PrintBufArea + 0x18).cast<char>().c();
+  char* str = start_print();
+  if (print_buffer_check(str)) {
+    kitoa(str, ((s64)obj) >> 3, 10, 0xffffffff, '0', 0);
+    end_print(strend(str));
   }
-
-  PrintPending = make_ptr(strend(str)).cast<u8>();
-  kitoa((char*)PrintPending.c(), ((s64)obj) >> 3, 10, 0xffffffff, '0', 0);
   return obj;
 }
 
@@ -1202,14 +1527,11 @@ u64 print_float(u32 f) {
   // again not sure why this is any better than cprintf("%f") or similar. Maybe a tiny bit faster?
   float ff;
   *(u32*)&ff = f;
-  char* str = PrintPending.cast<char>().c();
-  if (!PrintPending.offset) {
-    str = (PrintBufArea + 0x18).cast<char>().c();
+  char* str = start_print();
+  if (print_buffer_check(str)) {
+    ftoa(str, ff, 0xffffffff, ' ', 4, 0);
+    end_print(strend(str));
   }
-
-  PrintPending = make_ptr(strend(str)).cast<u8>();
-
-  ftoa((char*)PrintPending.c(), ff, 0xffffffff, ' ', 4, 0);
   return f;
 }
 
@@ -1381,15 +1703,11 @@ u64 inspect_float(u32 f) {
   ff = *(float*)(&f);
   cprintf("[%8x] float ", f);
 
-  // likely copy-pasta - no need for this check because of the cprintf immediately before.
-  char* str = PrintPending.cast<char>().c();
-  if (!str) {
-    str = (PrintBufArea + 0x18).cast<char>().c();
+  char* str = start_print();
+  if (print_buffer_check(str)) {
+    ftoa(str, ff, -1, ' ', 4, 0);
+    end_print(strend(str));
   }
-
-  PrintPending = make_ptr(strend(str)).cast<u8>();
-
-  ftoa(PrintPending.cast<char>().c(), ff, -1, ' ', 4, 0);
   cprintf("\n");
   return f;
 }
@@ -1834,6 +2152,7 @@ s32 InitHeapAndSymbol() {
 
   // type system
   make_function_symbol_from_c("method-set!", (void*)method_set);
+  make_function_symbol_from_c("type-type-fast?", (void*)type_type_fast);  // added
 
   // dgo
   make_function_symbol_from_c("link", (void*)link_and_exec_wrapper);
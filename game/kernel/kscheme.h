@@ -8,6 +8,7 @@
 #ifndef JAK_KSCHEME_H
 #define JAK_KSCHEME_H
 
+#include <vector>
 #include "common/common_types.h"
 #include "kmachine.h"
 #include "kmalloc.h"
@@ -18,6 +19,7 @@ extern Ptr<u32> EnableMethodSet;
 extern Ptr<u32> s7;
 extern Ptr<u32> SymbolTable2;
 extern Ptr<u32> LastSymbol;
+extern u32 crc_table[0x100];
 
 constexpr s32 GOAL_MAX_SYMBOLS = 0x2000;
 
@@ -29,6 +31,19 @@ constexpr u32 CRC_POLY = 0x04c11db7;
 constexpr u32 DEFAULT_METHOD_COUNT = 12;
 constexpr u32 FALLBACK_UNKNOWN_METHOD_COUNT = 44;
 
+// added, deepest type hierarchy handled by the ancestor display in type_typep.
+constexpr u32 MAX_TYPE_DEPTH = 32;
+
+/*!
+ * Added. Counts calls to method_set that propagated a method to child types, and how long it took.
+ */
+struct MethodSetStats {
+  u64 propagate_count = 0;
+  s64 propagate_ns = 0;
+};
+
+extern MethodSetStats method_set_stats;
+
 struct String {
   u32 len;
   char* data() { return ((char*)this) + sizeof(String); }
@@ -84,6 +99,8 @@ u64 alloc_from_heap(u32 heapSymbol, u32 type, s32 size);
 Ptr<Symbol> intern_from_c(const char* name);
 Ptr<Type> intern_type_from_c(const char* name, u64 methods);
 Ptr<Type> set_type_values(Ptr<Type> type, Ptr<Type> parent, u64 flags);
+u64 new_type(u32 symbol, u32 parent, u64 flags);
+u64 method_set(u32 type_, u32 method_id, u32 method);
 u64 print_object(u32 obj);
 u64 print_pair(u32 obj);
 u64 print_binteger(u64 obj);
@@ -94,6 +111,16 @@ u64 call_goal(Ptr<Function> f, u64 a, u64 b, u64 c, u64 st, void* offset);
 void print_symbol_table();
 u64 make_string_from_c(const char* c_str);
 Ptr<Symbol> find_symbol_from_c(const char* name);
+Ptr<Symbol> find_symbol_from_c(u32 hash, const char* name);
+Ptr<Symbol> probe_symbol_table(u32 hash, const char* name);
+void clear_symbol_index();
+void index_type_parent(Ptr<Type> type, Ptr<Type> old_parent, Ptr<Type> new_parent);
+std::vector<u32> get_type_children(Ptr<Type> type);
+void clear_type_displays();
+u32 type_depth(Ptr<Type> type);
+u64 type_typep(Ptr<Type> t1, Ptr<Type> t2);
+u64 type_typep_walk(Ptr<Type> t1, Ptr<Type> t2);
+u64 type_type_fast(u32 t1, u32 t2);
 u64 call_method_of_type(u32 arg, Ptr<Type> type, u32 method_id);
 u64 inspect_object(u32 obj);
 u64 new_pair(u32 heap, u32 type, u32 car, u32 cdr);
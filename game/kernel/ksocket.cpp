@@ -23,7 +23,9 @@ u32 ReceiveToBuffer(char* buff) {
 
   // if we received less than the size of the message header, we either got nothing, or there was an
   // error
-  if (protoBlock.last_receive_size < (int)sizeof(GoalMessageHeader)) {
+  // modified to also check the pending flag, which orders this with the write of the buffer.
+  if (!GoalProtoMessagePending() ||
+      protoBlock.last_receive_size < (int)sizeof(GoalMessageHeader)) {
     return -1;
   }
 
@@ -38,7 +40,8 @@ u32 ReceiveToBuffer(char* buff) {
     // copy stuff to block
     protoBlock.msg_kind = gbuff->msg_kind;
     protoBlock.msg_id = gbuff->msg_id;
-    // and mark message as received!
+    // and mark message as received! Modified: the buffer isn't received into again until
+    // GoalProtoMessageDone is called, once the message has been processed.
     protoBlock.last_receive_size = -1;
   } else {
     // not our protocol, something has gone wrong.
@@ -46,7 +49,7 @@ u32 ReceiveToBuffer(char* buff) {
            (int64_t)protoBlock.receive_buffer, protoBlock.last_receive_size,
            protoBlock.receive_buffer->msg_kind, protoBlock.receive_buffer->u6,
            protoBlock.receive_buffer->msg_id, msg_size);
-    protoBlock.last_receive_size = -1;
+    GoalProtoMessageDone();
     return -1;
   }
   return msg_size;
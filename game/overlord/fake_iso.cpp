@@ -16,6 +16,7 @@
 #include "isocommon.h"
 #include "overlord.h"
 #include "common/util/FileUtil.h"
+#include "game/system/FileCache.h"
 
 using namespace iop;
 
@@ -195,11 +196,16 @@ static const char* get_file_path(FileRecord* fr) {
 }
 
 /*!
- * Determine the length of a file. This isn't very fast, but nobody checks file sizes extremely
- * quickly. This is an ISO FS API Function
+ * Determine the length of a file. The file is loaded into the file cache if it fits, as it is
+ * usually about to be read. This is an ISO FS API Function
  */
 uint32_t FS_GetLength(FileRecord* fr) {
   const char* path = get_file_path(fr);
+  auto data = file_cache.get_if_cacheable(path);
+  if (data) {
+    return data->size();
+  }
+
   FILE* fp = fopen(path, "rb");
   assert(fp);
   fseek(fp, 0, SEEK_END);
@@ -270,8 +276,6 @@ void FS_Close(LoadStackEntry* fd) {
 /*!
  * Begin reading!  Returns FS_READ_OK on success (always)
  * This is an ISO FS API Function
- *
- * Idea: do the fopen in FS_Open and keep the file open?  It would be faster.
  */
 uint32_t FS_BeginRead(LoadStackEntry* fd, void* buffer, int32_t len) {
   assert(fd->fr->location < fake_iso_entry_count);
@@ -287,25 +291,40 @@ uint32_t FS_BeginRead(LoadStackEntry* fd, void* buffer, int32_t len) {
   real_size = sectors * SECTOR_SIZE;
   u32 offset_into_file = SECTOR_SIZE * fd->location;
 
+  // repeated reads of the same file (like DGOs loaded in chunks) are served from the file cache.
+  // files that don't fit are read from disk, only the part that was asked for.
   const char* path = get_file_path(fd->fr);
-  FILE* fp = fopen(path, "rb");
-  assert(fp);
-  fseek(fp, 0, SEEK_END);
-  uint32_t file_len = ftell(fp);
-  rewind(fp);
+  auto data = file_cache.get_if_cacheable(path);
+  if (data) {
+    uint32_t file_len = data->size();
+    if (offset_into_file < file_len) {
+      if (offset_into_file + real_size > file_len) {
+        real_size = (file_len - offset_into_file);
+      }
 
-  if (offset_into_file < file_len) {
-    if (offset_into_file) {
-      fseek(fp, offset_into_file, SEEK_SET);
+      memcpy(buffer, data->data() + offset_into_file, real_size);
     }
+  } else {
+    FILE* fp = fopen(path, "rb");
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    uint32_t file_len = ftell(fp);
+    rewind(fp);
+
+    if (offset_into_file < file_len) {
+      if (offset_into_file) {
+        fseek(fp, offset_into_file, SEEK_SET);
+      }
 
-    if (offset_into_file + real_size > file_len) {
-      real_size = (file_len - offset_into_file);
-    }
+      if (offset_into_file + real_size > file_len) {
+        real_size = (file_len - offset_into_file);
+      }
 
-    if (fread(buffer, real_size, 1, fp) != 1) {
-      assert(false);
+      if (fread(buffer, real_size, 1, fp) != 1) {
+        assert(false);
+      }
     }
+    fclose(fp);
   }
 
   if (len < 0) {
@@ -61,6 +61,9 @@ void deci2_runner(SystemThreadInterface& iface) {
   Deci2Server server(shutdown_callback);
   ee::LIBRARY_sceDeci2_register(&server);
 
+  // don't receive more messages than the kernel can queue.
+  server.set_receive_ready([]() { return !GoalProtoQueueFull(); });
+
   // now its ok to continue with initialization
   iface.initialization_complete();
 
@@ -4,6 +4,7 @@
  * Works with deci2.cpp (sceDeci2) to implement the networking on target
  */
 
+#include <chrono>
 #include <cstdio>
 #include <cassert>
 #include <utility>
@@ -25,6 +26,9 @@
 #include "common/versions.h"
 #include "Deci2Server.h"
 
+// turn on printf's for every message received.
+constexpr bool debug_deci2 = false;
+
 Deci2Server::Deci2Server(std::function<bool()> shutdown_callback) {
   buffer = new char[BUFFER_SIZE];
   want_exit = std::move(shutdown_callback);
@@ -194,11 +198,36 @@ void Deci2Server::run() {
   }
 
   auto* hdr = (Deci2Header*)(buffer);
-  fprintf(stderr, "[DECI2] Got message: %d %d 0x%x %c -> %c\n", hdr->len, hdr->rsvd, hdr->proto,
-          hdr->src, hdr->dst);
+  if (debug_deci2) {
+    fprintf(stderr, "[DECI2] Got message: %d %d 0x%x %c -> %c\n", hdr->len, hdr->rsvd, hdr->proto,
+            hdr->src, hdr->dst);
+  }
 
+  // read the rest of the message now.  In pipelined mode, the listener sends the next message
+  // before the previous one is acked, so this overlaps with the program running the previous one.
+  assert(hdr->len <= BUFFER_SIZE);
+  while (got < hdr->len) {
+    auto x = read_from_socket(new_sock, buffer + got, hdr->len - got);
+    if (want_exit()) {
+      return;
+    }
+    got += x > 0 ? x : 0;
+  }
   hdr->rsvd = got;
 
+  // wait until the program has room for another message.
+  // this is usually quick, so spin for a bit before sleeping.
+  for (int tries = 0; receive_ready && !receive_ready(); tries++) {
+    if (want_exit()) {
+      return;
+    }
+    if (tries < 1000) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+
   // see what protocol we got:
   lock();
 
@@ -223,33 +252,25 @@ void Deci2Server::run() {
   auto& driver = d2_drivers[handler];
 
   int sent_to_program = 0;
-  while (!want_exit() && (hdr->rsvd < hdr->len || sent_to_program < hdr->rsvd)) {
-    // send what we have to the program
-    if (sent_to_program < hdr->rsvd) {
-      //      driver.next_recv_size = 0;
-      //      driver.next_recv = nullptr;
-      driver.recv_buffer = buffer + sent_to_program;
-      driver.available_to_receive = hdr->rsvd - sent_to_program;
-      (driver.handler)(DECI2_READ, driver.available_to_receive, driver.opt);
-      //      memcpy(driver.next_recv, buffer + sent_to_program, driver.next_recv_size);
-      sent_to_program += driver.recv_size;
-    }
-
-    // receive from network
-    if (hdr->rsvd < hdr->len) {
-      auto x = read_from_socket(new_sock, buffer + hdr->rsvd, hdr->len - hdr->rsvd);
-      if (want_exit()) {
-        return;
-      }
-      got += x > 0 ? x : 0;
-      hdr->rsvd = got;
-    }
+  while (!want_exit() && sent_to_program < hdr->rsvd) {
+    driver.recv_buffer = buffer + sent_to_program;
+    driver.available_to_receive = hdr->rsvd - sent_to_program;
+    (driver.handler)(DECI2_READ, driver.available_to_receive, driver.opt);
+    sent_to_program += driver.recv_size;
   }
 
   (driver.handler)(DECI2_READDONE, 0, driver.opt);
   unlock();
 }
 
+/*!
+ * Set a function to check if the program is ready to receive another message.  Without one,
+ * messages are passed along as soon as they arrive.
+ */
+void Deci2Server::set_receive_ready(std::function<bool()> ready) {
+  receive_ready = std::move(ready);
+}
+
 /*!
  * Background thread for waiting for the listener.
  */
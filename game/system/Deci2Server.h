@@ -33,6 +33,7 @@ class Deci2Server {
   void unlock();
   void wait_for_protos_ready();
   void send_proto_ready(Deci2Driver* drivers, int* driver_count);
+  void set_receive_ready(std::function<bool()> ready);
 
   void run();
 
@@ -48,6 +49,7 @@ class Deci2Server {
   bool accept_thread_running = false;
   bool server_connected = false;
   std::function<bool()> want_exit;
+  std::function<bool()> receive_ready;
   std::thread accept_thread;
 
   std::condition_variable cv;
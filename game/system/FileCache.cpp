@@ -0,0 +1,195 @@
+/*!
+ * @file FileCache.cpp
+ * Host-side cache of file contents, used by the kernel's FileLoad and the fake ISO file system.
+ */
+
+#include <cstdio>
+#include <sys/stat.h>
+#include "FileCache.h"
+
+FileCache file_cache;
+
+namespace {
+/*!
+ * Read size bytes from the start of a file, or nullptr if that fails.
+ */
+FileCache::Data read_file(const std::string& path, u64 size) {
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (!fp) {
+    return nullptr;
+  }
+  auto data = std::make_shared<std::vector<u8>>(size);
+  if (size && fread(data->data(), size, 1, fp) != 1) {
+    fclose(fp);
+    return nullptr;
+  }
+  fclose(fp);
+  return data;
+}
+
+/*!
+ * Modification time of a file, in nanoseconds where the platform has them, so a file rebuilt within
+ * the same second is noticed.
+ */
+s64 modification_time(const struct stat& st) {
+#ifdef __linux__
+  return (s64)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#else
+  return (s64)st.st_mtime * 1000000000;
+#endif
+}
+}  // namespace
+
+FileCache::FileCache(u64 budget) {
+  m_stats.budget = budget;
+}
+
+/*!
+ * Get the contents of a file.  If the file is cached and hasn't changed on disk, the cached copy is
+ * returned, otherwise it is read from disk and added to the cache (if it fits in the budget).
+ * Returns nullptr if the file can't be read.
+ */
+FileCache::Data FileCache::get(const std::string& path) {
+  auto data = get_if_cacheable(path);
+  if (data) {
+    return data;
+  }
+
+  // too big to cache, or missing.
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return nullptr;
+  }
+  data = read_file(path, st.st_size);
+  if (data) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.misses++;
+    m_stats.bytes_loaded += data->size();
+  }
+  return data;
+}
+
+/*!
+ * Like get, but returns nullptr without reading the file if it doesn't fit in the budget, so
+ * callers which only need part of a big file can read just that part.
+ */
+FileCache::Data FileCache::get_if_cacheable(const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return nullptr;
+  }
+  auto mtime = modification_time(st);
+  auto size = (u64)st.st_size;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto kv = m_entries.find(path);
+    if (kv != m_entries.end()) {
+      auto& entry = kv->second;
+      if (entry.mtime == mtime && entry.size == size) {
+        m_lru.splice(m_lru.begin(), m_lru, entry.lru_it);
+        m_stats.hits++;
+        m_stats.bytes_saved += size;
+        return entry.data;
+      }
+
+      // stale, forget about it and reload.
+      drop_entry(kv);
+    }
+
+    if (size > m_stats.budget) {
+      return nullptr;
+    }
+  }
+
+  // read without the lock, so other loads don't wait for the disk.
+  auto data = read_file(path, size);
+  if (!data) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.misses++;
+  m_stats.bytes_loaded += size;
+
+  // another thread may have loaded it in the meantime.
+  auto kv = m_entries.find(path);
+  if (kv != m_entries.end()) {
+    drop_entry(kv);
+  }
+
+  if (size > m_stats.budget) {
+    // the budget changed while reading.
+    return data;
+  }
+
+  evict_to(m_stats.budget - size);
+  m_lru.push_front(path);
+  auto& entry = m_entries[path];
+  entry.data = data;
+  entry.mtime = mtime;
+  entry.size = size;
+  entry.lru_it = m_lru.begin();
+  m_stats.bytes_used += size;
+  m_stats.file_count++;
+
+  return data;
+}
+
+/*!
+ * Remove a file from the cache. Must hold the lock.
+ */
+void FileCache::drop_entry(std::unordered_map<std::string, Entry>::iterator kv) {
+  m_stats.bytes_used -= kv->second.size;
+  m_stats.file_count--;
+  m_lru.erase(kv->second.lru_it);
+  m_entries.erase(kv);
+}
+
+/*!
+ * Drop least recently used files until no more than budget bytes are used. Must hold the lock.
+ */
+void FileCache::evict_to(u64 budget) {
+  while (m_stats.bytes_used > budget && !m_lru.empty()) {
+    auto kv = m_entries.find(m_lru.back());
+    m_stats.bytes_used -= kv->second.size;
+    m_stats.file_count--;
+    m_stats.evictions++;
+    m_entries.erase(kv);
+    m_lru.pop_back();
+  }
+}
+
+/*!
+ * Change the maximum number of bytes held.  A budget of 0 disables caching.
+ */
+void FileCache::set_budget(u64 budget) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.budget = budget;
+  evict_to(budget);
+}
+
+/*!
+ * Drop all cached files. Doesn't reset statistics.
+ */
+void FileCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.clear();
+  m_lru.clear();
+  m_stats.bytes_used = 0;
+  m_stats.file_count = 0;
+}
+
+FileCache::Stats FileCache::stats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+void FileCache::reset_stats() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.hits = 0;
+  m_stats.misses = 0;
+  m_stats.bytes_saved = 0;
+  m_stats.bytes_loaded = 0;
+  m_stats.evictions = 0;
+}
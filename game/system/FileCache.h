@@ -0,0 +1,66 @@
+#pragma once
+
+/*!
+ * @file FileCache.h
+ * Host-side cache of file contents, used by the kernel's FileLoad and the fake ISO file system.
+ * Files are keyed by path and validated against their modification time and size, so editing a
+ * file on disk is picked up on the next load.  The cache is bounded by a byte budget and evicts the
+ * least recently used files first.
+ */
+
+#ifndef JAK_FILECACHE_H
+#define JAK_FILECACHE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/common_types.h"
+
+class FileCache {
+ public:
+  static constexpr u64 DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+  struct Stats {
+    u64 hits = 0;          //! loads served from memory
+    u64 misses = 0;        //! loads that went to disk
+    u64 bytes_saved = 0;   //! bytes served from memory instead of disk
+    u64 bytes_loaded = 0;  //! bytes read from disk
+    u64 evictions = 0;     //! files dropped to stay under the budget
+    u64 bytes_used = 0;    //! bytes currently held
+    u64 file_count = 0;    //! files currently held
+    u64 budget = 0;        //! maximum bytes held
+  };
+
+  using Data = std::shared_ptr<const std::vector<u8>>;
+
+  explicit FileCache(u64 budget = DEFAULT_BUDGET);
+  Data get(const std::string& path);
+  Data get_if_cacheable(const std::string& path);
+  void set_budget(u64 budget);
+  void clear();
+  Stats stats();
+  void reset_stats();
+
+ private:
+  struct Entry {
+    Data data;
+    s64 mtime = 0;  // nanoseconds
+    u64 size = 0;
+    std::list<std::string>::iterator lru_it;
+  };
+
+  void drop_entry(std::unordered_map<std::string, Entry>::iterator kv);
+  void evict_to(u64 budget);
+
+  std::mutex m_mutex;
+  std::unordered_map<std::string, Entry> m_entries;
+  std::list<std::string> m_lru;  // most recently used at the front
+  Stats m_stats;
+};
+
+extern FileCache file_cache;
+
+#endif  // JAK_FILECACHE_H
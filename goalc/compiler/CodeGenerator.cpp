@@ -6,7 +6,8 @@ using namespace emitter;
 constexpr int GPR_SIZE = 8;
 constexpr int XMM_SIZE = 16;
 
-CodeGenerator::CodeGenerator(FileEnv* env) : m_fe(env) {}
+CodeGenerator::CodeGenerator(FileEnv* env, bool direct_encoding, bool merge_statics)
+    : m_gen(direct_encoding, merge_statics), m_fe(env) {}
 
 std::vector<u8> CodeGenerator::run() {
   for (auto& f : m_fe->functions()) {
@@ -25,6 +26,7 @@ std::vector<u8> CodeGenerator::run() {
   //    do_function(f.get());
   //  }
 
+  m_function_data_bytes = m_gen.function_data_bytes();
   return m_gen.generate_data_v3().to_vector();
 }
 
@@ -35,6 +37,13 @@ void CodeGenerator::do_function(FunctionEnv* env, int f_idx) {
   auto& ri = emitter::gRegInfo;
   const auto& allocs = env->alloc_result();
 
+  // a leaf function that fits in temp registers doesn't touch the stack, so the code below emits
+  // no prologue or epilogue for it.
+  if (env->is_leaf() && allocs.used_saved_regs.empty() && !allocs.stack_slots &&
+      !allocs.needs_aligned_stack_for_spills && !env->needs_aligned_stack()) {
+    m_leaf_functions++;
+  }
+
   // compute how much stack we will use
   int stack_offset = 0;
 
@@ -8,13 +8,18 @@
 
 class CodeGenerator {
  public:
-  CodeGenerator(FileEnv* env);
+  CodeGenerator(FileEnv* env, bool direct_encoding = true, bool merge_statics = true);
   std::vector<u8> run();
+  size_t function_data_bytes() const { return m_function_data_bytes; }
+  const emitter::StaticStats& static_stats() const { return m_gen.static_stats(); }
+  int leaf_functions() const { return m_leaf_functions; }
 
  private:
   void do_function(FunctionEnv* env, int f_idx);
   emitter::ObjectGenerator m_gen;
   FileEnv* m_fe;
+  size_t m_function_data_bytes = 0;  // held by m_gen for all functions, before layout
+  int m_leaf_functions = 0;          // functions generated without a prologue or epilogue
 };
 
 #endif  // JAK_CODEGENERATOR_H
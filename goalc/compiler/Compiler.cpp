@@ -95,6 +95,18 @@ FileEnv* Compiler::compile_object_file(const std::string& name,
     throw std::runtime_error("Compilation generated code, but wasn't supposed to");
   }
 
+  if (m_settings.print_const_eval_stats) {
+    auto& stats = file_env->const_eval_stats();
+    printf("C: %36s %5d forms folded, %7d IR eliminated\n", name.c_str(), stats.forms_folded,
+           stats.ir_eliminated);
+  }
+
+  if (m_settings.print_inline_stats) {
+    auto& stats = file_env->inline_stats();
+    printf("I: %36s %5d calls inlined, %7d IR added, %7d IR removed\n", name.c_str(),
+           stats.calls_inlined, stats.ir_added, stats.ir_removed);
+  }
+
   return file_env;
 }
 
@@ -153,6 +165,7 @@ void Compiler::color_object_file(FileEnv* env) {
     }
 
     input.max_vars = f->max_vars();
+    input.is_leaf = f->is_leaf();
     input.constraints = f->constraints();
 
     if (m_settings.debug_print_regalloc) {
@@ -167,8 +180,14 @@ void Compiler::color_object_file(FileEnv* env) {
 }
 
 std::vector<u8> Compiler::codegen_object_file(FileEnv* env) {
-  CodeGenerator gen(env);
-  return gen.run();
+  CodeGenerator gen(env, true, !m_settings.disable_static_dedup);
+  auto result = gen.run();
+  if (m_settings.print_static_stats) {
+    auto& stats = gen.static_stats();
+    printf("S: %36s %5d statics, %5d duplicates, %7d -> %7d bytes\n", env->name().c_str(),
+           stats.count, stats.deduplicated, stats.bytes_before, stats.bytes_after);
+  }
+  return result;
 }
 
 std::vector<std::string> Compiler::run_test(const std::string& source_code) {
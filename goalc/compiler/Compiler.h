@@ -12,13 +12,33 @@
 
 enum MathMode { MATH_INT, MATH_BINT, MATH_FLOAT, MATH_INVALID };
 
+/*!
+ * A number computed by the compile-time evaluator.
+ */
+struct ConstEvalValue {
+  MathMode mode = MATH_INVALID;
+  s64 integer = 0;
+  float fp = 0;
+  int ir_count = 0;  // IR instructions this would have taken to compute at runtime
+};
+
+/*!
+ * Arguments of an inline lambda being evaluated at compile time.
+ */
+struct ConstEvalScope {
+  std::unordered_map<std::string, ConstEvalValue> vars;
+  const ConstEvalScope* parent = nullptr;
+};
+
 class Compiler {
  public:
   Compiler();
   ~Compiler();
   void execute_repl();
   goos::Interpreter& get_goos() { return m_goos; }
+  const TypeSystem& get_type_system() const { return m_ts; }
   FileEnv* compile_object_file(const std::string& name, goos::Object code, bool allow_emit);
+  void color_object_file(FileEnv* env);
   std::unique_ptr<FunctionEnv> compile_top_level_function(const std::string& name,
                                                           const goos::Object& code,
                                                           Env* env);
@@ -36,6 +56,10 @@ class Compiler {
   void init_logger();
   void init_settings();
   bool try_getting_macro_from_goos(const goos::Object& macro_name, goos::Object* dest);
+  goos::Object expand_goos_macro(const goos::Object& o,
+                                 const goos::Object& macro_obj,
+                                 const goos::Object& rest,
+                                 Env* env);
   Val* compile_goos_macro(const goos::Object& o,
                           const goos::Object& macro_obj,
                           const goos::Object& rest,
@@ -50,8 +74,15 @@ class Compiler {
   Val* compile_string(const std::string& str, Env* env, int seg = MAIN_SEGMENT);
   Val* compile_get_symbol_value(const std::string& name, Env* env);
   Val* compile_function_or_method_call(const goos::Object& form, Env* env);
+  LambdaVal* get_auto_inline_lambda(const goos::Object& head, Env* env);
+  bool can_copy_function_ir(FunctionEnv* func);
+  FunctionEnv* get_ir_inline_function(const goos::Object& head, Env* env);
+  Val* compile_ir_inline_call(const goos::Object& form,
+                              FunctionEnv* callee,
+                              const TypeSpec& function_type,
+                              const std::vector<RegVal*>& args,
+                              Env* env);
   SymbolVal* compile_get_sym_obj(const std::string& name, Env* env);
-  void color_object_file(FileEnv* env);
   std::vector<u8> codegen_object_file(FileEnv* env);
 
   void for_each_in_list(const goos::Object& list,
@@ -93,6 +124,7 @@ class Compiler {
   std::unordered_map<std::string, TypeSpec> m_symbol_types;
   std::unordered_map<std::shared_ptr<goos::SymbolObject>, goos::Object> m_global_constants;
   std::unordered_map<std::shared_ptr<goos::SymbolObject>, LambdaVal*> m_inlineable_functions;
+  std::unordered_map<std::shared_ptr<goos::SymbolObject>, FunctionEnv*> m_ir_inline_functions;
   CompilerSettings m_settings;
   MathMode get_math_mode(const TypeSpec& ts);
   bool is_number(const TypeSpec& ts);
@@ -113,6 +145,27 @@ class Compiler {
                                      Env* env);
   RegVal* compile_get_method_of_object(RegVal* object, const std::string& method_name, Env* env);
 
+  // ConstantEval
+  Val* try_compile_constant(const goos::Object& form, Env* env);
+  bool const_eval(const goos::Object& form,
+                  Env* env,
+                  const ConstEvalScope* scope,
+                  ConstEvalValue* out);
+  bool const_eval_symbol(const goos::Object& form,
+                         Env* env,
+                         const ConstEvalScope* scope,
+                         ConstEvalValue* out);
+  bool const_eval_pair(const goos::Object& form,
+                       Env* env,
+                       const ConstEvalScope* scope,
+                       ConstEvalValue* out);
+  bool const_eval_lambda_call(const std::vector<std::string>& params,
+                              const goos::Object& body,
+                              const goos::Object& args,
+                              Env* env,
+                              const ConstEvalScope* scope,
+                              ConstEvalValue* out);
+
  public:
   // Atoms
 
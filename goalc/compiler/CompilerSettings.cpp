@@ -11,6 +11,13 @@ CompilerSettings::CompilerSettings() {
   m_settings["disable-math-const-prop"].boolp = &disable_math_const_prop;
 
   link(print_timing, "print-timing");
+  link(print_static_stats, "print-static-stats");
+  link(disable_static_dedup, "disable-static-dedup");
+  link(disable_const_eval, "disable-const-eval");
+  link(print_const_eval_stats, "print-const-eval-stats");
+  link(const_eval_inline_calls, "const-eval-inline-calls");
+  link(disable_auto_inline, "disable-auto-inline");
+  link(print_inline_stats, "print-inline-stats");
 }
 
 void CompilerSettings::set(const std::string& name, const goos::Object& value) {
@@ -15,6 +15,13 @@ class CompilerSettings {
   bool disable_math_const_prop = false;
   bool emit_move_after_return = true;
   bool print_timing = false;
+  bool print_static_stats = false;
+  bool disable_static_dedup = false;
+  bool disable_const_eval = false;
+  bool print_const_eval_stats = false;
+  bool const_eval_inline_calls = false;
+  bool disable_auto_inline = false;
+  bool print_inline_stats = false;
 
   void set(const std::string& name, const goos::Object& value);
 
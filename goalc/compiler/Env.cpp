@@ -229,6 +229,18 @@ void FunctionEnv::resolve_gotos() {
   }
 }
 
+/*!
+ * Does this function not call any other functions? Must be called after the function is compiled.
+ */
+bool FunctionEnv::is_leaf() const {
+  for (auto& ir : m_code) {
+    if (dynamic_cast<IR_FunctionCall*>(ir.get())) {
+      return false;
+    }
+  }
+  return true;
+}
+
 RegVal* FunctionEnv::make_ireg(TypeSpec ts, emitter::RegKind kind) {
   IRegister ireg;
   ireg.kind = kind;
@@ -12,6 +12,8 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include "common/type_system/TypeSpec.h"
 #include "goalc/regalloc/allocate.h"
 #include "common/goos/Object.h"
@@ -78,6 +80,23 @@ class NoEmitEnv : public Env {
   ~NoEmitEnv() = default;
 };
 
+/*!
+ * Forms folded by the compile-time evaluator in a file.
+ */
+struct ConstEvalStats {
+  int forms_folded = 0;
+  int ir_eliminated = 0;
+};
+
+/*!
+ * Calls to small functions replaced by a copy of the function's IR in a file.
+ */
+struct InlineStats {
+  int calls_inlined = 0;
+  int ir_added = 0;    // copied IR
+  int ir_removed = 0;  // IR the calls would have used
+};
+
 /*!
  * An Env for an entire file (or input to the REPL)
  */
@@ -92,6 +111,15 @@ class FileEnv : public Env {
   void debug_print_tl();
   const std::vector<std::unique_ptr<FunctionEnv>>& functions() { return m_functions; }
   const std::vector<std::unique_ptr<StaticObject>>& statics() { return m_statics; }
+  const std::string& name() { return m_name; }
+  ConstEvalStats& const_eval_stats() { return m_const_eval_stats; }
+  InlineStats& inline_stats() { return m_inline_stats; }
+  std::unordered_set<std::shared_ptr<goos::HeapObject>>& const_eval_failed() {
+    return m_const_eval_failed;
+  }
+  std::unordered_map<std::shared_ptr<goos::HeapObject>, goos::Object>& const_eval_expansions() {
+    return m_const_eval_expansions;
+  }
   const FunctionEnv& top_level_function() {
     assert(m_top_level_func);
     return *m_top_level_func;
@@ -105,6 +133,13 @@ class FileEnv : public Env {
   std::vector<std::unique_ptr<FunctionEnv>> m_functions;
   std::vector<std::unique_ptr<StaticObject>> m_statics;
   std::unique_ptr<NoEmitEnv> m_no_emit_env = nullptr;
+  ConstEvalStats m_const_eval_stats;
+  InlineStats m_inline_stats;
+
+  // forms the constant evaluator couldn't evaluate, and macros it expanded, so compiling them
+  // normally doesn't repeat the work.
+  std::unordered_set<std::shared_ptr<goos::HeapObject>> m_const_eval_failed;
+  std::unordered_map<std::shared_ptr<goos::HeapObject>, goos::Object> m_const_eval_expansions;
 
   // statics
   FunctionEnv* m_top_level_func = nullptr;
@@ -124,6 +159,7 @@ class DeclareEnv : public Env {
     bool inline_by_default = false;  // if a function, inline when possible?
     bool save_code = true;           // if a function, should we save the code?
     bool allow_inline = false;       // should we allow the user to use this an inline function
+    bool auto_inline = true;         // if a small function, may its code be copied into callers?
   } settings;
 };
 
@@ -161,6 +197,7 @@ class FunctionEnv : public DeclareEnv {
 
   bool needs_aligned_stack() const { return m_aligned_stack_required; }
   void require_aligned_stack() { m_aligned_stack_required = true; }
+  bool is_leaf() const;
 
   Label* alloc_unnamed_label() {
     m_unnamed_labels.emplace_back(std::make_unique<Label>());
@@ -851,4 +851,125 @@ void IR_IntToFloat::do_codegen(emitter::ObjectGenerator* gen,
                                emitter::IR_Record irec) {
   gen->add_instr(IGen::int32_to_float(get_reg(m_dest, allocs, irec), get_reg(m_src, allocs, irec)),
                  irec);
-}
\ No newline at end of file
+}
+///////////////////////
+// Cloning
+///////////////////////
+
+/*!
+ * Use the given register in place of src in the copy.
+ */
+void IRCloner::set_reg(const RegVal* src, RegVal* dest) {
+  m_regs[src->ireg().id] = dest;
+}
+
+/*!
+ * Get the register to use in place of src in the copy. Creates a new one if needed.
+ */
+RegVal* IRCloner::reg(const RegVal* src) {
+  if (!src) {
+    return nullptr;
+  }
+  auto kv = m_regs.find(src->ireg().id);
+  if (kv != m_regs.end()) {
+    return kv->second;
+  }
+  auto result = m_dest->make_ireg(src->type(), src->ireg().kind);
+  m_regs[src->ireg().id] = result;
+  return result;
+}
+
+/*!
+ * Get the register to use in place of src in the copy. It must have been used already.
+ */
+IRegister IRCloner::ireg(const IRegister& src) {
+  auto kv = m_regs.find(src.id);
+  assert(kv != m_regs.end());
+  return kv->second->ireg();
+}
+
+Label IRCloner::label(const Label& src) {
+  return Label(m_dest, src.idx + m_instr_offset);
+}
+
+const Label* IRCloner::label(const Label* src) {
+  auto result = m_dest->alloc_unnamed_label();
+  *result = label(*src);
+  return result;
+}
+
+std::unique_ptr<IR> IR_LoadConstant64::clone(IRCloner* cloner) {
+  return std::make_unique<IR_LoadConstant64>(cloner->reg(m_dest), m_value);
+}
+
+std::unique_ptr<IR> IR_LoadSymbolPointer::clone(IRCloner* cloner) {
+  return std::make_unique<IR_LoadSymbolPointer>(cloner->reg(m_dest), m_name);
+}
+
+std::unique_ptr<IR> IR_SetSymbolValue::clone(IRCloner* cloner) {
+  auto dest = cloner->dest()->alloc_val<SymbolVal>(m_dest->name(), m_dest->type());
+  return std::make_unique<IR_SetSymbolValue>(dest, cloner->reg(m_src));
+}
+
+std::unique_ptr<IR> IR_GetSymbolValue::clone(IRCloner* cloner) {
+  auto src = cloner->dest()->alloc_val<SymbolVal>(m_src->name(), m_src->type());
+  return std::make_unique<IR_GetSymbolValue>(cloner->reg(m_dest), src, m_sext);
+}
+
+std::unique_ptr<IR> IR_RegSet::clone(IRCloner* cloner) {
+  return std::make_unique<IR_RegSet>(cloner->reg(m_dest), cloner->reg(m_src));
+}
+
+std::unique_ptr<IR> IR_GotoLabel::clone(IRCloner* cloner) {
+  assert(m_resolved);
+  return std::make_unique<IR_GotoLabel>(cloner->label(m_dest));
+}
+
+std::unique_ptr<IR> IR_StaticVarAddr::clone(IRCloner* cloner) {
+  return std::make_unique<IR_StaticVarAddr>(cloner->reg(m_dest), m_src);
+}
+
+std::unique_ptr<IR> IR_StaticVarLoad::clone(IRCloner* cloner) {
+  return std::make_unique<IR_StaticVarLoad>(cloner->reg(m_dest), m_src);
+}
+
+std::unique_ptr<IR> IR_IntegerMath::clone(IRCloner* cloner) {
+  return std::make_unique<IR_IntegerMath>(m_kind, cloner->reg(m_dest), cloner->reg(m_arg));
+}
+
+std::unique_ptr<IR> IR_FloatMath::clone(IRCloner* cloner) {
+  return std::make_unique<IR_FloatMath>(m_kind, cloner->reg(m_dest), cloner->reg(m_arg));
+}
+
+std::unique_ptr<IR> IR_ConditionalBranch::clone(IRCloner* cloner) {
+  assert(m_resolved);
+  Condition new_condition = condition;
+  new_condition.a = cloner->reg(condition.a);
+  new_condition.b = cloner->reg(condition.b);
+  auto result = std::make_unique<IR_ConditionalBranch>(new_condition, cloner->label(label));
+  result->mark_as_resolved();
+  return result;
+}
+
+std::unique_ptr<IR> IR_LoadConstOffset::clone(IRCloner* cloner) {
+  return std::make_unique<IR_LoadConstOffset>(cloner->reg(m_dest), m_offset, cloner->reg(m_base),
+                                              m_info);
+}
+
+std::unique_ptr<IR> IR_StoreConstOffset::clone(IRCloner* cloner) {
+  return std::make_unique<IR_StoreConstOffset>(cloner->reg(m_value), m_offset,
+                                               cloner->reg(m_base), m_size);
+}
+
+std::unique_ptr<IR> IR_Null::clone(IRCloner* cloner) {
+  (void)cloner;
+  return std::make_unique<IR_Null>();
+}
+
+std::unique_ptr<IR> IR_FloatToInt::clone(IRCloner* cloner) {
+  return std::make_unique<IR_FloatToInt>(cloner->reg(m_dest), cloner->reg(m_src));
+}
+
+std::unique_ptr<IR> IR_IntToFloat::clone(IRCloner* cloner) {
+  return std::make_unique<IR_IntToFloat>(cloner->reg(m_dest), cloner->reg(m_src));
+}
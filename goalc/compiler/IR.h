@@ -4,11 +4,32 @@
 #define JAK_IR_H
 
 #include <string>
+#include <unordered_map>
 #include "CodeGenerator.h"
 #include "goalc/regalloc/allocate.h"
 #include "Val.h"
 #include "goalc/emitter/ObjectGenerator.h"
 
+/*!
+ * Used to copy the IR of a function into another function. Each register of the original function
+ * gets a new register, and labels are moved to where the copy is placed.
+ */
+class IRCloner {
+ public:
+  IRCloner(FunctionEnv* dest, int instr_offset) : m_dest(dest), m_instr_offset(instr_offset) {}
+  FunctionEnv* dest() { return m_dest; }
+  void set_reg(const RegVal* src, RegVal* dest);
+  RegVal* reg(const RegVal* src);
+  IRegister ireg(const IRegister& src);
+  Label label(const Label& src);
+  const Label* label(const Label* src);
+
+ private:
+  FunctionEnv* m_dest = nullptr;
+  int m_instr_offset = 0;
+  std::unordered_map<int, RegVal*> m_regs;
+};
+
 class IR {
  public:
   virtual std::string print() = 0;
@@ -20,6 +41,11 @@ class IR {
     (void)constraints;
     (void)my_id;
   }
+  // copy this instruction for inlining. Returns nullptr if this instruction can't be copied.
+  virtual std::unique_ptr<IR> clone(IRCloner* cloner) {
+    (void)cloner;
+    return nullptr;
+  }
 };
 
 // class IR_Set : public IR {
@@ -38,6 +64,7 @@ class IR_Return : public IR {
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
   const RegVal* value() { return m_value; }
+  const RegVal* return_reg() { return m_return_reg; }
 
  protected:
   const RegVal* m_return_reg = nullptr;
@@ -52,6 +79,7 @@ class IR_LoadConstant64 : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -66,6 +94,7 @@ class IR_LoadSymbolPointer : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -80,6 +109,7 @@ class IR_SetSymbolValue : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  protected:
   const SymbolVal* m_dest = nullptr;
@@ -94,6 +124,7 @@ class IR_GetSymbolValue : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -109,6 +140,7 @@ class IR_RegSet : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -125,6 +157,7 @@ class IR_GotoLabel : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  protected:
   const Label* m_dest = nullptr;
@@ -155,6 +188,7 @@ class IR_StaticVarAddr : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -169,6 +203,7 @@ class IR_StaticVarLoad : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  protected:
   const RegVal* m_dest = nullptr;
@@ -215,6 +250,7 @@ class IR_IntegerMath : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
   IntegerMathKind get_kind() const { return m_kind; }
 
  protected:
@@ -233,6 +269,7 @@ class IR_FloatMath : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
   FloatMathKind get_kind() const { return m_kind; }
 
  protected:
@@ -261,6 +298,7 @@ class IR_ConditionalBranch : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
   void mark_as_resolved() { m_resolved = true; }
 
   Condition condition;
@@ -278,6 +316,7 @@ class IR_LoadConstOffset : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  private:
   const RegVal* m_dest = nullptr;
@@ -294,6 +333,7 @@ class IR_StoreConstOffset : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  private:
   const RegVal* m_value = nullptr;
@@ -310,6 +350,7 @@ class IR_Null : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 };
 
 class IR_FunctionStart : public IR {
@@ -320,6 +361,7 @@ class IR_FunctionStart : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  const std::vector<RegVal*>& args() { return m_args; }
 
  private:
   std::vector<RegVal*> m_args;
@@ -333,6 +375,7 @@ class IR_FloatToInt : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  private:
   const RegVal* m_dest = nullptr;
@@ -347,6 +390,7 @@ class IR_IntToFloat : public IR {
   void do_codegen(emitter::ObjectGenerator* gen,
                   const AllocationResult& allocs,
                   emitter::IR_Record irec) override;
+  std::unique_ptr<IR> clone(IRCloner* cloner) override;
 
  private:
   const RegVal* m_dest = nullptr;
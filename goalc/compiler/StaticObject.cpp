@@ -69,7 +69,7 @@ StaticObject::LoadInfo StaticFloat::get_load_info() const {
 }
 
 void StaticFloat::generate(emitter::ObjectGenerator* gen) {
-  rec = gen->add_static_to_seg(seg, 4);
+  rec = gen->add_static_to_seg(seg, 4, true);
   auto& d = gen->get_static_data(rec);
   push_data_to_byte_vector<float>(value, d);
 }
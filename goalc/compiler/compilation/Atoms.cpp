@@ -146,6 +146,12 @@ Val* Compiler::compile_pair(const goos::Object& code, Env* env) {
   auto head = pair->car;
   auto rest = pair->cdr;
 
+  // math on constants and inline functions with constant arguments can be done now.
+  auto constant = try_compile_constant(code, env);
+  if (constant) {
+    return constant;
+  }
+
   if (head.is_symbol()) {
     auto head_sym = head.as_symbol();
     // first try as a goal compiler form
@@ -0,0 +1,489 @@
+/*!
+ * @file ConstantEval.cpp
+ * Compile-time evaluation of side-effect free math on constants.
+ *
+ * Forms like (+ 1 (* 2 SOME-CONSTANT)), or lets with constant values are evaluated by the compiler
+ * and replaced with a single constant. With the const-eval-inline-calls setting, so are calls to
+ * inline functions with constant arguments. The evaluator follows the same lookup rules as the real
+ * compiler, and the same 32/64-bit integer and single precision float semantics as the generated
+ * code. Anything it doesn't understand (or that might fail at runtime, like dividing by zero) is
+ * left alone and compiled normally.
+ */
+
+#include "goalc/compiler/Compiler.h"
+
+namespace {
+enum class ConstOp { ADD, SUB, MUL, DIV, MOD, SHLV, SHRV, SARV, LOGAND, LOGIOR, LOGXOR, LOGNOT };
+
+const std::unordered_map<std::string, ConstOp> const_ops = {
+    {"+", ConstOp::ADD},        {"-", ConstOp::SUB},           {"*", ConstOp::MUL},
+    {"/", ConstOp::DIV},        {"mod", ConstOp::MOD},         {"shlv", ConstOp::SHLV},
+    {"shrv", ConstOp::SHRV},    {"sarv", ConstOp::SARV},       {"logand", ConstOp::LOGAND},
+    {"logior", ConstOp::LOGIOR}, {"logxor", ConstOp::LOGXOR}, {"lognot", ConstOp::LOGNOT}};
+
+/*!
+ * Evaluate a math operation on constants. The IR count is the number of IR instructions the
+ * matching compile_xxx function in Math.cpp would emit, in addition to those of the arguments.
+ */
+bool eval_op(ConstOp op, const std::vector<ConstEvalValue>& args, ConstEvalValue* out) {
+  if (args.empty()) {
+    return false;
+  }
+
+  auto mode = args.front().mode;
+  int ir_count = 0;
+  for (auto& arg : args) {
+    // don't bother with implicit conversions.
+    if (arg.mode != mode) {
+      return false;
+    }
+    ir_count += arg.ir_count;
+  }
+
+  if (mode != MATH_INT && mode != MATH_FLOAT) {
+    return false;
+  }
+
+  switch (op) {
+    case ConstOp::ADD:
+    case ConstOp::SUB:
+    case ConstOp::MUL:
+      break;
+    case ConstOp::LOGNOT:
+      if (args.size() != 1 || mode != MATH_INT) {
+        return false;
+      }
+      break;
+    case ConstOp::DIV:
+      if (args.size() != 2) {
+        return false;
+      }
+      break;
+    default:
+      if (args.size() != 2 || mode != MATH_INT) {
+        return false;
+      }
+      break;
+  }
+
+  // a set of the result register, then one op per remaining argument.
+  ir_count += int(args.size());
+  if (op == ConstOp::LOGNOT || (op == ConstOp::SUB && args.size() == 1)) {
+    ir_count++;  // lognot is a set and a not, negation is a load of 0 and a subtract.
+  } else if (op == ConstOp::SHLV || op == ConstOp::SHRV || op == ConstOp::SARV) {
+    ir_count++;  // set of the shift amount to rcx.
+  }
+
+  out->mode = mode;
+  out->ir_count = ir_count;
+  if (mode == MATH_FLOAT) {
+    float result = args.front().fp;
+    switch (op) {
+      case ConstOp::ADD:
+        for (size_t i = 1; i < args.size(); i++) {
+          result += args.at(i).fp;
+        }
+        break;
+      case ConstOp::SUB:
+        if (args.size() == 1) {
+          result = 0.f - result;
+        }
+        for (size_t i = 1; i < args.size(); i++) {
+          result -= args.at(i).fp;
+        }
+        break;
+      case ConstOp::MUL:
+        for (size_t i = 1; i < args.size(); i++) {
+          result *= args.at(i).fp;
+        }
+        break;
+      case ConstOp::DIV:
+        result /= args.at(1).fp;
+        break;
+      default:
+        return false;
+    }
+    out->fp = result;
+    return true;
+  }
+
+  u64 result = args.front().integer;
+  switch (op) {
+    case ConstOp::ADD:
+      for (size_t i = 1; i < args.size(); i++) {
+        result += args.at(i).integer;
+      }
+      break;
+    case ConstOp::SUB:
+      if (args.size() == 1) {
+        result = 0 - result;
+      }
+      for (size_t i = 1; i < args.size(); i++) {
+        result -= args.at(i).integer;
+      }
+      break;
+    case ConstOp::MUL:
+      // imul 32, then sign extend
+      for (size_t i = 1; i < args.size(); i++) {
+        result = s64(s32(u32(result) * u32(args.at(i).integer)));
+      }
+      break;
+    case ConstOp::DIV:
+    case ConstOp::MOD: {
+      // idiv 32 of eax, then sign extend the quotient or remainder.
+      s32 num = s32(result);
+      s32 den = s32(args.at(1).integer);
+      if (den == 0 || (num == INT32_MIN && den == -1)) {
+        // leave it to the runtime to deal with this.
+        return false;
+      }
+      result = s64(op == ConstOp::DIV ? num / den : num % den);
+    } break;
+    case ConstOp::SHLV:
+      result = result << (args.at(1).integer & 63);
+      break;
+    case ConstOp::SHRV:
+      result = result >> (args.at(1).integer & 63);
+      break;
+    case ConstOp::SARV:
+      result = s64(result) >> (args.at(1).integer & 63);
+      break;
+    case ConstOp::LOGAND:
+      result &= args.at(1).integer;
+      break;
+    case ConstOp::LOGIOR:
+      result |= args.at(1).integer;
+      break;
+    case ConstOp::LOGXOR:
+      result ^= args.at(1).integer;
+      break;
+    case ConstOp::LOGNOT:
+      result = ~result;
+      break;
+    default:
+      assert(false);
+  }
+  out->integer = s64(result);
+  return true;
+}
+
+/*!
+ * Is this a (lambda :inline-only #t (args...) body...) form? If so, get the argument names and
+ * body.
+ */
+bool get_inline_only_lambda(const goos::Object& form,
+                            std::vector<std::string>* params,
+                            goos::Object* body) {
+  bool inline_only = false;
+  const goos::Object* iter = &form.as_pair()->cdr;
+  while (iter->is_pair() && iter->as_pair()->car.is_symbol() &&
+         iter->as_pair()->car.as_symbol()->name.at(0) == ':') {
+    auto& key = iter->as_pair()->car.as_symbol()->name;
+    iter = &iter->as_pair()->cdr;
+    if (!iter->is_pair()) {
+      return false;
+    }
+    auto& value = iter->as_pair()->car;
+    if (key == ":inline-only") {
+      inline_only = !(value.is_symbol() && value.as_symbol()->name == "#f");
+    }
+    iter = &iter->as_pair()->cdr;
+  }
+
+  if (!inline_only || !iter->is_pair()) {
+    return false;
+  }
+
+  const goos::Object* param = &iter->as_pair()->car;
+  while (param->is_pair()) {
+    auto& p = param->as_pair()->car;
+    if (p.is_symbol()) {
+      params->push_back(p.as_symbol()->name);
+    } else if (p.is_pair() && p.as_pair()->car.is_symbol()) {
+      params->push_back(p.as_pair()->car.as_symbol()->name);
+    } else {
+      return false;
+    }
+    param = &param->as_pair()->cdr;
+  }
+  if (!param->is_empty_list()) {
+    return false;
+  }
+
+  *body = iter->as_pair()->cdr;
+  return true;
+}
+}  // namespace
+
+/*!
+ * Try to evaluate a form at compile time. If this works, returns a constant, otherwise returns
+ * nullptr and the form should be compiled normally.
+ */
+Val* Compiler::try_compile_constant(const goos::Object& form, Env* env) {
+  if (m_settings.disable_const_eval) {
+    return nullptr;
+  }
+
+  // only try forms which could possibly be folded. A macro is tried once it is expanded.
+  auto& head = form.as_pair()->car;
+  if (head.is_symbol()) {
+    if (const_ops.find(head.as_symbol()->name) == const_ops.end() &&
+        (!m_settings.const_eval_inline_calls || !get_auto_inline_lambda(head, env))) {
+      return nullptr;
+    }
+  } else if (head.is_pair() && head.as_pair()->car.is_symbol()) {
+    auto& name = head.as_pair()->car.as_symbol()->name;
+    if ((name != "inline" || !m_settings.const_eval_inline_calls) && name != "lambda") {
+      return nullptr;
+    }
+  } else {
+    return nullptr;
+  }
+
+  ConstEvalValue value;
+  if (!const_eval(form, env, nullptr, &value)) {
+    return nullptr;
+  }
+
+  auto fie = get_parent_env_of_type<FileEnv>(env);
+  auto& stats = fie->const_eval_stats();
+  stats.forms_folded++;
+  // we still need to load the constant.
+  stats.ir_eliminated += value.ir_count - 1;
+
+  if (value.mode == MATH_FLOAT) {
+    return compile_float(value.fp, env, get_parent_env_of_type<FunctionEnv>(env)->segment);
+  }
+  return compile_integer(value.integer, env);
+}
+
+/*!
+ * Evaluate a form at compile time. Returns false if it can't be done.
+ */
+bool Compiler::const_eval(const goos::Object& form,
+                          Env* env,
+                          const ConstEvalScope* scope,
+                          ConstEvalValue* out) {
+  switch (form.type) {
+    case goos::ObjectType::INTEGER:
+      out->mode = MATH_INT;
+      out->integer = form.integer_obj.value;
+      out->ir_count = 1;
+      return true;
+    case goos::ObjectType::FLOAT:
+      out->mode = MATH_FLOAT;
+      out->fp = form.float_obj.value;
+      out->ir_count = 1;
+      return true;
+    case goos::ObjectType::SYMBOL:
+      return const_eval_symbol(form, env, scope, out);
+    case goos::ObjectType::PAIR: {
+      if (scope) {
+        // in the body of an inline function, the result depends on the arguments.
+        return const_eval_pair(form, env, scope, out);
+      }
+      // otherwise, remember forms that failed. The normal compile tries each of their nested forms
+      // again, which would be quadratic in the nesting depth.
+      auto& failed = get_parent_env_of_type<FileEnv>(env)->const_eval_failed();
+      if (failed.find(form.heap_obj) != failed.end()) {
+        return false;
+      }
+      if (const_eval_pair(form, env, scope, out)) {
+        return true;
+      }
+      failed.insert(form.heap_obj);
+      return false;
+    }
+    default:
+      return false;
+  }
+}
+
+/*!
+ * Evaluate a symbol at compile time. Uses the same lookup order as compile_symbol.
+ */
+bool Compiler::const_eval_symbol(const goos::Object& form,
+                                 Env* env,
+                                 const ConstEvalScope* scope,
+                                 ConstEvalValue* out) {
+  auto mlet_env = get_parent_env_of_type<SymbolMacroEnv>(env);
+  while (mlet_env) {
+    auto mlkv = mlet_env->macros.find(form.as_symbol());
+    if (mlkv != mlet_env->macros.end()) {
+      return const_eval(mlkv->second, env, scope, out);
+    }
+    mlet_env = get_parent_env_of_type<SymbolMacroEnv>(mlet_env->parent());
+  }
+
+  // arguments of an inline function we're evaluating. These are already in registers.
+  for (auto s = scope; s; s = s->parent) {
+    auto kv = s->vars.find(form.as_symbol()->name);
+    if (kv != s->vars.end()) {
+      *out = kv->second;
+      out->ir_count = 0;
+      return true;
+    }
+  }
+
+  // a real variable, can't know this.
+  if (env->lexical_lookup(form)) {
+    return false;
+  }
+
+  auto global_constant = m_global_constants.find(form.as_symbol());
+  if (global_constant != m_global_constants.end() &&
+      m_symbol_types.find(form.as_symbol()->name) == m_symbol_types.end()) {
+    return const_eval(global_constant->second, env, scope, out);
+  }
+
+  return false;
+}
+
+/*!
+ * Evaluate a list at compile time. This can be a math form, a macro, an inlined function, or an
+ * inline-only lambda (like a let).
+ */
+bool Compiler::const_eval_pair(const goos::Object& form,
+                               Env* env,
+                               const ConstEvalScope* scope,
+                               ConstEvalValue* out) {
+  auto& head = form.as_pair()->car;
+  auto& rest = form.as_pair()->cdr;
+
+  if (head.is_symbol()) {
+    // math
+    auto op = const_ops.find(head.as_symbol()->name);
+    if (op != const_ops.end()) {
+      std::vector<ConstEvalValue> args;
+      const goos::Object* iter = &rest;
+      while (iter->is_pair()) {
+        args.emplace_back();
+        if (!const_eval(iter->as_pair()->car, env, scope, &args.back())) {
+          return false;
+        }
+        iter = &iter->as_pair()->cdr;
+      }
+      return iter->is_empty_list() && eval_op(op->second, args, out);
+    }
+
+    // macro
+    goos::Object macro_obj;
+    if (try_getting_macro_from_goos(head, &macro_obj)) {
+      goos::Object expanded;
+      try {
+        expanded = expand_goos_macro(form, macro_obj, rest, env);
+      } catch (std::runtime_error& e) {
+        // let the normal compiler report this.
+        return false;
+      }
+      if (!scope) {
+        // if this can't be folded, the normal compile will use this instead of expanding again.
+        get_parent_env_of_type<FileEnv>(env)->const_eval_expansions()[form.heap_obj] = expanded;
+      }
+      return const_eval(expanded, env, scope, out);
+    }
+
+    // function, only if it would be inlined.
+    auto lambda = m_settings.const_eval_inline_calls ? get_auto_inline_lambda(head, env) : nullptr;
+    if (lambda) {
+      std::vector<std::string> params;
+      for (auto& p : lambda->lambda.params) {
+        params.push_back(p.name);
+      }
+      return const_eval_lambda_call(params, lambda->lambda.body, rest, env, scope, out);
+    }
+    return false;
+  }
+
+  if (head.is_pair() && head.as_pair()->car.is_symbol()) {
+    auto& head_name = head.as_pair()->car.as_symbol()->name;
+    std::vector<std::string> params;
+    goos::Object body;
+
+    if (head_name == "inline" && m_settings.const_eval_inline_calls) {
+      // (inline my-func)
+      auto& inline_rest = head.as_pair()->cdr;
+      if (!inline_rest.is_pair() || !inline_rest.as_pair()->car.is_symbol() ||
+          !inline_rest.as_pair()->cdr.is_empty_list()) {
+        return false;
+      }
+      auto kv = m_inlineable_functions.find(inline_rest.as_pair()->car.as_symbol());
+      if (kv == m_inlineable_functions.end() ||
+          (kv->second->func && !kv->second->func->settings.allow_inline)) {
+        return false;
+      }
+      for (auto& p : kv->second->lambda.params) {
+        params.push_back(p.name);
+      }
+      return const_eval_lambda_call(params, kv->second->lambda.body, rest, env, scope, out);
+    }
+
+    if (head_name == "lambda" && get_inline_only_lambda(head, &params, &body)) {
+      return const_eval_lambda_call(params, body, rest, env, scope, out);
+    }
+  }
+
+  return false;
+}
+
+/*!
+ * Evaluate a call to an inlined function (or let) at compile time. All the arguments and every
+ * form in the body must be constant.
+ */
+bool Compiler::const_eval_lambda_call(const std::vector<std::string>& params,
+                                      const goos::Object& body,
+                                      const goos::Object& args,
+                                      Env* env,
+                                      const ConstEvalScope* scope,
+                                      ConstEvalValue* out) {
+  ConstEvalScope call_scope;
+  call_scope.parent = scope;
+  int ir_count = 0;
+
+  size_t arg_idx = 0;
+  const goos::Object* iter = &args;
+  while (iter->is_pair()) {
+    if (arg_idx >= params.size()) {
+      return false;
+    }
+    ConstEvalValue arg;
+    if (!const_eval(iter->as_pair()->car, env, scope, &arg)) {
+      return false;
+    }
+    // the argument, then a copy into the argument variable.
+    ir_count += arg.ir_count + 1;
+    call_scope.vars[params.at(arg_idx)] = arg;
+    arg_idx++;
+    iter = &iter->as_pair()->cdr;
+  }
+  if (!iter->is_empty_list() || arg_idx != params.size()) {
+    return false;
+  }
+
+  bool got_result = false;
+  ConstEvalValue result;
+  iter = &body;
+  if (iter->is_pair()) {
+    // skip the function's (declare ...), it only matters to the real function.
+    auto& first = iter->as_pair()->car;
+    if (first.is_pair() && first.as_pair()->car.is_symbol() &&
+        first.as_pair()->car.as_symbol()->name == "declare") {
+      iter = &iter->as_pair()->cdr;
+    }
+  }
+  while (iter->is_pair()) {
+    if (!const_eval(iter->as_pair()->car, env, &call_scope, &result)) {
+      return false;
+    }
+    ir_count += result.ir_count;
+    got_result = true;
+    iter = &iter->as_pair()->cdr;
+  }
+  if (!got_result || !iter->is_empty_list()) {
+    return false;
+  }
+
+  *out = result;
+  out->ir_count = ir_count;
+  return true;
+}
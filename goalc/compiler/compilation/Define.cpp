@@ -38,6 +38,13 @@ Val* Compiler::compile_define(const goos::Object& form, const goos::Object& rest
     }
   }
 
+  // small functions may have their code copied into callers. Forget about the old definition.
+  if (as_lambda && as_lambda->func && can_copy_function_ir(as_lambda->func)) {
+    m_ir_inline_functions[sym.as_symbol()] = as_lambda->func;
+  } else {
+    m_ir_inline_functions.erase(sym.as_symbol());
+  }
+
   auto in_gpr = compiled_val->to_gpr(fe);
   auto existing_type = m_symbol_types.find(sym.as_symbol()->name);
   if (existing_type == m_symbol_types.end()) {
@@ -107,6 +114,8 @@ Val* Compiler::compile_set(const goos::Object& form, const goos::Object& rest, E
             form, "could not find something called " + symbol_string(destination) + " to set!");
       } else {
         typecheck(form, existing->second, source->type(), "set! global symbol");
+        // it might not be the function we know about anymore.
+        m_ir_inline_functions.erase(destination.as_symbol());
         auto fe = get_parent_env_of_type<FunctionEnv>(env);
         auto sym_val =
             fe->alloc_val<SymbolVal>(symbol_string(destination), m_ts.make_typespec("symbol"));
@@ -202,6 +202,34 @@ Val* Compiler::compile_lambda(const goos::Object& form, const goos::Object& rest
   return place;
 }
 
+/*!
+ * If a call with the given head should be automatically inlined, get the lambda to inline.
+ * Otherwise returns nullptr.
+ */
+LambdaVal* Compiler::get_auto_inline_lambda(const goos::Object& head, Env* env) {
+  if (!head.is_symbol()) {
+    // we can only auto-inline the function if its name is explicitly given.
+    return nullptr;
+  }
+
+  // look it up:
+  auto kv = m_inlineable_functions.find(head.as_symbol());
+  if (kv == m_inlineable_functions.end()) {
+    return nullptr;
+  }
+
+  // it's inlinable.  However, we do not always inline an inlinable function by default
+  if (kv->second->func ==
+          nullptr ||  // only-inline, we must inline it as there is no code generated for it
+      kv->second->func->settings
+          .inline_by_default ||  // inline when possible, so we should inline
+      (kv->second->func->settings.allow_inline &&
+       get_inline_preference(env))) {  // inline is allowed, and we prefer it locally
+    return kv->second;
+  }
+  return nullptr;
+}
+
 /*!
  * Compile a form which should be either a function call (possibly inline) or method call.
  * Note - calling method "new" isn't handled by this.
@@ -218,25 +246,14 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
   // determine if this call should be automatically inlined.
   // this logic will not trigger for a manually inlined call [using the (inline func) form]
   bool auto_inline = false;
-  if (uneval_head.is_symbol()) {
-    // we can only auto-inline the function if its name is explicitly given.
-    // look it up:
-    auto kv = m_inlineable_functions.find(uneval_head.as_symbol());
-    if (kv != m_inlineable_functions.end()) {
-      // it's inlinable.  However, we do not always inline an inlinable function by default
-      if (kv->second->func ==
-              nullptr ||  // only-inline, we must inline it as there is no code generated for it
-          kv->second->func->settings
-              .inline_by_default ||  // inline when possible, so we should inline
-          (kv->second->func->settings.allow_inline &&
-           get_inline_preference(env))) {  // inline is allowed, and we prefer it locally
-        auto_inline = true;
-        head = kv->second;
-      }
-    }
+  auto auto_inline_lambda = get_auto_inline_lambda(uneval_head, env);
+  if (auto_inline_lambda) {
+    auto_inline = true;
+    head = auto_inline_lambda;
   }
 
   bool is_method_call = false;
+  FunctionEnv* ir_inline_func = nullptr;
   if (!auto_inline) {
     // if auto-inlining failed, we must get the thing to call in a different way.
     if (uneval_head.is_symbol()) {
@@ -244,7 +261,11 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
           m_symbol_types.find(symbol_string(uneval_head)) != m_symbol_types.end()) {
         // the local environment (mlets, lexicals, constants, globals) defines this symbol.
         // this will "win" over a method name lookup, so we should compile as normal
-        head = compile_error_guard(args.unnamed.front(), env);
+        // unless it's a small global function that we can copy the code of.
+        ir_inline_func = get_ir_inline_function(uneval_head, env);
+        if (!ir_inline_func) {
+          head = compile_error_guard(args.unnamed.front(), env);
+        }
       } else {
         // we don't think compiling the head give us a function, so it's either a method or an error
         is_method_call = true;
@@ -256,7 +277,7 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
     }
   }
 
-  if (!is_method_call) {
+  if (!is_method_call && !ir_inline_func) {
     // typecheck that we got a function
     typecheck(form, m_ts.make_typespec("function"), head->type(), "Function call head");
   }
@@ -271,7 +292,7 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
   // passed use explicitly a lambda either with the lambda form, or with the (inline ...) form.
   LambdaVal* head_as_lambda = nullptr;
   bool got_inlined_lambda = false;
-  if (!is_method_call) {
+  if (!is_method_call && !ir_inline_func) {
     // try directly as a lambda
     head_as_lambda = dynamic_cast<LambdaVal*>(head);
 
@@ -288,7 +309,7 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
 
   // no lambda (not inlining or immediate), and not a method call, so we should actually get
   // the function pointer.
-  if (!head_as_lambda && !is_method_call) {
+  if (!head_as_lambda && !is_method_call && !ir_inline_func) {
     head = head->to_gpr(env);
   }
 
@@ -300,6 +321,12 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
     eval_args.push_back(intermediate->to_reg(env));
   }
 
+  if (ir_inline_func) {
+    // copy the code of the function.
+    return compile_ir_inline_call(form, ir_inline_func,
+                                  m_symbol_types.at(symbol_string(uneval_head)), eval_args, env);
+  }
+
   if (head_as_lambda) {
     // inline/immediate the function!
 
@@ -396,6 +423,159 @@ Val* Compiler::compile_function_or_method_call(const goos::Object& form, Env* en
   return get_none();
 }
 
+namespace {
+// the most IR a function body can have and still get copied into callers automatically.
+constexpr int MAX_IR_INLINE_SIZE = 10;
+
+/*!
+ * Does this function use statics? These can only be reached from the same segment.
+ */
+bool uses_statics(FunctionEnv* func) {
+  for (auto& ir : func->code()) {
+    if (dynamic_cast<IR_StaticVarAddr*>(ir.get()) || dynamic_cast<IR_StaticVarLoad*>(ir.get())) {
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+/*!
+ * Can the code of this function be copied into callers instead of calling it?
+ * It must be small, not call other functions (so it never needs the stack), only use IR that can be
+ * cloned, and not be declared with (declare (no-inline)) or (declare (allow-inline)).
+ */
+bool Compiler::can_copy_function_ir(FunctionEnv* func) {
+  if (!func->settings.auto_inline || func->is_asm_func || func->needs_aligned_stack()) {
+    return false;
+  }
+
+  // function start, body, return, null.
+  auto& code = func->code();
+  if (code.size() < 3 || code.size() > MAX_IR_INLINE_SIZE + 3) {
+    return false;
+  }
+  if (!dynamic_cast<IR_FunctionStart*>(code.front().get()) ||
+      !dynamic_cast<IR_Null*>(code.back().get())) {
+    return false;
+  }
+
+  // try cloning the body into a scratch function, any IR that doesn't support clone() rules it out.
+  FunctionEnv scratch(func->parent(), "ir-inline-check");
+  IRCloner cloner(&scratch, 0);
+  int return_count = 0;
+  for (size_t i = 1; i < code.size(); i++) {
+    auto ir = code.at(i).get();
+    if (dynamic_cast<IR_Return*>(ir)) {
+      return_count++;
+    } else if (dynamic_cast<IR_FunctionCall*>(ir) || dynamic_cast<IR_FunctionAddr*>(ir) ||
+               dynamic_cast<IR_FunctionStart*>(ir) || !ir->clone(&cloner)) {
+      return false;
+    }
+  }
+  return return_count == 1;
+}
+
+/*!
+ * If a call to the global function named by head can be replaced with a copy of its code, get the
+ * function. Otherwise nullptr.
+ * Only callers in the same file as the function get a copy. Code in other files always calls the
+ * function through its symbol, so redefining it later still reaches them.
+ */
+FunctionEnv* Compiler::get_ir_inline_function(const goos::Object& head, Env* env) {
+  if (m_settings.disable_auto_inline || !head.is_symbol() || is_local_symbol(head, env)) {
+    return nullptr;
+  }
+
+  auto kv = m_ir_inline_functions.find(head.as_symbol());
+  if (kv == m_ir_inline_functions.end()) {
+    return nullptr;
+  }
+
+  auto callee = kv->second;
+  auto fe = get_parent_env_of_type<FunctionEnv>(env);
+  if (get_parent_env_of_type<FileEnv>(callee) != get_parent_env_of_type<FileEnv>(fe) ||
+      (uses_statics(callee) && callee->segment != fe->segment)) {
+    return nullptr;
+  }
+  return callee;
+}
+
+/*!
+ * Instead of calling a function, copy its IR. The arguments and registers of the function get new
+ * registers in the caller.
+ */
+Val* Compiler::compile_ir_inline_call(const goos::Object& form,
+                                      FunctionEnv* callee,
+                                      const TypeSpec& function_type,
+                                      const std::vector<RegVal*>& args,
+                                      Env* env) {
+  auto fe = get_parent_env_of_type<FunctionEnv>(env);
+
+  // same checks as a real function call
+  if (function_type.arg_count() - 1 != args.size()) {
+    throw_compile_error(form, "invalid number of arguments to function call: got " +
+                                  std::to_string(args.size()) + " and expected " +
+                                  std::to_string(function_type.arg_count() - 1) + " for " +
+                                  function_type.print());
+  }
+  for (uint32_t i = 0; i < args.size(); i++) {
+    typecheck(form, function_type.get_arg(i), args.at(i)->type(), "function argument");
+  }
+
+  auto& code = callee->code();
+  auto start = dynamic_cast<IR_FunctionStart*>(code.front().get());
+  assert(start && start->args().size() == args.size());
+
+  // copy args, the function is allowed to modify them.
+  std::vector<RegVal*> arg_copies;
+  for (uint32_t i = 0; i < args.size(); i++) {
+    arg_copies.push_back(env->make_ireg(start->args().at(i)->type(), emitter::RegKind::GPR));
+    env->emit(std::make_unique<IR_RegSet>(arg_copies.back(), args.at(i)));
+  }
+
+  // the function start isn't copied, so everything moves back one.
+  int instr_offset = int(fe->code().size()) - 1;
+  IRCloner cloner(fe, instr_offset);
+  for (uint32_t i = 0; i < args.size(); i++) {
+    cloner.set_reg(start->args().at(i), arg_copies.at(i));
+  }
+
+  RegVal* return_reg = nullptr;
+  for (size_t i = 1; i < code.size(); i++) {
+    auto as_return = dynamic_cast<IR_Return*>(code.at(i).get());
+    if (as_return) {
+      return_reg = cloner.reg(as_return->return_reg());
+      env->emit(std::make_unique<IR_RegSet>(return_reg, cloner.reg(as_return->value())));
+    } else {
+      auto copy = code.at(i)->clone(&cloner);
+      assert(copy);
+      env->emit(std::move(copy));
+    }
+  }
+  assert(return_reg);
+
+  for (auto& constraint : callee->constraints()) {
+    if (constraint.instr_idx == 0) {
+      continue;  // arguments, which are now in our registers.
+    }
+    IRegConstraint copy = constraint;
+    copy.ireg = cloner.ireg(constraint.ireg);
+    copy.instr_idx += instr_offset;
+    fe->constrain(copy);
+  }
+
+  auto& stats = get_parent_env_of_type<FileEnv>(fe)->inline_stats();
+  stats.calls_inlined++;
+  // arg copies, body, result copy vs. getting the function, arg copies, call and result copy.
+  stats.ir_added += int(args.size() + code.size());
+  stats.ir_removed += int(args.size() + 4);
+
+  auto result = env->make_gpr(function_type.last_arg());
+  env->emit(std::make_unique<IR_RegSet>(result, return_reg));
+  return result;
+}
+
 namespace {
 /*!
  * Is the given typespec for a varargs function? Assumes typespec is a function to begin with.
@@ -506,6 +686,12 @@ Val* Compiler::compile_declare(const goos::Object& form, const goos::Object& res
       settings.allow_inline = true;
       settings.inline_by_default = false;
       settings.save_code = true;
+      settings.auto_inline = false;
+    } else if (first.as_symbol()->name == "no-inline") {
+      if (!rrest.is_empty_list()) {
+        throw_compile_error(first, "invalid no-inline declare");
+      }
+      settings.auto_inline = false;
     } else if (first.as_symbol()->name == "asm-func") {
       get_parent_env_of_type<FunctionEnv>(env)->is_asm_func = true;
     }
@@ -24,12 +24,12 @@ bool Compiler::try_getting_macro_from_goos(const goos::Object& macro_name, goos:
 }
 
 /*!
- * Expand a macro, then compile the result.
+ * Expand a macro.
  */
-Val* Compiler::compile_goos_macro(const goos::Object& o,
-                                  const goos::Object& macro_obj,
-                                  const goos::Object& rest,
-                                  Env* env) {
+goos::Object Compiler::expand_goos_macro(const goos::Object& o,
+                                         const goos::Object& macro_obj,
+                                         const goos::Object& rest,
+                                         Env* env) {
   auto macro = macro_obj.as_macro();
   Arguments args = m_goos.get_args(o, rest, macro->args);
   auto mac_env_obj = EnvironmentObject::make_new();
@@ -40,7 +40,25 @@ Val* Compiler::compile_goos_macro(const goos::Object& o,
       get_parent_env_of_type<FunctionEnv>(env)->method_of_type_name;
   auto goos_result = m_goos.eval_list_return_last(macro->body, macro->body, mac_env);
   m_goos.goal_to_goos.reset();
-  return compile_error_guard(goos_result, env);
+  return goos_result;
+}
+
+/*!
+ * Expand a macro, then compile the result.
+ */
+Val* Compiler::compile_goos_macro(const goos::Object& o,
+                                  const goos::Object& macro_obj,
+                                  const goos::Object& rest,
+                                  Env* env) {
+  // the constant evaluator may have already expanded it.
+  auto& expansions = get_parent_env_of_type<FileEnv>(env)->const_eval_expansions();
+  auto kv = expansions.find(o.heap_obj);
+  if (kv != expansions.end()) {
+    auto expanded = kv->second;
+    expansions.erase(kv);
+    return compile_error_guard(expanded, env);
+  }
+  return compile_error_guard(expand_goos_macro(o, macro_obj, rest, env), env);
 }
 
 /*!
@@ -11,14 +11,30 @@
  *
  * Step 1 can be done with the add_.... and link_... functions
  * Steps 2 - 5 are done in generate_data_vX()
+ *
+ * By default, instructions are encoded into bytes as soon as they are added, and only their
+ * offsets are kept for linking.  With direct_encoding off, the Instructions are stored and encoded
+ * during step 2 instead.
  */
 
+#include <unordered_map>
+#include "third-party/fmt/core.h"
 #include "ObjectGenerator.h"
 #include "common/goal_constants.h"
 #include "common/versions.h"
 
 namespace emitter {
 
+ObjectGenerator::ObjectGenerator(bool direct_encoding, bool merge_statics)
+    : m_direct_encoding(direct_encoding), m_merge_statics(merge_statics) {}
+
+/*!
+ * How many instructions have been added to the function, encoded or not.
+ */
+size_t ObjectGenerator::instruction_count(const FunctionData& function) {
+  return function.instructions.size() + function.instruction_info.size();
+}
+
 /*!
  * Build an object file with the v3 format.
  */
@@ -43,23 +59,48 @@ ObjectFileData ObjectGenerator::generate_data_v3() {
         insert_data<u8>(seg, 0xae);
       }
 
-      // insert instructions!
+      // encode stored instructions
       for (const auto& instr : function.instructions) {
-        u8 temp[128];
-        auto count = instr.emit(temp);
-        assert(count < 128);
-        function.instruction_to_byte_in_data.push_back(data.size());
-        for (int i = 0; i < count; i++) {
-          insert_data<u8>(seg, temp[i]);
-        }
+        encode_instruction(function, instr);
       }
+      function.instructions.clear();
+
+      // insert instructions!
+      function.location = data.size();
+      data.insert(data.end(), function.code.begin(), function.code.end());
     }
   }
 
   // do static data layout (step 2, part 2)
+  // immutable statics (like float constants) with the same bytes, alignment and links are only
+  // stored once. Strings can be modified, so each one gets its own copy.
   for (int seg = N_SEG; seg-- > 0;) {
     auto& data = m_data_by_seg.at(seg);
-    for (auto& s : m_static_data_by_seg.at(seg)) {
+    auto& statics = m_static_data_by_seg.at(seg);
+    auto link_keys = get_static_link_keys(seg);
+    std::unordered_map<std::string, int> pool;
+    int start = data.size();
+    int size_before = start;
+    for (size_t i = 0; i < statics.size(); i++) {
+      auto& s = statics.at(i);
+      while (size_before % s.min_align) {
+        size_before++;
+      }
+      size_before += s.data.size();
+
+      if (m_merge_statics && s.can_merge) {
+        std::string key(s.data.begin(), s.data.end());
+        key += std::to_string(s.min_align) + link_keys.at(i);
+        auto existing = pool.find(key);
+        if (existing != pool.end()) {
+          s.location = statics.at(existing->second).location;
+          s.is_duplicate = true;
+          m_static_stats.deduplicated++;
+          continue;
+        }
+        pool[key] = i;
+      }
+
       // align
       while (data.size() % s.min_align) {
         insert_data<u8>(seg, 0);
@@ -69,6 +110,10 @@ ObjectFileData ObjectGenerator::generate_data_v3() {
 
       data.insert(data.end(), s.data.begin(), s.data.end());
     }
+
+    m_static_stats.count += statics.size();
+    m_static_stats.bytes_before += size_before - start;
+    m_static_stats.bytes_after += int(data.size()) - start;
   }
 
   // step 3, cleaning up things now that we know the memory layout
@@ -93,6 +138,78 @@ ObjectFileData ObjectGenerator::generate_data_v3() {
   return out;
 }
 
+/*!
+ * Describe the type and symbol links inside of each static, so statics are only merged if they
+ * link to the same things.
+ */
+std::vector<std::string> ObjectGenerator::get_static_link_keys(int seg) {
+  std::vector<std::string> result(m_static_data_by_seg.at(seg).size());
+  for (const auto& type_links : m_static_type_temp_links_by_seg.at(seg)) {
+    for (const auto& link : type_links.second) {
+      result.at(link.rec.static_id) +=
+          fmt::format(" type {} {}", type_links.first, link.offset);
+    }
+  }
+
+  for (const auto& sym_links : m_static_sym_temp_links_by_seg.at(seg)) {
+    for (const auto& link : sym_links.second) {
+      result.at(link.rec.static_id) += fmt::format(" sym {} {}", sym_links.first, link.offset);
+    }
+  }
+  return result;
+}
+
+/*!
+ * Encode an instruction at the end of the function's code.
+ */
+void ObjectGenerator::encode_instruction(FunctionData& function, const Instruction& instr) {
+  InstructionInfo info;
+  info.offset = function.code.size();
+  info.disp_size = instr.get_disp_size();
+  if (info.disp_size) {
+    info.disp_offset = instr.offset_of_disp();
+  }
+  info.imm_size = instr.get_imm_size();
+  if (info.imm_size) {
+    info.imm_offset = instr.offset_of_imm();
+  }
+  function.instruction_info.push_back(info);
+
+  u8 temp[128];
+  auto count = instr.emit(temp);
+  assert(count < 128);
+  function.code.insert(function.code.end(), temp, temp + count);
+}
+
+/*!
+ * Get the offset of an instruction in the segment data, after layout. The instruction after the
+ * last one is the end of the function.
+ */
+int ObjectGenerator::instruction_to_byte_in_data(int seg, int func_id, int instr_id) const {
+  const auto& function = m_function_data_by_seg.at(seg).at(func_id);
+  assert(function.location >= 0);
+  if (instr_id == int(function.instruction_info.size())) {
+    return function.location + function.code.size();
+  }
+  return function.location + function.instruction_info.at(instr_id).offset;
+}
+
+/*!
+ * How many bytes are used to hold the functions before layout.
+ */
+size_t ObjectGenerator::function_data_bytes() const {
+  size_t result = 0;
+  for (const auto& seg : m_function_data_by_seg) {
+    for (const auto& function : seg) {
+      result += function.instructions.capacity() * sizeof(Instruction);
+      result += function.code.capacity();
+      result += function.instruction_info.capacity() * sizeof(InstructionInfo);
+      result += function.ir_to_instruction.capacity() * sizeof(int);
+    }
+  }
+  return result;
+}
+
 /*!
  * Add a new function to seg, and return a FunctionRecord which can be used to specify this
  * new function.
@@ -122,7 +239,7 @@ IR_Record ObjectGenerator::add_ir(const FunctionRecord& func) {
   rec.func_id = func.func_id;
   auto& func_data = m_function_data_by_seg.at(rec.seg).at(rec.func_id);
   rec.ir_id = int(func_data.ir_to_instruction.size());
-  func_data.ir_to_instruction.push_back(int(func_data.instructions.size()));
+  func_data.ir_to_instruction.push_back(int(instruction_count(func_data)));
   return rec;
 }
 
@@ -160,24 +277,35 @@ InstructionRecord ObjectGenerator::add_instr(Instruction inst, IR_Record ir) {
   rec.func_id = ir.func_id;
   rec.ir_id = ir.ir_id;
   auto& func_data = m_function_data_by_seg.at(rec.seg).at(rec.func_id);
-  rec.instr_id = int(func_data.instructions.size());
-  func_data.instructions.push_back(inst);
+  rec.instr_id = int(instruction_count(func_data));
+  if (m_direct_encoding) {
+    encode_instruction(func_data, inst);
+  } else {
+    func_data.instructions.push_back(inst);
+  }
   return rec;
 }
 
 void ObjectGenerator::add_instr_no_ir(FunctionRecord func, Instruction inst) {
-  m_function_data_by_seg.at(func.seg).at(func.func_id).instructions.push_back(inst);
+  auto& func_data = m_function_data_by_seg.at(func.seg).at(func.func_id);
+  if (m_direct_encoding) {
+    encode_instruction(func_data, inst);
+  } else {
+    func_data.instructions.push_back(inst);
+  }
 }
 
 /*!
  * Create a new static object in the given segment.
+ * If can_merge is set, the static is never modified, so it may share memory with an identical one.
  */
-StaticRecord ObjectGenerator::add_static_to_seg(int seg, int min_align) {
+StaticRecord ObjectGenerator::add_static_to_seg(int seg, int min_align, bool can_merge) {
   StaticRecord rec;
   rec.seg = seg;
   rec.static_id = m_static_data_by_seg.at(seg).size();
   m_static_data_by_seg.at(seg).emplace_back();
   m_static_data_by_seg.at(seg).back().min_align = min_align;
+  m_static_data_by_seg.at(seg).back().can_merge = can_merge;
   return rec;
 }
 
@@ -262,6 +390,9 @@ void ObjectGenerator::handle_temp_static_type_links(int seg) {
     for (const auto& link : type_links.second) {
       assert(seg == link.rec.seg);
       const auto& static_object = m_static_data_by_seg.at(seg).at(link.rec.static_id);
+      if (static_object.is_duplicate) {
+        continue;  // already linked in the original
+      }
       int total_offset = static_object.location + link.offset;
       m_type_ptr_links_by_seg.at(seg)[type_name].push_back(total_offset);
     }
@@ -279,6 +410,9 @@ void ObjectGenerator::handle_temp_static_sym_links(int seg) {
     for (const auto& link : sym_links.second) {
       assert(seg == link.rec.seg);
       const auto& static_object = m_static_data_by_seg.at(seg).at(link.rec.static_id);
+      if (static_object.is_duplicate) {
+        continue;  // already linked in the original
+      }
       int total_offset = static_object.location + link.offset;
       m_sym_links_by_seg.at(seg)[sym_name].push_back(total_offset);
     }
@@ -295,22 +429,23 @@ void ObjectGenerator::handle_temp_jump_links(int seg) {
     // 2). the value of RIP at the jump (the instruction after the jump, on x86)
     // 3). the value of RIP we want
     const auto& function = m_function_data_by_seg.at(seg).at(link.jump_instr.func_id);
+    int func_id = link.jump_instr.func_id;
     assert(link.jump_instr.func_id == link.dest.func_id);
     assert(link.jump_instr.seg == seg);
     assert(link.dest.seg == seg);
-    const auto& jump_instr = function.instructions.at(link.jump_instr.instr_id);
-    assert(jump_instr.get_imm_size() == 4);
+    const auto& jump_instr = function.instruction_info.at(link.jump_instr.instr_id);
+    assert(jump_instr.imm_size == 4);
 
     // 1). patch = instruction location + location of imm in instruction.
-    int patch_location = function.instruction_to_byte_in_data.at(link.jump_instr.instr_id) +
-                         jump_instr.offset_of_imm();
+    int patch_location = instruction_to_byte_in_data(seg, func_id, link.jump_instr.instr_id) +
+                         jump_instr.imm_offset;
 
     // 2). source rip = jump instr + 1 location
-    int source_rip = function.instruction_to_byte_in_data.at(link.jump_instr.instr_id + 1);
+    int source_rip = instruction_to_byte_in_data(seg, func_id, link.jump_instr.instr_id + 1);
 
     // 3). dest rip = first instruction of dest IR
     int dest_rip =
-        function.instruction_to_byte_in_data.at(function.ir_to_instruction.at(link.dest.ir_id));
+        instruction_to_byte_in_data(seg, func_id, function.ir_to_instruction.at(link.dest.ir_id));
 
     patch_data<s32>(seg, patch_location, dest_rip - source_rip);
   }
@@ -327,14 +462,15 @@ void ObjectGenerator::handle_temp_instr_sym_links(int seg) {
     for (const auto& link : links.second) {
       assert(seg == link.rec.seg);
       const auto& function = m_function_data_by_seg.at(seg).at(link.rec.func_id);
-      const auto& instruction = function.instructions.at(link.rec.instr_id);
-      int offset_of_instruction = function.instruction_to_byte_in_data.at(link.rec.instr_id);
+      const auto& instruction = function.instruction_info.at(link.rec.instr_id);
+      int offset_of_instruction =
+          instruction_to_byte_in_data(seg, link.rec.func_id, link.rec.instr_id);
       int offset_in_instruction =
-          link.is_mem_access ? instruction.offset_of_disp() : instruction.offset_of_imm();
+          link.is_mem_access ? instruction.disp_offset : instruction.imm_offset;
       if (link.is_mem_access) {
-        assert(instruction.get_disp_size() == 4);
+        assert(instruction.disp_size == 4);
       } else {
-        assert(instruction.get_imm_size() == 4);
+        assert(instruction.imm_size == 4);
       }
       m_sym_links_by_seg.at(seg)[sym_name].push_back(offset_of_instruction + offset_in_instruction);
     }
@@ -346,8 +482,7 @@ void ObjectGenerator::handle_temp_rip_func_links(int seg) {
     RipLink result;
     result.instr = link.instr;
     result.target_segment = link.target.seg;
-    const auto& target_func = m_function_data_by_seg.at(link.target.seg).at(link.target.func_id);
-    result.offset_in_segment = target_func.instruction_to_byte_in_data.at(0);
+    result.offset_in_segment = instruction_to_byte_in_data(link.target.seg, link.target.func_id, 0);
     m_rip_links_by_seg.at(seg).push_back(result);
   }
 }
@@ -435,15 +570,18 @@ void ObjectGenerator::emit_link_rip(int seg) {
     out.push_back(rec.target_segment);
     // offset into current
     const auto& src_func = m_function_data_by_seg.at(rec.instr.seg).at(rec.instr.func_id);
-    push_data<u32>(src_func.instruction_to_byte_in_data.at(rec.instr.instr_id + 1), out);
+    int src_instr_id = rec.instr.instr_id;
+    push_data<u32>(
+        instruction_to_byte_in_data(rec.instr.seg, rec.instr.func_id, src_instr_id + 1), out);
     // offset into target
     assert(rec.offset_in_segment >= 0);
     push_data<u32>(rec.offset_in_segment, out);
     // patch location
-    const auto& src_instr = src_func.instructions.at(rec.instr.instr_id);
-    assert(src_instr.get_disp_size() == 4);
+    const auto& src_instr = src_func.instruction_info.at(src_instr_id);
+    assert(src_instr.disp_size == 4);
     push_data<u32>(
-        src_func.instruction_to_byte_in_data.at(rec.instr.instr_id) + src_instr.offset_of_disp(),
+        instruction_to_byte_in_data(rec.instr.seg, rec.instr.func_id, src_instr_id) +
+            src_instr.disp_offset,
         out);
   }
 }
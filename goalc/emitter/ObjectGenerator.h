@@ -36,10 +36,22 @@ struct StaticRecord {
 
 struct ObjectDebugInfo {};
 
+/*!
+ * Static data in an object file, before and after identical statics were merged.
+ */
+struct StaticStats {
+  int count = 0;
+  int deduplicated = 0;
+  int bytes_before = 0;  // including alignment padding
+  int bytes_after = 0;
+};
+
 class ObjectGenerator {
  public:
-  ObjectGenerator() = default;
+  explicit ObjectGenerator(bool direct_encoding = true, bool merge_statics = true);
   ObjectFileData generate_data_v3();
+  size_t function_data_bytes() const;
+  const StaticStats& static_stats() const { return m_static_stats; }
 
   FunctionRecord add_function_to_seg(int seg,
                                      int min_align = 16);  // should align and insert function tag
@@ -49,7 +61,7 @@ class ObjectGenerator {
   IR_Record get_future_ir_record_in_same_func(const IR_Record& irec, int ir_id);
   InstructionRecord add_instr(Instruction inst, IR_Record ir);
   void add_instr_no_ir(FunctionRecord func, Instruction inst);
-  StaticRecord add_static_to_seg(int seg, int min_align = 16);
+  StaticRecord add_static_to_seg(int seg, int min_align = 16, bool can_merge = false);
   std::vector<u8>& get_static_data(const StaticRecord& rec);
   void link_instruction_jump(InstructionRecord jump_instr, IR_Record destination);
   void link_static_type_ptr(StaticRecord rec, int offset, const std::string& type_name);
@@ -73,12 +85,14 @@ class ObjectGenerator {
   void handle_temp_static_sym_links(int seg);
   void handle_temp_rip_data_links(int seg);
   void handle_temp_rip_func_links(int seg);
+  std::vector<std::string> get_static_link_keys(int seg);
 
   void emit_link_table(int seg);
   void emit_link_type_pointer(int seg);
   void emit_link_symbol(int seg);
   void emit_link_rip(int seg);
   std::vector<u8> generate_header_v3();
+  int instruction_to_byte_in_data(int seg, int func_id, int instr_id) const;
 
   template <typename T>
   void insert_data(int seg, const T& x) {
@@ -96,17 +110,36 @@ class ObjectGenerator {
     memcpy(data.data() + offset, &x, sizeof(T));
   }
 
+  /*!
+   * Where an encoded instruction is in its function's code, and where its immediates are, for
+   * linking.  This is all that is kept from an Instruction after it is encoded.
+   */
+  struct InstructionInfo {
+    u32 offset = 0;  // relative to the start of the function's code
+    u8 disp_offset = 0;
+    u8 disp_size = 0;
+    u8 imm_offset = 0;
+    u8 imm_size = 0;
+  };
+
   struct FunctionData {
-    std::vector<Instruction> instructions;
+    std::vector<Instruction> instructions;  // only used if not direct encoding
+    std::vector<u8> code;
+    std::vector<InstructionInfo> instruction_info;
     std::vector<int> ir_to_instruction;
-    std::vector<int> instruction_to_byte_in_data;
+    int location = -1;  // of the first instruction, in the segment
     int min_align = 16;
   };
 
+  static void encode_instruction(FunctionData& function, const Instruction& instr);
+  static size_t instruction_count(const FunctionData& function);
+
   struct StaticData {
     std::vector<u8> data;
     int min_align = 16;
     int location = -1;
+    bool can_merge = false;     // immutable, so it can share memory with an identical static
+    bool is_duplicate = false;  // same as an earlier static, which is used instead
   };
 
   struct StaticTypeLink {
@@ -174,6 +207,14 @@ class ObjectGenerator {
   seg_vector<RipLink> m_rip_links_by_seg;
 
   std::vector<FunctionRecord> m_all_function_records;
+
+  // encode instructions as they are added, instead of storing them until generate_data_v3
+  bool m_direct_encoding = true;
+
+  // store identical immutable statics only once
+  bool m_merge_statics = true;
+
+  StaticStats m_static_stats;
 };
 }  // namespace emitter
 
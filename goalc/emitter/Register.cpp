@@ -54,6 +54,8 @@ RegisterInfo RegisterInfo::make_register_info() {
 
   // todo - experiment with better orders for allocation.
   info.m_gpr_alloc_order = {RAX, RCX, RDX, RBX, RBP, RSI, RDI, R8, R9, R10, R11};  // arbitrary
+  // leaf functions don't need to keep anything across calls, so use temps before saved regs.
+  info.m_gpr_leaf_alloc_order = {RAX, RCX, RDX, RSI, RDI, R8, R9, RBX, RBP, R10, R11};
   info.m_xmm_alloc_order = {XMM0, XMM1, XMM2,  XMM3,  XMM4,  XMM5,  XMM6, XMM7,
                             XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14};
 
@@ -139,6 +139,8 @@ class RegisterInfo {
 
   const std::vector<Register>& get_xmm_alloc_order() { return m_xmm_alloc_order; }
 
+  const std::vector<Register>& get_gpr_leaf_alloc_order() { return m_gpr_leaf_alloc_order; }
+
   const std::vector<Register>& get_gpr_spill_alloc_order() { return m_gpr_spill_temp_alloc_order; }
 
   const std::vector<Register>& get_xmm_spill_alloc_order() { return m_xmm_spill_temp_alloc_order; }
@@ -153,6 +155,7 @@ class RegisterInfo {
   std::array<Register, N_SAVED_XMMS> m_saved_xmms;
   std::array<Register, N_SAVED_XMMS + N_SAVED_GPRS> m_saved_all;
   std::vector<Register> m_gpr_alloc_order;
+  std::vector<Register> m_gpr_leaf_alloc_order;
   std::vector<Register> m_xmm_alloc_order;
   std::vector<Register> m_gpr_spill_temp_alloc_order;
   std::vector<Register> m_xmm_spill_temp_alloc_order;
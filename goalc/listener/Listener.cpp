@@ -2,7 +2,9 @@
  * @file Listener.cpp
  * The Listener can connect to a Deci2Server for debugging.
  *
- * TODO - msg ID?
+ * Each message sent to the target has an ID, which the target sends back in its ack.  Normally each
+ * send waits for its ack.  In pipelined mode, up to MAX_IN_FLIGHT messages can be sent before
+ * waiting, and wait_for_all_acks() collects the acks.
  */
 
 #ifdef __linux__
@@ -51,6 +53,7 @@ Listener::~Listener() {
 
 void Listener::disconnect() {
   m_connected = false;
+  m_ack_cv.notify_all();
   if (receive_thread_running) {
     rcv_thread.join();
     receive_thread_running = false;
@@ -151,6 +154,12 @@ bool Listener::connect_to_target(int n_tries, const std::string& ip, int port) {
   printf("Got version %d.%d", version_buffer[0], version_buffer[1]);
   if (version_buffer[0] == GOAL_VERSION_MAJOR && version_buffer[1] == GOAL_VERSION_MINOR) {
     printf(" OK!\n");
+    {
+      std::lock_guard<std::mutex> lk(m_ack_mutex);
+      m_pending_ids.clear();
+      m_sent_count = 0;
+      m_acked_count = 0;
+    }
     m_connected = true;
     rcv_thread = std::thread(&Listener::receive_func, this);
     receive_thread_running = true;
@@ -196,10 +205,6 @@ void Listener::receive_func() {
     switch (hdr->msg_kind) {
       case ListenerMessageKind::MSG_ACK:
         // an "ack" message, sent by the target to indicate it got something.
-        if (!waiting_for_ack) {
-          printf("[Listener] Got an ack message when we weren't expecting one.");
-        }
-
         if (hdr->deci2_header.len < 512) {
           // ack's should be < 512 bytes (they are just "ack").
           int ack_recv_prog = 0;
@@ -214,7 +219,19 @@ void Listener::receive_func() {
           }
           ack_recv_buff[ack_recv_prog] = '\0';
           assert(ack_recv_prog < 512);
-          got_ack = true;
+
+          std::lock_guard<std::mutex> lk(m_ack_mutex);
+          if (m_pending_ids.empty()) {
+            printf("[Listener] Got an ack message when we weren't expecting one.\n");
+          } else {
+            if (m_pending_ids.front() != hdr->msg_id) {
+              printf("[Listener] Got ack for message %lld, expected %lld\n",
+                     (long long)hdr->msg_id, (long long)m_pending_ids.front());
+            }
+            m_pending_ids.pop_front();
+            m_acked_count++;
+          }
+          m_ack_cv.notify_all();
         } else {
           printf("[Listener] got invalid ack!\n");
         }
@@ -293,9 +310,9 @@ void Listener::send_code(std::vector<uint8_t>& code) {
   header->msg_size = code.size();
   header->ltt_msg_kind = LTT_MSG_CODE;
   header->u6 = 0;
-  header->u8 = 0;
+  header->msg_id = m_next_msg_id++;
   memcpy(buffer_data, code.data(), code.size());
-  send_buffer(total_size);
+  send_buffer(total_size, header->msg_id);
 }
 
 void Listener::send_reset(bool shutdown) {
@@ -312,8 +329,11 @@ void Listener::send_reset(bool shutdown) {
   header->msg_size = 0;
   header->ltt_msg_kind = LTT_MSG_RESET;
   header->u6 = 0;
-  header->u8 = shutdown ? UINT64_MAX : 0;
-  send_buffer(sizeof(ListenerMessageHeader));
+  // the target uses the ID of a reset message as the shutdown flag.
+  header->msg_id = shutdown ? UINT64_MAX : 0;
+  // acks come in order, so a blocking send also waits for anything still in flight.
+  m_pipelined = false;
+  send_buffer(sizeof(ListenerMessageHeader), header->msg_id);
   disconnect();
   close_socket(listen_socket);
   printf("closed connection to target\n");
@@ -333,30 +353,48 @@ void Listener::send_poke() {
   header->msg_size = 0;
   header->ltt_msg_kind = LTT_MSG_POKE;
   header->u6 = 0;
-  header->u8 = 0;
-  send_buffer(sizeof(ListenerMessageHeader));
+  header->msg_id = m_next_msg_id++;
+  send_buffer(sizeof(ListenerMessageHeader), header->msg_id);
 }
 
-void Listener::send_buffer(int sz) {
+/*!
+ * Send the message in m_buffer. Unless we are in pipelined mode, waits for the target to ack it.
+ * In pipelined mode, this only waits if there are too many messages waiting for an ack.
+ */
+void Listener::send_buffer(int sz, u64 msg_id) {
   int wrote = 0;
 
   if (debug_listener) {
-    fprintf(stderr, "[L -> T] sending %d bytes...\n", sz);
+    fprintf(stderr, "[L -> T] sending %d bytes (id %lld)...\n", sz, (long long)msg_id);
+  }
+
+  u64 count;
+  {
+    std::lock_guard<std::mutex> lk(m_ack_mutex);
+    m_pending_ids.push_back(msg_id);
+    count = ++m_sent_count;
+  }
+
+  if (m_pipelined && count > MAX_IN_FLIGHT && !wait_for_ack(count - MAX_IN_FLIGHT)) {
+    printf("  NG - target has timed out.  If it has died, disconnect with (disconnect-target)\n");
   }
 
-  got_ack = false;
-  waiting_for_ack = true;
   while (wrote < sz) {
     auto to_send = std::min(512, sz - wrote);
     auto x = write_to_socket(listen_socket, m_buffer + wrote, to_send);
     wrote += x > 0 ? x : 0;
   }
 
+  if (m_pipelined) {
+    return;
+  }
+
   if (debug_listener) {
     printf("  waiting for ack...\n");
   }
 
-  if (wait_for_ack()) {
+  got_ack = wait_for_ack(count);
+  if (got_ack) {
     if (debug_listener) {
       printf("ack buff:\n");
       printf("%s\n", ack_recv_buff);
@@ -367,20 +405,36 @@ void Listener::send_buffer(int sz) {
   }
 }
 
-bool Listener::wait_for_ack() {
+/*!
+ * Wait until the first count messages have been acked.
+ */
+bool Listener::wait_for_ack(u64 count) {
   if (!m_connected) {
     printf("wait_for_ack called when not connected!\n");
     return false;
   }
 
-  for (int i = 0; i < 2000; i++) {
-    if (got_ack)
-      return true;
-    std::this_thread::sleep_for(std::chrono::microseconds(1000));
-  }
+  std::unique_lock<std::mutex> lk(m_ack_mutex);
+  return m_ack_cv.wait_for(lk, std::chrono::milliseconds(2000),
+                          [&] { return m_acked_count >= count || !m_connected; }) &&
+         m_acked_count >= count;
+}
 
-  waiting_for_ack = false;
-  return false;
+/*!
+ * Wait for the target to ack all messages that have been sent.
+ * Returns false if the target times out.
+ */
+bool Listener::wait_for_all_acks() {
+  if (!m_connected) {
+    return false;
+  }
+  u64 count;
+  {
+    std::lock_guard<std::mutex> lk(m_ack_mutex);
+    count = m_sent_count;
+  }
+  got_ack = wait_for_ack(count);
+  return got_ack;
 }
 
 }  // namespace listener
@@ -8,6 +8,8 @@
 #ifndef JAK1_LISTENER_H
 #define JAK1_LISTENER_H
 
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <vector>
 #include <thread>
@@ -19,6 +21,7 @@ namespace listener {
 class Listener {
  public:
   static constexpr int BUFFER_SIZE = 32 * 1024 * 1024;
+  static constexpr int MAX_IN_FLIGHT = 16;  //! max unacknowledged messages in pipelined mode
   Listener();
   ~Listener();
   bool connect_to_target(int n_tries = 1,
@@ -31,18 +34,28 @@ class Listener {
   void send_poke();
   void disconnect();
   void send_code(std::vector<uint8_t>& code);
+  void set_pipelined(bool pipelined) { m_pipelined = pipelined; }
+  bool wait_for_all_acks();
   bool most_recent_send_was_acked() { return got_ack; }
 
  private:
-  void send_buffer(int sz);
-  bool wait_for_ack();
+  void send_buffer(int sz, u64 msg_id);
+  bool wait_for_ack(u64 count);
 
   char* m_buffer = nullptr;             //! buffer for incoming messages
   bool m_connected = false;             //! do we think we are connected?
   bool receive_thread_running = false;  //! is the receive thread unjoined?
   int listen_socket = -1;               //! socket
   bool got_ack = false;
-  bool waiting_for_ack = false;
+  bool m_pipelined = false;  //! if set, sends don't wait for acks
+
+  // message ids and acks. The target acks messages in the order it gets them.
+  std::mutex m_ack_mutex;
+  std::condition_variable m_ack_cv;
+  std::deque<u64> m_pending_ids;  //! ids of sent messages that haven't been acked yet
+  u64 m_next_msg_id = 1;
+  u64 m_sent_count = 0;
+  u64 m_acked_count = 0;
 
   std::thread rcv_thread;
   std::mutex rcv_mtx;
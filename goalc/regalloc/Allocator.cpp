@@ -616,10 +616,15 @@ const std::vector<emitter::Register>& get_default_alloc_order_for_var_spill(int
   }
 }
 
-const std::vector<emitter::Register>& get_default_alloc_order_for_var(int v, RegAllocCache* cache) {
+const std::vector<emitter::Register>& get_default_alloc_order_for_var(int v,
+                                                                      RegAllocCache* cache,
+                                                                      const AllocationInput& in) {
   auto& info = cache->iregs.at(v);
   //  assert(info.kind != emitter::RegKind::INVALID);
   if (info.kind == emitter::RegKind::GPR || info.kind == emitter::RegKind::INVALID) {
+    if (in.is_leaf) {
+      return emitter::gRegInfo.get_gpr_leaf_alloc_order();
+    }
     return emitter::gRegInfo.get_gpr_alloc_order();
   } else if (info.kind == emitter::RegKind::XMM) {
     return emitter::gRegInfo.get_xmm_alloc_order();
@@ -786,7 +791,7 @@ bool do_allocation_for_var(int var,
     }
   }
 
-  auto reg_order = get_default_alloc_order_for_var(var, cache);
+  auto reg_order = get_default_alloc_order_for_var(var, cache, in);
 
   // todo, try other regs..
   if (!colored && move_eliminator) {
@@ -82,6 +82,7 @@ struct AllocationInput {
   std::vector<RegAllocInstr> instructions;           // all instructions in the function
   std::vector<IRegConstraint> constraints;           // all register constraints
   int max_vars = -1;                                 // maximum register id.
+  bool is_leaf = false;                              // calls no functions, prefer temp regs
   std::vector<std::string> debug_instruction_names;  // optional, for debug prints
 
   struct {
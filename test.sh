@@ -3,4 +3,4 @@
 # Directory of this script
 DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" >/dev/null 2>&1 && pwd )"
 
-$DIR/build/test/goalc-test --gtest_color=yes "$@"
+$DIR/build/test/goalc-test --gtest_color=yes "$@" && $DIR/build/test/decompiler-test --gtest_color=yes "$@"
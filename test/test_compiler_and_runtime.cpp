@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <thread>
 #include <chrono>
 
@@ -5,6 +6,8 @@
 #include "game/runtime.h"
 #include "goalc/listener/Listener.h"
 #include "goalc/compiler/Compiler.h"
+#include "goalc/compiler/CodeGenerator.h"
+#include "common/util/Timer.h"
 
 TEST(CompilerAndRuntime, ConstructCompiler) {
   Compiler compiler;
@@ -23,6 +26,53 @@ TEST(CompilerAndRuntime, StartRuntime) {
   runtime_thread.join();
 }
 
+TEST(CompilerAndRuntime, ListenerThroughput) {
+  constexpr int message_count = 500;
+  std::thread runtime_thread([]() { exec_runtime(0, nullptr); });
+
+  listener::Listener listener;
+  while (!listener.is_connected()) {
+    listener.connect_to_target();
+    std::this_thread::sleep_for(std::chrono::microseconds(1000));
+  }
+
+  // one at a time, waiting for each ack
+  std::vector<double> latencies;
+  Timer blocking_timer;
+  for (int i = 0; i < message_count; i++) {
+    Timer round_trip;
+    listener.send_poke();
+    EXPECT_TRUE(listener.most_recent_send_was_acked());
+    latencies.push_back(round_trip.getMs());
+  }
+  double blocking_ms = blocking_timer.getMs();
+  std::sort(latencies.begin(), latencies.end());
+
+  // pipelined, collecting the acks at the end.  Sends only block when the window is full.
+  std::vector<double> send_times;
+  listener.set_pipelined(true);
+  Timer pipelined_timer;
+  for (int i = 0; i < message_count; i++) {
+    Timer send_timer;
+    listener.send_poke();
+    send_times.push_back(send_timer.getMs());
+  }
+  EXPECT_TRUE(listener.wait_for_all_acks());
+  double pipelined_ms = pipelined_timer.getMs();
+  listener.set_pipelined(false);
+  std::sort(send_times.begin(), send_times.end());
+
+  fmt::print("listener: blocking {:.0f} sends/s, p50 {:.3f} ms, p99 {:.3f} ms\n",
+             message_count * 1000. / blocking_ms, latencies.at(message_count / 2),
+             latencies.at(message_count * 99 / 100));
+  fmt::print("listener: pipelined {:.0f} sends/s, p50 {:.3f} ms, p99 {:.3f} ms per send\n",
+             message_count * 1000. / pipelined_ms, send_times.at(message_count / 2),
+             send_times.at(message_count * 99 / 100));
+
+  listener.send_reset(true);
+  runtime_thread.join();
+}
+
 TEST(CompilerAndRuntime, SendProgram) {
   std::thread runtime_thread([]() { exec_runtime(0, nullptr); });
   Compiler compiler;
@@ -137,6 +187,7 @@ TEST(CompilerAndRuntime, BuildGameAndTest) {
   runner.run_test("test-basic-type-check.gc", {"#f#t#t#f#t#f#t#t\n0\n"});
   runner.run_test("test-condition-boolean.gc", {"4\n"});
   runner.run_test("test-type-type.gc", {"#t#f\n0\n"});
+  runner.run_test("test-type-type-fast.gc", {"#t#f#t#f\n0\n"});
   runner.run_test("test-access-inline-array.gc", {"1.2345\n0\n"});
   runner.run_test("test-find-parent-method.gc", {"\"test pass!\"\n0\n"});
   runner.run_test("test-ref.gc", {"83\n"});
@@ -176,6 +227,20 @@ TEST(CompilerAndRuntime, BuildGameAndTest) {
   runtime_thread.join();
 }
 
+// loads the kernel and engine (built by BuildGameAndTest) with method propagation on, the runtime
+// prints the time spent in method_set for each DGO.
+TEST(CompilerAndRuntime, LoadGameMethodSet) {
+  std::thread runtime_thread([]() { exec_runtime(0, nullptr); });
+  Compiler compiler;
+
+  CompilerTestRunner runner;
+  runner.c = &compiler;
+  runner.run_test("test-load-game-method-set.gc", {"0\n"});
+
+  compiler.shutdown_target();
+  runtime_thread.join();
+}
+
 // TODO -move these into another file?
 TEST(CompilerAndRuntime, InlineIsInline) {
   Compiler compiler;
@@ -218,6 +283,159 @@ TEST(CompilerAndRuntime, AllowInline) {
   EXPECT_EQ(got_call, 1);
 }
 
+// compiles the kernel sources and prints how many times types were looked up by name and by id.
+TEST(CompilerAndRuntime, TypeLookupsCompilingKernel) {
+  Compiler compiler;
+  auto& ts = compiler.get_type_system();
+  auto name_lookups = ts.lookup_stats().name_lookups;
+  auto id_lookups = ts.lookup_stats().id_lookups;
+  auto interns = type_name_intern_count();
+
+  Timer timer;
+  for (auto file : {"gcommon.gc", "gstring-h.gc", "gkernel-h.gc", "gkernel.gc", "pskernel.gc",
+                    "gstring.gc", "dgo-h.gc", "gstate.gc"}) {
+    auto code = compiler.get_goos().reader.read_from_file({"goal_src", "kernel", file});
+    compiler.compile_object_file(file, code, true);
+  }
+
+  fmt::print("compiled kernel in {:.2f} ms: {} type lookups by name, {} by id, {} names interned\n",
+             timer.getMs(), ts.lookup_stats().name_lookups - name_lookups,
+             ts.lookup_stats().id_lookups - id_lookups, type_name_intern_count() - interns);
+}
+
+// codegen for gcommon with and without direct encoding must give the same object file.
+TEST(CompilerAndRuntime, DirectEncoding) {
+  Compiler compiler;
+  auto code = compiler.get_goos().reader.read_from_file({"goal_src", "kernel", "gcommon.gc"});
+  auto env = compiler.compile_object_file("gcommon", code, true);
+  compiler.color_object_file(env);
+
+  for (int i = 0; i < 2; i++) {
+    Timer record_timer;
+    CodeGenerator record_gen(env, false);
+    auto record_data = record_gen.run();
+    auto record_ms = record_timer.getMs();
+
+    Timer direct_timer;
+    CodeGenerator direct_gen(env, true);
+    auto direct_data = direct_gen.run();
+    auto direct_ms = direct_timer.getMs();
+
+    EXPECT_EQ(record_data, direct_data);
+    fmt::print("gcommon codegen: records {:.3f} ms, {} bytes, direct {:.3f} ms, {} bytes\n",
+               record_ms, record_gen.function_data_bytes(), direct_ms,
+               direct_gen.function_data_bytes());
+  }
+}
+
+// identical string and float constants are only stored once.
+TEST(CompilerAndRuntime, StaticDedup) {
+  Compiler compiler;
+  auto code =
+      compiler.get_goos().reader.read_from_file({"goal_src", "test", "test-static-dedup.gc"});
+  auto env = compiler.compile_object_file("test-code", code, true);
+  compiler.color_object_file(env);
+  CodeGenerator gen(env);
+  gen.run();
+  auto& stats = gen.static_stats();
+  // "shared" once in the function (main segment) and 3 times at the top level (top level segment),
+  // a format string, and the two 1.5's. Strings can be modified, so only the floats are merged.
+  EXPECT_EQ(stats.count, 7);
+  EXPECT_EQ(stats.deduplicated, 1);
+  EXPECT_LT(stats.bytes_after, stats.bytes_before);
+
+  CodeGenerator no_dedup_gen(env, true, false);
+  no_dedup_gen.run();
+  EXPECT_EQ(no_dedup_gen.static_stats().count, 7);
+  EXPECT_EQ(no_dedup_gen.static_stats().deduplicated, 0);
+}
+
+// math on constants and inline functions with constant arguments is done at compile time.
+TEST(CompilerAndRuntime, ConstEval) {
+  Compiler compiler;
+  auto config =
+      compiler.get_goos().reader.read_from_string("(set-config! const-eval-inline-calls #t)");
+  compiler.compile_object_file("test-code", config, false);
+  auto code = compiler.get_goos().reader.read_from_file({"goal_src", "test", "test-const-eval.gc"});
+  auto env = compiler.compile_object_file("test-code", code, true);
+  auto& stats = env->const_eval_stats();
+  // the arguments of the first two formats, then the (- 1.5) and the (const-eval-add3 1 2 3), but
+  // not the division of a float by an int.
+  EXPECT_EQ(stats.forms_folded, 9);
+  EXPECT_GT(stats.ir_eliminated, 8);
+  int math_count = 0;
+  for (auto& x : env->top_level_function().code()) {
+    if (dynamic_cast<IR_IntegerMath*>(x.get()) || dynamic_cast<IR_FloatMath*>(x.get())) {
+      math_count++;
+    }
+  }
+  // just the division.
+  EXPECT_EQ(math_count, 1);
+
+  // without const-eval-inline-calls, the calls to const-eval-add3 are inlined but not folded.
+  Compiler default_compiler;
+  auto default_code =
+      default_compiler.get_goos().reader.read_from_file({"goal_src", "test", "test-const-eval.gc"});
+  auto default_env = default_compiler.compile_object_file("test-code", default_code, true);
+  EXPECT_LT(default_env->const_eval_stats().forms_folded, stats.forms_folded);
+  int default_math_count = 0;
+  for (auto& x : default_env->top_level_function().code()) {
+    if (dynamic_cast<IR_IntegerMath*>(x.get()) || dynamic_cast<IR_FloatMath*>(x.get())) {
+      default_math_count++;
+    }
+  }
+  EXPECT_GT(default_math_count, math_count);
+}
+
+// calls to small global functions are replaced with a copy of the function's code.
+TEST(CompilerAndRuntime, IRInline) {
+  Compiler compiler;
+  auto code = compiler.get_goos().reader.read_from_file({"goal_src", "test", "test-ir-inline.gc"});
+  auto env = compiler.compile_object_file("test-code", code, true);
+  auto& stats = env->inline_stats();
+  // everything but (ir-inline-not-copied arg).
+  EXPECT_EQ(stats.calls_inlined, 7);
+  EXPECT_GT(stats.ir_added, stats.ir_removed);
+  int call_count = 0;
+  for (auto& f : env->functions()) {
+    for (auto& x : f->code()) {
+      if (dynamic_cast<IR_FunctionCall*>(x.get())) {
+        call_count++;
+      }
+    }
+  }
+  // list (3 conses), 2x format, ir-inline-not-copied, and ir-inline-test from the top level.
+  EXPECT_EQ(call_count, 7);
+
+  // code in other files always calls the function.
+  auto other_code = compiler.get_goos().reader.read_from_string(
+      "(defun ir-inline-other ((x int)) (ir-inline-clamp x 0 10))");
+  auto other_env = compiler.compile_object_file("test-code-2", other_code, true);
+  EXPECT_EQ(other_env->inline_stats().calls_inlined, 0);
+}
+
+// functions that don't call anything and fit in temp registers get no prologue or epilogue.
+TEST(CompilerAndRuntime, LeafFunction) {
+  Compiler compiler;
+  auto code =
+      compiler.get_goos().reader.read_from_file({"goal_src", "test", "test-leaf-function.gc"});
+  auto env = compiler.compile_object_file("test-code", code, true);
+  compiler.color_object_file(env);
+  int leaf_count = 0;
+  for (auto& f : env->functions()) {
+    if (f->is_leaf()) {
+      leaf_count++;
+      EXPECT_TRUE(f->alloc_result().used_saved_regs.empty());
+      EXPECT_EQ(f->alloc_result().stack_slots, 0);
+    }
+  }
+  // leaf-function-mix and leaf-function-float, not the top level or not-a-leaf-function.
+  EXPECT_EQ(leaf_count, 2);
+  CodeGenerator gen(env);
+  gen.run();
+  EXPECT_EQ(gen.leaf_functions(), 2);
+}
+
 TEST(CompilerAndRuntime, CompilerTests) {
   std::thread runtime_thread([]() { exec_runtime(0, nullptr); });
   Compiler compiler;
@@ -254,6 +472,11 @@ TEST(CompilerAndRuntime, CompilerTests) {
 
   std::string expected = "\"test string!\"";
   runner.run_test("test-string-constant-2.gc", {expected}, expected.size());
+  runner.run_test("test-static-dedup.gc", {"#f #f 1.5000 1.5000\n0\n"});
+  runner.run_test("test-const-eval.gc", {"-30 123 113 -1\n2147483645 -3 -1\n-0.2500\n0\n"});
+  runner.run_test("test-leaf-function.gc", {"13 -79 8.0000\n0\n"});
+  runner.run_test("test-ir-inline.gc",
+                  {"2 0 3 6\n\"positive\" \"not-positive\" 3.7500 6\n0\n"});
   runner.run_test("test-defun-return-constant.gc", {"12\n"});
   runner.run_test("test-defun-return-symbol.gc", {"42\n"});
   runner.run_test("test-function-return-arg.gc", {"23\n"});
@@ -0,0 +1,164 @@
+#include "gtest/gtest.h"
+#include "decompiler/Function/Function.h"
+#include "decompiler/Function/Dataflow.h"
+#include "decompiler/Disasm/InstructionMatching.h"
+
+namespace {
+Instruction make_instr(InstructionKind kind,
+                       std::vector<InstructionAtom> dst,
+                       std::vector<InstructionAtom> src) {
+  Instruction instr;
+  instr.kind = kind;
+  for (auto& a : dst) {
+    instr.add_dst(a);
+  }
+  for (auto& a : src) {
+    instr.add_src(a);
+  }
+  return instr;
+}
+
+InstructionAtom reg(Reg::Gpr gpr) {
+  InstructionAtom atom;
+  atom.set_reg(make_gpr(gpr));
+  return atom;
+}
+
+InstructionAtom imm(int value) {
+  InstructionAtom atom;
+  atom.set_imm(value);
+  return atom;
+}
+
+InstructionAtom sym(const char* name) {
+  InstructionAtom atom;
+  atom.set_sym(name);
+  return atom;
+}
+
+/*!
+ * Two blocks: a lui/ori constant and some symbol loads, then a call with a move in its delay slot.
+ */
+Function make_test_function() {
+  Function func(0, 9);
+  auto& instrs = func.instructions;
+  // the type tag word, not part of any block.
+  instrs.push_back(make_instr(InstructionKind::SLL, {reg(Reg::R0)}, {reg(Reg::R0), imm(0)}));
+  instrs.push_back(make_instr(InstructionKind::LUI, {reg(Reg::V1)}, {imm(0x1234)}));  // 1
+  instrs.push_back(
+      make_instr(InstructionKind::ORI, {reg(Reg::V1)}, {reg(Reg::V1), imm(0x5678)}));  // 2
+  instrs.push_back(
+      make_instr(InstructionKind::DADDIU, {reg(Reg::A0)}, {reg(Reg::S7), sym("foo")}));  // 3
+  instrs.push_back(
+      make_instr(InstructionKind::OR, {reg(Reg::A1)}, {reg(Reg::V1), reg(Reg::R0)}));  // 4
+  instrs.push_back(
+      make_instr(InstructionKind::LW, {reg(Reg::T9)}, {sym("bar"), reg(Reg::S7)}));  // 5
+  instrs.push_back(make_instr(InstructionKind::JALR, {reg(Reg::RA)}, {reg(Reg::T9)}));  // 6
+  instrs.push_back(
+      make_instr(InstructionKind::OR, {reg(Reg::S0)}, {reg(Reg::A1), reg(Reg::R0)}));  // 7
+  instrs.push_back(
+      make_instr(InstructionKind::DADDU, {reg(Reg::V0)}, {reg(Reg::V0), reg(Reg::S0)}));  // 8
+
+  func.basic_blocks.emplace_back(1, 5);
+  func.basic_blocks.emplace_back(5, 9);
+  func.basic_blocks[0].succ = {1};
+  func.basic_blocks[1].pred = {0};
+  func.prologue.ra_backed_up = true;
+  return func;
+}
+}  // namespace
+
+TEST(Dataflow, Liveness) {
+  auto func = make_test_function();
+  FunctionDataflow df;
+  df.run(func);
+  ASSERT_TRUE(df.ran());
+
+  // v1 is used by the ori and the or, then dead.
+  EXPECT_TRUE(df.is_live_after(1, make_gpr(Reg::V1)));
+  EXPECT_TRUE(df.is_live_after(2, make_gpr(Reg::V1)));
+  EXPECT_FALSE(df.is_live_after(4, make_gpr(Reg::V1)));
+
+  // a0 is an argument of the call, t9 is the function.
+  EXPECT_TRUE(df.is_live_after(3, make_gpr(Reg::A0)));
+  EXPECT_TRUE(df.is_live_after(5, make_gpr(Reg::T9)));
+  EXPECT_FALSE(df.is_live_after(6, make_gpr(Reg::T9)));
+
+  // s0 is saved across the call and used after it. a1 is clobbered by the call.
+  EXPECT_TRUE(df.is_live_after(7, make_gpr(Reg::S0)));
+  EXPECT_FALSE(df.is_live_after(7, make_gpr(Reg::A1)));
+  EXPECT_EQ(df.live_after(7), df.live_after(8));
+}
+
+TEST(Dataflow, ReachingDefinitions) {
+  auto func = make_test_function();
+  FunctionDataflow df;
+  df.run(func);
+
+  // the ori reads the lui, the or reads the ori.
+  EXPECT_EQ(df.src_def(2, 0), 1);
+  EXPECT_EQ(df.src_def(4, 0), 2);
+  // s7 and v0 come from the caller.
+  EXPECT_EQ(df.src_def(3, 0), dataflow::DEF_ENTRY);
+  EXPECT_EQ(df.src_def(5, 1), dataflow::DEF_ENTRY);
+  // the jalr reads the lw in the previous block.
+  EXPECT_EQ(df.src_def(6, 0), 5);
+  EXPECT_EQ(df.src_def(7, 0), 4);
+  EXPECT_EQ(df.src_def(8, 1), 7);
+  // r0 isn't tracked.
+  EXPECT_EQ(df.src_def(4, 1), dataflow::DEF_MULTIPLE);
+
+  EXPECT_EQ(df.stats.uses, 8);
+  EXPECT_EQ(df.stats.uses_with_single_def, 8);
+}
+
+TEST(Dataflow, Constants) {
+  auto func = make_test_function();
+  FunctionDataflow df;
+  df.run(func);
+
+  EXPECT_EQ(df.dst_value(1).kind, ConstValue::Kind::INTEGER);
+  EXPECT_EQ(df.dst_value(1).integer, 0x12340000);
+  EXPECT_EQ(df.dst_value(2).kind, ConstValue::Kind::INTEGER);
+  EXPECT_EQ(df.dst_value(2).integer, 0x12345678);
+  EXPECT_EQ(df.dst_value(3).kind, ConstValue::Kind::SYM_PTR);
+  EXPECT_EQ(df.dst_value(3).sym, "foo");
+  EXPECT_EQ(df.dst_value(4).integer, 0x12345678);
+  EXPECT_EQ(df.dst_value(5).kind, ConstValue::Kind::SYM_VAL);
+  EXPECT_EQ(df.dst_value(5).sym, "bar");
+  // moves keep the constant, even in the delay slot of a call.
+  EXPECT_EQ(df.dst_value(7).integer, 0x12345678);
+  EXPECT_FALSE(df.dst_value(8).is_known());
+}
+
+// a forward union problem over a loop, to check the solver reaches the fixed point.
+TEST(Dataflow, SolverLoop) {
+  // 0 -> 1, 1 -> 1, 1 -> 2
+  std::vector<BasicBlock> blocks = {{0, 1}, {1, 2}, {2, 3}};
+  blocks[0].succ = {1};
+  blocks[1].pred = {0, 1};
+  blocks[1].succ = {1, 2};
+  blocks[2].pred = {1};
+
+  DataflowProblem problem;
+  problem.n_bits = 3;
+  problem.boundary = BitSet(3);
+  for (int i = 0; i < 3; i++) {
+    problem.gen.emplace_back(3);
+    problem.kill.emplace_back(3);
+  }
+  problem.gen[0].set(0);
+  problem.gen[1].set(1);
+  problem.kill[1].set(0);
+  problem.gen[2].set(2);
+
+  auto solution = solve_dataflow(problem, blocks);
+  // bit 0 reaches the loop from block 0, bit 1 reaches it around the back edge.
+  EXPECT_TRUE(solution.in[1].get(0));
+  EXPECT_TRUE(solution.in[1].get(1));
+  EXPECT_FALSE(solution.out[1].get(0));
+  EXPECT_TRUE(solution.in[2].get(1));
+  EXPECT_FALSE(solution.in[2].get(0));
+  EXPECT_EQ(solution.out[2].count(), 2);
+  EXPECT_GT(solution.iterations, 1);
+}
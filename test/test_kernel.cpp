@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include "gtest/gtest.h"
@@ -9,6 +13,9 @@
 #include "game/kernel/kprint.h"
 #include "game/kernel/kdsnetm.h"
 #include "game/kernel/kscheme.h"
+#include "game/system/FileCache.h"
+#include "common/util/FileUtil.h"
+#include "common/util/Timer.h"
 #include "all_jak1_symbols.h"
 
 TEST(Kernel, strend) {
@@ -285,6 +292,84 @@ TEST(Kernel, itoa_base_16) {
   EXPECT_EQ("8000000000000000", std::string(buffer));
 }
 
+TEST(Kernel, itoa_matches_reference) {
+  char buffer[128];
+  char ref[128];
+
+  kprint_init_globals();
+
+  std::mt19937_64 rng(1234);
+  std::vector<s64> values = {0, 1, -1, 9, 10, 99, 100, -100, INT64_MAX, INT64_MIN, INT64_MIN + 1};
+  for (int i = 0; i < 5000; i++) {
+    // random values of all magnitudes
+    values.push_back((s64)(rng() >> (rng() % 64)) * ((rng() & 1) ? -1 : 1));
+  }
+
+  const s32 lengths[] = {-1, 0, 1, 2, 3, 4, 5, 8, 11, 16, 20, 21, 32, 63, 64, 65, 70};
+  for (auto value : values) {
+    for (u64 base : {2, 10, 16}) {
+      for (auto length : lengths) {
+        for (u32 flag : {0, 2}) {
+          kitoa(buffer, value, base, length, 'j', flag);
+          kitoa_reference(ref, value, base, length, 'j', flag);
+          ASSERT_EQ(std::string(ref), std::string(buffer))
+              << value << " base " << base << " len " << length << " flag " << flag;
+        }
+      }
+    }
+  }
+
+  // other bases go through the reference
+  kitoa(buffer, 35, 8, -1, ' ', 0);
+  EXPECT_EQ("43", std::string(buffer));
+}
+
+TEST(Kernel, cvt_float_matches_reference) {
+  char buffer[0x100];
+  char ref[0x100];
+
+  auto check = [&](float x, s32 precision) {
+    s32 lead, ref_lead;
+    s32 count = cvt_float(x, precision, &lead, buffer, buffer + 0x7f, 0);
+    s32 ref_count = cvt_float_reference(x, precision, &ref_lead, ref, ref + 0x7f, 0);
+    ASSERT_EQ(ref_count, count) << x;
+    ASSERT_EQ(ref_lead, lead) << x;
+    ASSERT_EQ(std::string(ref, ref_count + 1), std::string(buffer, count + 1))
+        << x << " precision " << precision;
+  };
+
+  // every float below the fast path limit, in large strides, at the default precision.
+  u32 limit;
+  memcpy(&limit, &CVT_FLOAT_FAST_LIMIT, 4);
+  for (u32 bits = 0; bits < limit + 0x1000; bits += 997) {
+    float x;
+    memcpy(&x, &bits, 4);
+    check(x, 4);
+    check(-x, 4);
+  }
+
+  // all small integers, with and without a fraction
+  for (u32 i = 0; i < 0x10000; i++) {
+    check(i, 4);
+    check(i + 0.5f, 2);
+  }
+
+  // random precisions and magnitudes
+  std::mt19937 rng(4321);
+  for (int i = 0; i < 20000; i++) {
+    u32 bits = rng() & 0x4cffffff;
+    float x;
+    memcpy(&x, &bits, 4);
+    check(x, rng() % 12);
+  }
+
+  for (float x : {0.f, -0.f, 0.1f, 1.f, 1048575.9f, 1048576.f, -1048576.5f, 1e10f, 1e-10f}) {
+    for (s32 precision = 0; precision < 40; precision++) {
+      check(x, precision);
+    }
+  }
+}
+
 namespace {
 void setup_hack_heaps(void* mem, int size) {
   g_ee_main_mem = (u8*)mem;
@@ -293,6 +378,7 @@ void setup_hack_heaps(void* mem, int size) {
   EXPECT_TRUE(heap_size > 8 * 1024 * 1024);
   kmalloc_init_globals();
   kprint_init_globals();
+  kscheme_init_globals();
 
   kinitheap(kglobalheap, Ptr<u8>(HEAP_START), heap_size);
   kinitheap(kdebugheap, Ptr<u8>(HEAP_START + heap_size), heap_size);
@@ -342,6 +428,261 @@ TEST(Kernel, PrintBuffer) {
   // more complicated tests for format will be done from within GOAL.
 }
 
+TEST(Kernel, PrintBufferStress) {
+  constexpr int size = 32 * 1024 * 1024;
+  auto mem = new u8[size];
+  setup_hack_heaps(mem, size);
+
+  // lots of small formats to the print buffer each frame, like a debug overlay.
+  constexpr int frames = 10;
+  constexpr int formats_per_frame = 20000;
+  auto format_string = make_string_from_c("~D ~X ~A~%");
+  Timer print_timer;
+  for (int frame = 0; frame < frames; frame++) {
+    clear_print();
+    for (int i = 0; i < formats_per_frame; i++) {
+      u64 args[5] = {s7.offset + FIX_SYM_TRUE, format_string, (u64)i, (u64)i * 3, (u64)i << 3};
+      format_impl(args);
+    }
+    std::string result = PrintBufArea.cast<char>().c() + sizeof(GoalMessageHeader);
+    EXPECT_EQ(0, result.find("0 0 0\n1 3 1\n2 6 2\n"));
+    EXPECT_EQ(formats_per_frame - 1, std::stoi(result.substr(result.rfind(' ') + 1)));
+  }
+  double print_ms = print_timer.getMs();
+  printf("format: %d calls in %.3f ms (%.0f calls/s)\n", frames * formats_per_frame, print_ms,
+         frames * formats_per_frame / (print_ms / 1000.));
+
+  // without clearing, the print buffer fills up and later prints are dropped.
+  clear_print();
+  auto canary = PrintBufArea + DEBUG_PRINT_BUFFER_SIZE;
+  *canary = 0xcd;
+  for (int i = 0; i < 200000; i++) {
+    u64 args[5] = {s7.offset + FIX_SYM_TRUE, format_string, (u64)i, (u64)i * 3, (u64)i << 3};
+    format_impl(args);
+  }
+  cprintf("%s", std::string(PRINT_APPEND_RESERVE, 'a').c_str());
+  EXPECT_EQ(0xcd, *canary);
+  EXPECT_LT(strlen(PrintBufArea.cast<char>().c() + sizeof(GoalMessageHeader)),
+            DEBUG_PRINT_BUFFER_SIZE - sizeof(GoalMessageHeader));
+  clear_print();
+
+  // lots of messages to the output buffer before it's sent, like loading many files.
+  constexpr int loads = 4000;
+  auto link_block = kmalloc(kglobalheap, 0x100, KMALLOC_MEMSET, "link-block");
+  clear_output();
+  Timer output_timer;
+  for (int i = 0; i < loads; i++) {
+    output_segment_load("test-segment", link_block, 0, 1000);
+  }
+  double output_ms = output_timer.getMs();
+  std::string output = OutputBufArea.cast<char>().c() + sizeof(GoalMessageHeader);
+  EXPECT_EQ(loads * strlen("load \"test-segment\" nil #x0 #x0 #x0 1\n"), output.length());
+  printf("output: %d segment loads in %.3f ms\n", loads, output_ms);
+
+  delete[] mem;
+}
+
+TEST(Kernel, KmallocTracker) {
+  constexpr int size = 32 * 1024 * 1024;
+  auto mem = new u8[size];
+  setup_hack_heaps(mem, size);
+  auto goal_path = make_string_from_c("out/kmalloc-timeline-test.csv");
+  kmalloc_set_tracking(true);
+
+  auto a = kmalloc(kglobalheap, 4, 0, "test-a").offset;
+  kmalloc(kglobalheap, 4, KMALLOC_ALIGN_256, "test-b");
+  kmalloc(kglobalheap, 8, 0, "test-a");
+  kmalloc(kglobalheap, 0x100, KMALLOC_TOP, "test-top");
+  auto high_water = kheap_high_water(kglobalheap);
+  kglobalheap->top = kglobalheap->top_base;
+  kmalloc(kglobalheap, 0x10, KMALLOC_TOP, "test-top");
+  EXPECT_EQ(high_water, kheap_high_water(kglobalheap));
+  EXPECT_EQ(high_water, kglobalheap->current.offset - kglobalheap->base.offset + 0x100);
+  EXPECT_FALSE(kmalloc(kglobalheap, size, 0, "too-big").offset);
+
+  auto names = kheap_name_stats(kglobalheap);
+  ASSERT_EQ(3, names.size());
+  EXPECT_EQ("test-top", names[0].name);
+  EXPECT_EQ(2, names[0].count);
+  EXPECT_EQ("test-a", names[1].name);
+  EXPECT_EQ(2, names[1].count);
+  EXPECT_EQ(12, names[1].bytes);
+#ifdef __linux__
+  EXPECT_NE(nullptr, names[1].call_site);
+#endif
+  EXPECT_EQ("test-b", names[2].name);
+  EXPECT_EQ(((a + 4 + 255) & ~255) - (a + 4), names[2].waste);
+  EXPECT_TRUE(kheap_name_stats(kdebugheap).empty());
+
+  auto path = file_util::get_file_path({"out", "kmalloc-timeline-test.csv"});
+  EXPECT_EQ(6, kmalloc_dump_timeline(goal_path));
+  auto timeline = file_util::read_text_file(path);
+  EXPECT_NE(std::string::npos, timeline.find("\"too-big\",#x0,"));
+  EXPECT_NE(std::string::npos, timeline.find(",call-site\n"));
+  remove(path.c_str());
+
+  kmalloc_set_tracking(false);
+  delete[] mem;
+}
+
+TEST(Kernel, MethodSetChildIndex) {
+  constexpr int size = 32 * 1024 * 1024;
+  auto mem = new u8[size];
+  setup_hack_heaps(mem, size);
+  EnableMethodSet = intern_from_c("*enable-method-set*").cast<u32>();
+  *EnableMethodSet = 1;
+
+  // a tree of types, each with 3 children, and a method that each type inherits.
+  auto root = intern_type_from_c("root", 12);
+  set_type_values(root, Ptr<Type>(*(s7 + FIX_SYM_FUNCTION_TYPE)), ((u64)12 << 32) | 16);
+  root->get_method(9).offset = 100;
+  std::vector<Ptr<Type>> types = {root};
+  for (int i = 1; i < 364; i++) {
+    auto name = "child-" + std::to_string(i);
+    auto parent = types.at((i - 1) / 3);
+    auto sym = intern_from_c(name.c_str());
+    types.push_back(Ptr<Type>(new_type(sym.offset, parent.offset, ((u64)12 << 32) | 16)));
+  }
+  EXPECT_EQ(3, get_type_children(root).size());
+
+  // a type overriding the method, and its children, should keep the override.
+  auto overrider = types.at(2);
+  method_set(overrider.offset, 9, 200);
+  Timer timer;
+  method_set(root.offset, 9, 300);
+  printf("method_set over %d types took %.3f ms\n", (int)types.size(), timer.getMs());
+
+  for (auto& type : types) {
+    bool overridden = false;
+    for (auto t = type; t.offset && t.offset != root.offset; t = t->parent) {
+      overridden = overridden || t == overrider;
+    }
+    EXPECT_EQ(overridden ? 200 : 300, type->get_method(9).offset);
+  }
+
+  // re-parenting moves the type in the index.
+  auto moved = types.at(3);
+  set_type_values(moved, types.at(4), ((u64)12 << 32) | 16);
+  EXPECT_EQ(2, get_type_children(root).size());
+  EXPECT_EQ(4, get_type_children(types.at(4)).size());
+
+  *EnableMethodSet = 0;
+  delete[] mem;
+}
+
+TEST(Kernel, TypeDisplay) {
+  constexpr int size = 32 * 1024 * 1024;
+  auto mem = new u8[size];
+  setup_hack_heaps(mem, size);
+
+  // the builtin type tree from InitHeapAndSymbol.
+  auto object = alloc_and_init_type((s7 + FIX_SYM_OBJECT_TYPE).cast<Symbol>(), 9);
+  set_type_values(object, object, ((u64)9 << 32) | 4);
+  std::vector<std::pair<const char*, const char*>> builtins = {
+      {"structure", "object"},      {"basic", "structure"},   {"symbol", "basic"},
+      {"type", "basic"},            {"string", "basic"},      {"function", "basic"},
+      {"vu-function", "structure"}, {"link-block", "basic"},  {"kheap", "structure"},
+      {"array", "basic"},           {"pair", "object"},       {"process-tree", "basic"},
+      {"process", "process-tree"},  {"thread", "basic"},      {"connectable", "structure"},
+      {"stack-frame", "basic"},     {"file-stream", "basic"}, {"pointer", "object"},
+      {"number", "object"},         {"float", "number"},      {"integer", "number"},
+      {"binteger", "integer"},      {"sinteger", "integer"},  {"int8", "sinteger"},
+      {"int16", "sinteger"},        {"int32", "sinteger"},    {"int64", "sinteger"},
+      {"int128", "sinteger"},       {"uinteger", "integer"},  {"uint8", "uinteger"},
+      {"uint16", "uinteger"},       {"uint32", "uinteger"},   {"uint64", "uinteger"},
+      {"uint128", "uinteger"}};
+  std::vector<Ptr<Type>> types = {object};
+  for (auto& builtin : builtins) {
+    auto sym = intern_from_c(builtin.first);
+    auto parent = intern_from_c(builtin.second)->value;
+    if (!strcmp(builtin.second, "object")) {
+      parent = object.offset;
+    }
+    types.push_back(Ptr<Type>(new_type(sym.offset, parent, ((u64)9 << 32) | 16)));
+  }
+  EXPECT_EQ(0, type_depth(object));
+  EXPECT_EQ(4, type_depth(Ptr<Type>(intern_from_c("int8")->value)));
+
+  // the display and the parent walk should always agree.
+  auto check_all = [&]() {
+    for (auto t1 : types) {
+      for (auto t2 : types) {
+        EXPECT_EQ(type_typep_walk(t1, t2), type_typep(t1, t2));
+      }
+    }
+  };
+  check_all();
+
+  // time both over every pair of builtin types, then with a chain of types below process as the
+  // first type, which is deeper, like the game's process types.
+  auto benchmark = [&](const std::vector<Ptr<Type>>& t1s, const char* what) {
+    constexpr int iterations = 200;
+    u64 count = 0;
+    Timer walk_timer;
+    for (int i = 0; i < iterations; i++) {
+      for (auto t1 : t1s) {
+        for (auto t2 : types) {
+          count += type_typep_walk(t1, t2) != s7.offset;
+        }
+      }
+    }
+    double walk_ms = walk_timer.getMs();
+    Timer display_timer;
+    for (int i = 0; i < iterations; i++) {
+      for (auto t1 : t1s) {
+        for (auto t2 : types) {
+          count -= type_typep(t1, t2) != s7.offset;
+        }
+      }
+    }
+    EXPECT_EQ(0, count);
+    printf("type_typep over %d %s type pairs: walk %.3f ms, display %.3f ms\n",
+           (int)(t1s.size() * types.size() * iterations), what, walk_ms, display_timer.getMs());
+  };
+  benchmark(types, "builtin");
+  auto process = Ptr<Type>(intern_from_c("process")->value);
+  std::vector<Ptr<Type>> process_types;
+  for (int i = 0; i < 12; i++) {
+    auto name = "process-child-" + std::to_string(i);
+    process = Ptr<Type>(new_type(intern_from_c(name.c_str()).offset, process.offset, (u64)9 << 32));
+    process_types.push_back(process);
+  }
+  types.insert(types.end(), process_types.begin(), process_types.end());
+  check_all();
+  benchmark(process_types, "process child");
+
+  // re-parenting a type updates everything below it.
+  auto integer = Ptr<Type>(intern_from_c("integer")->value);
+  auto basic = Ptr<Type>(intern_from_c("basic")->value);
+  set_type_values(integer, basic, ((u64)9 << 32) | 16);
+  EXPECT_EQ(5, type_depth(Ptr<Type>(intern_from_c("int8")->value)));
+  check_all();
+
+  // changing the parent of a type without set_type_values is noticed when the type is checked,
+  // which also rebuilds the types below it and fixes the child index.
+  auto structure = Ptr<Type>(intern_from_c("structure")->value);
+  auto sinteger = Ptr<Type>(intern_from_c("sinteger")->value);
+  sinteger->parent = structure;
+  EXPECT_EQ(2, type_depth(sinteger));
+  EXPECT_EQ(3, type_depth(Ptr<Type>(intern_from_c("int16")->value)));
+  auto structure_children = get_type_children(structure);
+  EXPECT_NE(structure_children.end(), std::find(structure_children.begin(),
+                                                structure_children.end(), sinteger.offset));
+  check_all();
+
+  // and chains too deep for the display walk the parents.
+  auto deep = object;
+  for (u32 i = 0; i < MAX_TYPE_DEPTH + 4; i++) {
+    auto name = "deep-" + std::to_string(i);
+    deep = Ptr<Type>(new_type(intern_from_c(name.c_str()).offset, deep.offset, (u64)9 << 32));
+    types.push_back(deep);
+  }
+  EXPECT_EQ(MAX_TYPE_DEPTH, type_depth(deep));
+  check_all();
+
+  delete[] mem;
+}
+
 TEST(Kernel, HashTable) {
   constexpr int size = 32 * 1024 * 1024;
   auto mem = new u8[size];
@@ -367,9 +708,27 @@ TEST(Kernel, HashTable) {
   EXPECT_EQ(7941, symbol_locations.size());
   EXPECT_EQ(7941, unique_locations.size());
 
+  Timer index_timer;
   for (auto name : all_syms) {
     EXPECT_EQ(symbol_locations.at(name), intern_from_c(name).offset);
   }
+  double index_ms = index_timer.getMs();
+
+  // the symbol index should agree with the game's hash table probe
+  for (auto name : all_syms) {
+    if (!strcmp(name, "_empty_")) {
+      continue;  // not in the hash table
+    }
+    u32 hash = crc32((const u8*)name, strlen(name));
+    EXPECT_EQ(symbol_locations.at(name), probe_symbol_table(hash, name).offset);
+  }
+
+  Timer probe_timer;
+  for (auto name : all_syms) {
+    probe_symbol_table(crc32((const u8*)name, strlen(name)), name);
+  }
+  printf("resolved %d symbols: %.3f ms with index, %.3f ms with probe\n",
+         (int)symbol_locations.size(), index_ms, probe_timer.getMs());
 
   EXPECT_EQ(intern_from_c("global").offset - s7.offset, FIX_SYM_GLOBAL_HEAP);
   EXPECT_EQ(intern_from_c("#f").offset - s7.offset, 0);
@@ -385,3 +744,73 @@ TEST(Kernel, HashTable) {
 
   delete[] mem;
 }
+
+TEST(Kernel, crc32) {
+  init_crc();
+  // the game's byte-at-a-time implementation
+  auto reference_crc32 = [](const u8* data, s32 size) {
+    u32 crc = 0;
+    for (int i = size; i != 0; i--, data++) {
+      crc = crc_table[crc >> 24] ^ ((crc << 8) | *data);
+    }
+    return ~crc;
+  };
+
+  u8 data[67];
+  for (int i = 0; i < 67; i++) {
+    data[i] = (u8)(i * 97 + 13);
+  }
+
+  for (int start = 0; start < 3; start++) {
+    for (int size = 1; size < 64; size++) {
+      EXPECT_EQ(reference_crc32(data + start, size), crc32(data + start, size));
+    }
+  }
+
+  for (auto name : all_syms) {
+    EXPECT_EQ(reference_crc32((const u8*)name, strlen(name)), crc32((const u8*)name, strlen(name)));
+  }
+}
+
+TEST(Kernel, FileCache) {
+  auto path = file_util::get_file_path({"out", "file-cache-test.bin"});
+  u8 data[32];
+  for (int i = 0; i < 32; i++) {
+    data[i] = i;
+  }
+  file_util::write_binary_file(path, data, 32);
+
+  FileCache cache(48);
+  auto first = cache.get(path);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(32, first->size());
+  EXPECT_EQ(31, first->at(31));
+  auto second = cache.get(path);
+  EXPECT_EQ(first.get(), second.get());
+  EXPECT_EQ(1, cache.stats().hits);
+  EXPECT_EQ(1, cache.stats().misses);
+  EXPECT_EQ(32, cache.stats().bytes_saved);
+  EXPECT_EQ(32, cache.stats().bytes_used);
+
+  // a changed file is reloaded
+  file_util::write_binary_file(path, data, 24);
+  EXPECT_EQ(24, cache.get(path)->size());
+  EXPECT_EQ(2, cache.stats().misses);
+  EXPECT_EQ(24, cache.stats().bytes_used);
+
+  // so is a file rewritten with the same size less than a second later. The sleep only needs to be
+  // longer than the file system's timestamp granularity.
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  data[0] = 100;
+  file_util::write_binary_file(path, data, 24);
+  EXPECT_EQ(100, cache.get(path)->at(0));
+  EXPECT_EQ(3, cache.stats().misses);
+
+  // shrinking the budget evicts
+  cache.set_budget(16);
+  EXPECT_EQ(0, cache.stats().bytes_used);
+  EXPECT_EQ(1, cache.stats().evictions);
+
+  EXPECT_FALSE(cache.get(path + ".missing"));
+  remove(path.c_str());
+}
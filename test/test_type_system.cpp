@@ -265,6 +265,49 @@ TEST(TypeSystem, TypeCheck) {
   EXPECT_FALSE(ts.typecheck(f_s_s_n, f_s_n, "", false, false));
 }
 
+TEST(TypeSystem, TypeCheckMatchesWalk) {
+  TypeSystem ts;
+  ts.add_builtin_types();
+
+  EXPECT_EQ(TypeSpec("string").base_type_id(), ts.make_typespec("string").base_type_id());
+  EXPECT_NE(TypeSpec("string").base_type_id(), TypeSpec("basic").base_type_id());
+  EXPECT_EQ(TypeSpec("string").base_type(), "string");
+
+  // all under object, the lca of types with different roots isn't defined.
+  std::vector<std::string> names = {
+      "object",   "structure", "basic",   "symbol", "type",         "string",  "function",
+      "kheap",    "array",     "pair",    "int",    "process-tree", "process", "thread",
+      "integer",  "sinteger",  "uinteger", "int8",  "uint32",       "int64",   "float",
+      "binteger", "pointer",   "number",  "vu-function", "file-stream", "inline-array"};
+
+  // is expected a parent of actual, by walking up the tree by name.
+  auto walk = [&](const std::string& expected, const std::string& actual) {
+    auto type = ts.lookup_type(actual);
+    if (expected == actual) {
+      return true;
+    }
+    while (type->has_parent()) {
+      if (type->get_parent() == expected) {
+        return true;
+      }
+      type = ts.lookup_type(type->get_parent());
+    }
+    return false;
+  };
+
+  for (auto& a : names) {
+    for (auto& b : names) {
+      auto ta = ts.make_typespec(a);
+      auto tb = ts.make_typespec(b);
+      EXPECT_EQ(walk(a, b), ts.typecheck(ta, tb, "", false, false)) << a << " " << b;
+      auto lca = ts.lowest_common_ancestor(ta, tb);
+      EXPECT_EQ(lca, ts.lowest_common_ancestor(tb, ta));
+      EXPECT_TRUE(walk(lca.base_type(), a)) << a << " " << b;
+      EXPECT_TRUE(walk(lca.base_type(), b)) << a << " " << b;
+    }
+  }
+}
+
 TEST(TypeSystem, FieldLookup) {
   // note - this test isn't testing the specific needs_deref, type of the returned info.  Until more
   // stuff is set up that test is kinda useless - it would just be testing against the exact